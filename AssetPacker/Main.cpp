@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "AssetArchive.h"
+#include "Lz4.h"
+#include "ResourceCache.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Entries whose compressed form saves less than this fraction are stored, decompressing them isn't worth it
+const double MIN_COMPRESSION_SAVING = 0.125;
+
+struct PackInput {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+static std::vector<uint8_t> readWholeFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open \"" + path.string() + "\"!");
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    std::vector<uint8_t> buffer(fileSize);
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(buffer.data()), fileSize);
+    return buffer;
+}
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Every regular file below directory, named by its path relative to it with '/' separators
+static std::vector<PackInput> gatherInputs(const std::filesystem::path& directory) {
+    std::vector<PackInput> inputs;
+    for (const auto& file : std::filesystem::recursive_directory_iterator(directory)) {
+        if (!file.is_regular_file()) {
+            continue;
+        }
+        PackInput input;
+        input.name = std::filesystem::relative(file.path(), directory).generic_string();
+        input.data = readWholeFile(file.path());
+        inputs.push_back(std::move(input));
+    }
+
+    std::sort(inputs.begin(), inputs.end(), [](const PackInput& a, const PackInput& b) { return a.name < b.name; });
+    return inputs;
+}
+
+static void writeArchive(const std::string& path, const std::vector<PackInput>& inputs, bool compress) {
+    uint32_t entryCount = static_cast<uint32_t>(inputs.size());
+    // at most half full, and always one empty bucket to end probes
+    uint32_t bucketCount = 1;
+    while (bucketCount < entryCount * 2 + 1) {
+        bucketCount *= 2;
+    }
+
+    std::vector<ArchiveEntry> entries(entryCount);
+    std::vector<uint32_t> buckets(bucketCount, 0);
+    std::string names;
+    std::vector<std::vector<uint8_t>> payloads(entryCount);
+
+    for (uint32_t i = 0; i < entryCount; i++) {
+        const PackInput& input = inputs[i];
+        ArchiveEntry& entry = entries[i];
+        entry.nameHash = hashAssetName(input.name);
+        entry.nameOffset = static_cast<uint32_t>(names.size());
+        entry.nameLength = static_cast<uint32_t>(input.name.size());
+        entry.size = input.data.size();
+        names += input.name;
+
+        std::vector<uint8_t> compressed;
+        if (compress && !input.data.empty()) {
+            lz4Compress(input.data.data(), input.data.size(), compressed);
+        }
+        if (!compressed.empty() && compressed.size() <= input.data.size() * (1.0 - MIN_COMPRESSION_SAVING)) {
+            entry.compression = static_cast<uint32_t>(ArchiveCompression::Lz4);
+            payloads[i] = std::move(compressed);
+        }
+        else {
+            entry.compression = static_cast<uint32_t>(ArchiveCompression::None);
+            payloads[i] = input.data;
+        }
+        entry.storedSize = payloads[i].size();
+
+        uint32_t slot = static_cast<uint32_t>(entry.nameHash) & (bucketCount - 1);
+        while (buckets[slot] != 0) {
+            slot = (slot + 1) & (bucketCount - 1);
+        }
+        buckets[slot] = i + 1;
+    }
+
+    ArchiveHeader header{};
+    header.magic = ARCHIVE_MAGIC;
+    header.version = ARCHIVE_VERSION;
+    header.entryCount = entryCount;
+    header.bucketCount = bucketCount;
+    header.namesOffset = sizeof(ArchiveHeader) + entryCount * sizeof(ArchiveEntry) + bucketCount * sizeof(uint32_t);
+    header.namesSize = names.size();
+    header.alignment = ARCHIVE_ALIGNMENT;
+
+    uint64_t offset = alignUp(header.namesOffset + header.namesSize, ARCHIVE_ALIGNMENT);
+    for (auto& entry : entries) {
+        entry.offset = offset;
+        offset = alignUp(offset + entry.storedSize, ARCHIVE_ALIGNMENT);
+    }
+
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to create \"" + temporaryPath + "\"!");
+        }
+
+        auto padTo = [&file](uint64_t position) {
+            static const char zeros[ARCHIVE_ALIGNMENT] = {};
+            uint64_t current = static_cast<uint64_t>(file.tellp());
+            file.write(zeros, static_cast<std::streamsize>(position - current));
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ArchiveEntry));
+        file.write(reinterpret_cast<const char*>(buckets.data()), buckets.size() * sizeof(uint32_t));
+        file.write(names.data(), names.size());
+        for (uint32_t i = 0; i < entryCount; i++) {
+            padTo(entries[i].offset);
+            file.write(reinterpret_cast<const char*>(payloads[i].data()), payloads[i].size());
+        }
+        padTo(offset);
+
+        if (!file) {
+            throw std::runtime_error("failed to write \"" + temporaryPath + "\"!");
+        }
+    }
+    std::filesystem::rename(temporaryPath, path);
+
+    uint64_t rawBytes = 0;
+    for (uint32_t i = 0; i < entryCount; i++) {
+        const ArchiveEntry& entry = entries[i];
+        rawBytes += entry.size;
+        std::cout << "\t" << inputs[i].name << ": " << entry.size << " bytes";
+        if (entry.compression == static_cast<uint32_t>(ArchiveCompression::Lz4)) {
+            std::cout << " -> " << entry.storedSize << " (lz4)";
+        }
+        std::cout << " @ " << entry.offset << "\n";
+    }
+    std::cout << "Wrote \"" << path << "\": " << entryCount << " entries, " << rawBytes << " bytes of assets in " << offset << " bytes\n";
+}
+
+static void listArchive(const std::string& path) {
+    ResourceCache cache;
+    AssetArchive archive(cache, path);
+    for (uint32_t i = 0; i < archive.getEntryCount(); i++) {
+        std::string name = archive.getEntryName(i);
+        std::cout << "\t" << name << ": " << archive.load(name).size << " bytes\n";
+    }
+}
+
+// Drops a file's pages from the OS page cache so the next read comes from storage
+static void evictFromPageCache(const std::string& path) {
+#ifdef _WIN32
+    // opening a file unbuffered makes the cache manager flush and purge its cached pages
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+    }
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file >= 0) {
+        posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+        close(file);
+    }
+#endif
+}
+
+static uint64_t touch(const uint8_t* data, size_t size) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+// Times loading every archive entry from loose files in directory vs. from the archive, both on a cold page cache
+static void benchmarkLoads(const std::string& archivePath, const std::string& directory, uint32_t iterations) {
+    std::vector<std::string> names;
+    {
+        ResourceCache cache;
+        AssetArchive archive(cache, archivePath);
+        for (uint32_t i = 0; i < archive.getEntryCount(); i++) {
+            names.push_back(archive.getEntryName(i));
+        }
+    }
+
+    double looseTotal = 0.0, archiveTotal = 0.0;
+    uint64_t looseSum = 0, archiveSum = 0;
+    for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+        for (const auto& name : names) {
+            evictFromPageCache(directory + "/" + name);
+        }
+        auto looseStart = std::chrono::steady_clock::now();
+        for (const auto& name : names) {
+            std::vector<uint8_t> data = readWholeFile(directory + "/" + name);
+            looseSum += touch(data.data(), data.size());
+        }
+        looseTotal += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - looseStart).count();
+
+        evictFromPageCache(archivePath);
+        auto archiveStart = std::chrono::steady_clock::now();
+        {
+            ResourceCache cache;
+            AssetArchive archive(cache, archivePath);
+            for (const auto& name : names) {
+                ResourceSpan span = archive.load(name);
+                archiveSum += touch(span.data, span.size);
+            }
+        }
+        archiveTotal += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - archiveStart).count();
+    }
+
+    if (looseSum != archiveSum) {
+        throw std::runtime_error("archive contents differ from the loose files!");
+    }
+
+    std::cout << "Cold Load of " << names.size() << " Assets (average of " << iterations << ")\n";
+    std::cout << "\tLoose Files: " << looseTotal / iterations << " ms\n";
+    std::cout << "\tArchive: " << archiveTotal / iterations << " ms\n";
+}
+
+static void printUsage(const char* program) {
+    std::cout << "Usage:\n";
+    std::cout << "\t" << program << " <archive> <directory> [--compress]   Pack every file below directory\n";
+    std::cout << "\t" << program << " --list <archive>                     List entries\n";
+    std::cout << "\t" << program << " --bench <archive> <directory> [n]    Compare cold loads against the loose files\n";
+}
+
+int main(int argc, char** argv) {
+    try {
+        std::vector<std::string> args(argv + 1, argv + argc);
+
+        if (args.size() == 2 && args[0] == "--list") {
+            listArchive(args[1]);
+        }
+        else if ((args.size() == 3 || args.size() == 4) && args[0] == "--bench") {
+            uint32_t iterations = args.size() == 4 ? static_cast<uint32_t>(std::stoul(args[3])) : 5;
+            benchmarkLoads(args[1], args[2], std::max(iterations, 1u));
+        }
+        else if ((args.size() == 2 || (args.size() == 3 && args[2] == "--compress")) && args[0][0] != '-') {
+            writeArchive(args[0], gatherInputs(args[1]), args.size() == 3);
+        }
+        else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
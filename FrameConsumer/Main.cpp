@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameStream.h"
+
+struct ConsumerSettings {
+    std::string target;
+    // stop after this many frames, 0 reads until the producer closes the stream
+    uint64_t frames = 0;
+    // print an FNV-1a hash of every payload
+    bool hash = false;
+    // sleeps after every frame, to simulate a slow consumer and exercise the producer's drop/block policy
+    uint32_t delayMilliseconds = 0;
+};
+
+struct StreamTotals {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    // gaps in the serials the producer sent, i.e. frames it dropped (or skipped with --readback-every)
+    uint64_t missing = 0;
+    double latencySum = 0.0;
+    double latencyMax = 0.0;
+
+    void add(const FrameStreamHeader& header, double latency) {
+        frames++;
+        bytes += header.size;
+        latencySum += latency;
+        latencyMax = std::max(latencyMax, latency);
+    }
+};
+
+static const char* formatName(uint32_t format) {
+    switch (static_cast<StreamPixelFormat>(format)) {
+    case StreamPixelFormat::Rgba8:
+        return "rgba8";
+    case StreamPixelFormat::Bgra8:
+        return "bgra8";
+    case StreamPixelFormat::I420:
+        return "i420";
+    }
+    return "unknown";
+}
+
+static void printTotals(const char* label, const StreamTotals& totals, double seconds) {
+    double framesPerSecond = seconds > 0.0 ? totals.frames / seconds : 0.0;
+    double megabytesPerSecond = seconds > 0.0 ? totals.bytes / seconds / (1024.0 * 1024.0) : 0.0;
+    double latency = totals.frames > 0 ? totals.latencySum / totals.frames : 0.0;
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "%s%llu frames, %.1f fps, %.1f MB/s, latency avg %.2f ms max %.2f ms, %llu missing",
+                  label, static_cast<unsigned long long>(totals.frames), framesPerSecond, megabytesPerSecond,
+                  latency, totals.latencyMax, static_cast<unsigned long long>(totals.missing));
+    std::cout << line << std::endl;
+}
+
+static void consume(const ConsumerSettings& settings) {
+    FrameSource source(settings.target);
+
+    FrameStreamHeader header;
+    std::vector<uint8_t> payload;
+    StreamTotals total, interval;
+    uint64_t lastSerial = 0;
+    bool first = true;
+
+    auto start = std::chrono::steady_clock::now();
+    auto intervalStart = start;
+
+    while ((settings.frames == 0 || total.frames < settings.frames) && source.read(header, payload)) {
+        // the header timestamp is taken by the producer on the same steady clock when the frame was submitted
+        double latency = (static_cast<int64_t>(streamTimestamp()) - static_cast<int64_t>(header.timestamp)) / 1e6;
+
+        if (first) {
+            std::cout << "Stream: " << header.width << "x" << header.height << " " << formatName(header.format)
+                      << ", " << header.size << " bytes per frame" << std::endl;
+            first = false;
+        }
+        else if (header.serial > lastSerial + 1) {
+            total.missing += header.serial - lastSerial - 1;
+            interval.missing += header.serial - lastSerial - 1;
+        }
+        lastSerial = header.serial;
+
+        total.add(header, latency);
+        interval.add(header, latency);
+
+        if (settings.hash) {
+            uint64_t hash = 14695981039346656037ull;
+            for (uint8_t byte : payload) {
+                hash = (hash ^ byte) * 1099511628211ull;
+            }
+            char line[64];
+            std::snprintf(line, sizeof(line), "%llu %016llx", static_cast<unsigned long long>(header.serial), static_cast<unsigned long long>(hash));
+            std::cout << line << "\n";
+        }
+
+        if (settings.delayMilliseconds > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(settings.delayMilliseconds));
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - intervalStart).count();
+        if (elapsed >= 1.0) {
+            printTotals("", interval, elapsed);
+            interval = StreamTotals();
+            intervalStart = now;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printTotals("Total: ", total, seconds);
+}
+
+static void printUsage(const char* program) {
+    std::cout << "Usage:\n";
+    std::cout << "\t" << program << " <pipe:path|unix:path|shm:name> [options]   Read a stream written with --stream\n";
+    std::cout << "Options:\n";
+    std::cout << "\t--frames <n>         Stop after n frames\n";
+    std::cout << "\t--hash               Print a hash of every frame\n";
+    std::cout << "\t--delay-ms <n>       Sleep after every frame\n";
+}
+
+int main(int argc, char** argv) {
+    try {
+        std::vector<std::string> args(argv + 1, argv + argc);
+        if (args.empty() || args[0][0] == '-') {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        ConsumerSettings settings;
+        settings.target = args[0];
+        for (size_t i = 1; i < args.size(); i++) {
+            if (args[i] == "--frames" && i + 1 < args.size()) {
+                settings.frames = std::stoull(args[++i]);
+            }
+            else if (args[i] == "--hash") {
+                settings.hash = true;
+            }
+            else if (args[i] == "--delay-ms" && i + 1 < args.size()) {
+                settings.delayMilliseconds = static_cast<uint32_t>(std::stoul(args[++i]));
+            }
+            else {
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        consume(settings);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+#include "AssetArchive.h"
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "Lz4.h"
+#include "Trace.h"
+
+AssetArchive::AssetArchive(ResourceCache& cache, std::string path) : m_Path{ std::move(path) } {
+    TRACE_SCOPE("AssetArchive::AssetArchive", "loader");
+    m_Archive = cache.load(m_Path, ResourceAccess::Map);
+    validate();
+}
+
+// Checks every offset once up front so lookups can trust the table of contents
+void AssetArchive::validate() {
+    const uint8_t* data = m_Archive.data;
+    uint64_t size = m_Archive.size;
+
+    if (size < sizeof(ArchiveHeader)) {
+        throw std::runtime_error("\"" + m_Path + "\" is not an asset archive!");
+    }
+    m_Header = reinterpret_cast<const ArchiveHeader*>(data);
+    if (m_Header->magic != ARCHIVE_MAGIC) {
+        throw std::runtime_error("\"" + m_Path + "\" is not an asset archive!");
+    }
+    if (m_Header->version != ARCHIVE_VERSION) {
+        throw std::runtime_error("asset archive \"" + m_Path + "\" has unsupported version " + std::to_string(m_Header->version) + "!");
+    }
+
+    uint64_t entriesEnd = sizeof(ArchiveHeader) + uint64_t(m_Header->entryCount) * sizeof(ArchiveEntry);
+    uint64_t bucketsEnd = entriesEnd + uint64_t(m_Header->bucketCount) * sizeof(uint32_t);
+    bool powerOfTwo = m_Header->bucketCount != 0 && (m_Header->bucketCount & (m_Header->bucketCount - 1)) == 0;
+    if (!powerOfTwo || m_Header->bucketCount <= m_Header->entryCount || bucketsEnd > size ||
+        m_Header->namesOffset < bucketsEnd || m_Header->namesSize > size - m_Header->namesOffset) {
+        throw std::runtime_error("asset archive \"" + m_Path + "\" has a corrupt table of contents!");
+    }
+
+    m_Entries = reinterpret_cast<const ArchiveEntry*>(data + sizeof(ArchiveHeader));
+    m_Buckets = reinterpret_cast<const uint32_t*>(data + entriesEnd);
+    m_Names = reinterpret_cast<const char*>(data + m_Header->namesOffset);
+
+    for (uint32_t i = 0; i < m_Header->entryCount; i++) {
+        const ArchiveEntry& entry = m_Entries[i];
+        bool nameInBounds = uint64_t(entry.nameOffset) + entry.nameLength <= m_Header->namesSize;
+        bool dataInBounds = entry.offset <= size && entry.storedSize <= size - entry.offset;
+        bool knownCompression = entry.compression == static_cast<uint32_t>(ArchiveCompression::None) ||
+            entry.compression == static_cast<uint32_t>(ArchiveCompression::Lz4);
+        bool sizesMatch = entry.compression != static_cast<uint32_t>(ArchiveCompression::None) || entry.storedSize == entry.size;
+        if (!nameInBounds || !dataInBounds || !knownCompression || !sizesMatch) {
+            throw std::runtime_error("asset archive \"" + m_Path + "\" has a corrupt entry " + std::to_string(i) + "!");
+        }
+    }
+    for (uint32_t i = 0; i < m_Header->bucketCount; i++) {
+        if (m_Buckets[i] > m_Header->entryCount) {
+            throw std::runtime_error("asset archive \"" + m_Path + "\" has a corrupt table of contents!");
+        }
+    }
+}
+
+const ArchiveEntry* AssetArchive::findEntry(const std::string& name) {
+    uint64_t hash = hashAssetName(name);
+    uint32_t mask = m_Header->bucketCount - 1;
+
+    // there is always at least one empty bucket, so the probe ends
+    for (uint32_t slot = static_cast<uint32_t>(hash) & mask;; slot = (slot + 1) & mask) {
+        uint32_t index = m_Buckets[slot];
+        if (index == 0) {
+            return nullptr;
+        }
+
+        const ArchiveEntry& entry = m_Entries[index - 1];
+        if (entry.nameHash == hash && entry.nameLength == name.size() && std::memcmp(m_Names + entry.nameOffset, name.data(), name.size()) == 0) {
+            return &entry;
+        }
+    }
+}
+
+bool AssetArchive::contains(const std::string& name) {
+    return findEntry(name) != nullptr;
+}
+
+bool AssetArchive::find(const std::string& name, ResourceSpan& span) {
+    TRACE_SCOPE("AssetArchive::find", "loader");
+    const ArchiveEntry* entry = findEntry(name);
+    if (entry == nullptr) {
+        return false;
+    }
+
+    if (entry->compression == static_cast<uint32_t>(ArchiveCompression::None)) {
+        // shares ownership of the whole mapping
+        span = { m_Archive.owner, m_Archive.data + entry->offset, static_cast<size_t>(entry->size) };
+        return true;
+    }
+
+    uint32_t index = static_cast<uint32_t>(entry - m_Entries);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto found = m_Decompressed.find(index);
+    if (found != m_Decompressed.end()) {
+        span = found->second;
+        return true;
+    }
+
+    // word storage keeps decompressed SPIR-V usable in place
+    size_t size = static_cast<size_t>(entry->size);
+    auto words = std::make_shared<std::vector<uint32_t>>((size + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(words->data());
+    if (!lz4Decompress(m_Archive.data + entry->offset, static_cast<size_t>(entry->storedSize), bytes, size)) {
+        throw std::runtime_error("failed to decompress \"" + name + "\" from asset archive \"" + m_Path + "\"!");
+    }
+
+    span = { words, bytes, size };
+    m_Decompressed.emplace(index, span);
+    return true;
+}
+
+ResourceSpan AssetArchive::load(const std::string& name) {
+    ResourceSpan span;
+    if (!find(name, span)) {
+        throw std::runtime_error("asset archive \"" + m_Path + "\" has no entry \"" + name + "\"!");
+    }
+    return span;
+}
+
+uint32_t AssetArchive::getEntryCount() const {
+    return m_Header->entryCount;
+}
+
+std::string AssetArchive::getEntryName(uint32_t index) const {
+    const ArchiveEntry& entry = m_Entries[index];
+    return std::string(m_Names + entry.nameOffset, entry.nameLength);
+}
+
+const std::string& AssetArchive::getPath() const {
+    return m_Path;
+}
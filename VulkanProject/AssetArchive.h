@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "ResourceCache.h"
+
+// On-disk layout of a packed asset archive (written by the AssetPacker tool), all little endian:
+//
+//   ArchiveHeader
+//   ArchiveEntry[entryCount]
+//   uint32_t buckets[bucketCount]     open addressing on hashAssetName(name), entry index + 1, 0 = empty
+//   char names[]                      entry names, not terminated
+//   ... padding ...
+//   entry data, each entry starting on an ARCHIVE_ALIGNMENT boundary
+//
+// Entries start on page boundaries so a stored (uncompressed) entry can be used straight out of the mapping, and no
+// page is shared between two entries.
+
+const uint32_t ARCHIVE_MAGIC = 0x4b504b56; // "VKPK"
+const uint32_t ARCHIVE_VERSION = 1;
+const uint64_t ARCHIVE_ALIGNMENT = 4096;
+
+enum class ArchiveCompression : uint32_t {
+    None = 0,
+    Lz4 = 1
+};
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t bucketCount;   // power of two
+    uint64_t namesOffset;
+    uint64_t namesSize;
+    uint64_t alignment;
+};
+
+struct ArchiveEntry {
+    uint64_t nameHash;
+    uint64_t offset;        // from the start of the archive
+    uint64_t storedSize;    // bytes in the archive
+    uint64_t size;          // bytes once decompressed
+    uint32_t nameOffset;    // into the names block
+    uint32_t nameLength;
+    uint32_t compression;   // ArchiveCompression
+    uint32_t reserved;
+};
+
+static_assert(sizeof(ArchiveHeader) == 40, "ArchiveHeader must not contain padding");
+static_assert(sizeof(ArchiveEntry) == 48, "ArchiveEntry must not contain padding");
+
+// FNV-1a, 64 bit
+inline uint64_t hashAssetName(const std::string& name) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Read side of the archive. The whole file is mapped once through the resource cache; stored entries are handed out
+// as spans into that mapping and compressed ones are decompressed on first use and kept.
+class AssetArchive
+{
+private:
+
+    std::string m_Path;
+    ResourceSpan m_Archive;
+    const ArchiveHeader* m_Header;
+    const ArchiveEntry* m_Entries;
+    const uint32_t* m_Buckets;
+    const char* m_Names;
+
+    std::mutex m_Mutex;
+    std::unordered_map<uint32_t, ResourceSpan> m_Decompressed;
+
+    void validate();
+    const ArchiveEntry* findEntry(const std::string& name);
+
+public:
+
+    // Throws if the file is missing or is not a valid archive
+    AssetArchive(ResourceCache& cache, std::string path);
+
+    bool contains(const std::string& name);
+    // Returns false if there is no such entry
+    bool find(const std::string& name, ResourceSpan& span);
+    ResourceSpan load(const std::string& name);
+
+    uint32_t getEntryCount() const;
+    std::string getEntryName(uint32_t index) const;
+    const std::string& getPath() const;
+};
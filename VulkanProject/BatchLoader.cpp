@@ -0,0 +1,211 @@
+#include "BatchLoader.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+
+#include "Log.h"
+#include "Trace.h"
+
+static bool hasWildcards(const std::string& text) {
+    return text.find_first_of("*?") != std::string::npos;
+}
+
+static bool matchWildcards(const char* pattern, const char* text) {
+    // the last * seen and where in text it currently ends, to backtrack to on a mismatch
+    const char* star = nullptr;
+    const char* starText = nullptr;
+    while (*text != '\0') {
+        if (*pattern == '*') {
+            star = pattern++;
+            starText = text;
+        }
+        else if (*pattern == '?' || *pattern == *text) {
+            pattern++;
+            text++;
+        }
+        else if (star != nullptr) {
+            pattern = star + 1;
+            text = ++starText;
+        }
+        else {
+            return false;
+        }
+    }
+    while (*pattern == '*') {
+        pattern++;
+    }
+    return *pattern == '\0';
+}
+
+static void expandPattern(const std::string& pattern, std::vector<std::string>& paths) {
+    std::filesystem::path path(pattern);
+    std::string filePattern = path.filename().string();
+    if (!hasWildcards(filePattern)) {
+        paths.push_back(pattern);
+        return;
+    }
+
+    std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+    std::vector<std::string> matches;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file() && matchWildcards(filePattern.c_str(), name.c_str())) {
+            matches.push_back((path.has_parent_path() ? entry.path() : std::filesystem::path(name)).string());
+        }
+    }
+    if (matches.empty()) {
+        throw std::runtime_error("no files match \"" + pattern + "\"!");
+    }
+    std::sort(matches.begin(), matches.end());
+    paths.insert(paths.end(), matches.begin(), matches.end());
+}
+
+std::vector<std::string> expandBatchInputs(const std::vector<std::string>& patterns) {
+    std::vector<std::string> paths;
+    for (const auto& pattern : patterns) {
+        if (pattern.empty() || pattern[0] != '@') {
+            expandPattern(pattern, paths);
+            continue;
+        }
+
+        std::ifstream list(pattern.substr(1));
+        if (!list) {
+            throw std::runtime_error("failed to open batch list \"" + pattern.substr(1) + "\"!");
+        }
+        std::string line;
+        while (std::getline(list, line)) {
+            size_t begin = line.find_first_not_of(" \t\r");
+            size_t end = line.find_last_not_of(" \t\r");
+            // blank lines and # comments are skipped
+            if (begin == std::string::npos || line[begin] == '#') {
+                continue;
+            }
+            expandPattern(line.substr(begin, end - begin + 1), paths);
+        }
+    }
+    return paths;
+}
+
+BatchLoader::BatchLoader(std::vector<std::string> paths, uint32_t lookahead, uint32_t threadCount)
+    : m_Paths{ std::move(paths) }, m_Lookahead{ std::max<size_t>(lookahead, 1) } {
+    // outputs are named after their inputs, so files with the same name in different directories get a suffix
+    std::set<std::string> used;
+    m_Names.reserve(m_Paths.size());
+    for (size_t i = 0; i < m_Paths.size(); i++) {
+        std::string name = std::filesystem::path(m_Paths[i]).stem().string();
+        if (!used.insert(name).second) {
+            name += "_" + std::to_string(i);
+            used.insert(name);
+        }
+        m_Names.push_back(name);
+    }
+
+    size_t workers = threadCount > 0 ? threadCount : m_Lookahead;
+    workers = std::min(workers, std::max<size_t>(m_Paths.size(), 1));
+    for (size_t i = 0; i < workers; i++) {
+        m_Workers.emplace_back(&BatchLoader::workerLoop, this);
+    }
+    Log::info("Batch Of {} Files ({} loader threads, {} files ahead)", m_Paths.size(), workers, m_Lookahead);
+}
+
+BatchLoader::~BatchLoader() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_WorkAvailable.notify_all();
+    for (auto& worker : m_Workers) {
+        worker.join();
+    }
+}
+
+size_t BatchLoader::size() const {
+    return m_Paths.size();
+}
+
+void BatchLoader::workerLoop() {
+    Trace::setThreadName("Batch Loader");
+    while (true) {
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WorkAvailable.wait(lock, [this] {
+                return m_Stopping || (m_NextLoad < m_Paths.size() && m_NextLoad < m_NextOut + m_Lookahead);
+            });
+            if (m_Stopping) {
+                return;
+            }
+            index = m_NextLoad++;
+        }
+
+        BatchItem item = load(index);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Ready.emplace(index, std::move(item));
+        }
+        m_ItemReady.notify_all();
+    }
+}
+
+BatchItem BatchLoader::load(size_t index) {
+    TRACE_SCOPE("BatchLoader::load", "loader");
+    BatchItem item;
+    item.index = index;
+    item.path = m_Paths[index];
+    item.name = m_Names[index];
+
+    // Anything thrown here fails this item only; escaping the worker thread it would end the process (a file that
+    // can't be sized or shrinks while it is read, or running out of memory for a huge one)
+    try {
+        std::error_code error;
+        if (std::filesystem::is_directory(item.path, error)) {
+            throw std::runtime_error("\"" + item.path + "\" is a directory!");
+        }
+        // read into memory rather than through the ResourceCache, which would keep every file of the batch alive
+        std::ifstream file(item.path, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open \"" + item.path + "\"!");
+        }
+        std::streamoff size = file.tellg();
+        if (size < 0) {
+            throw std::runtime_error("failed to read \"" + item.path + "\"!");
+        }
+        std::vector<uint8_t> contents(static_cast<size_t>(size));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(contents.data()), contents.size());
+        if (!file) {
+            throw std::runtime_error("failed to read \"" + item.path + "\"!");
+        }
+
+        ResourceSpan span;
+        span.data = contents.data();
+        span.size = contents.size();
+        item.vertices = parseMeshCsv(span, item.path);
+    }
+    catch (const std::exception& e) {
+        item.vertices.clear();
+        item.error = e.what();
+    }
+    return item;
+}
+
+bool BatchLoader::next(BatchItem& item) {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    if (m_NextOut >= m_Paths.size()) {
+        return false;
+    }
+
+    m_ItemReady.wait(lock, [this] { return m_Ready.count(m_NextOut) != 0; });
+    auto ready = m_Ready.find(m_NextOut);
+    item = std::move(ready->second);
+    m_Ready.erase(ready);
+    m_NextOut++;
+    lock.unlock();
+
+    m_WorkAvailable.notify_all();
+    return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Mesh.h"
+
+// One batch input, read and parsed off the render thread
+struct BatchItem {
+    size_t index = 0;
+    std::string path;
+    // output file name without extension: the input's own, made unique within the batch
+    std::string name;
+    std::vector<Vertex> vertices;
+    // set instead of vertices when the file can't be read or parsed
+    std::string error;
+};
+
+// Expands --batch arguments in order: plain paths, * and ? wildcards in the file name part (matches sorted by
+// name), and @file lists with one path per line. Throws if a wildcard matches nothing or a list can't be read.
+std::vector<std::string> expandBatchInputs(const std::vector<std::string>& patterns);
+
+// Loads batch inputs on worker threads, never more than lookahead files past the last one handed out, so memory
+// stays bounded no matter how long the batch is. Items are handed out in input order.
+class BatchLoader
+{
+private:
+
+    std::vector<std::string> m_Paths;
+    std::vector<std::string> m_Names;
+    size_t m_Lookahead;
+
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkAvailable;
+    std::condition_variable m_ItemReady;
+    // loaded, waiting for next(); keyed by index since workers can finish out of order
+    std::map<size_t, BatchItem> m_Ready;
+    size_t m_NextLoad = 0;
+    size_t m_NextOut = 0;
+    bool m_Stopping = false;
+
+    void workerLoop();
+    BatchItem load(size_t index);
+
+public:
+
+    // threadCount == 0 uses one worker per lookahead slot
+    BatchLoader(std::vector<std::string> paths, uint32_t lookahead, uint32_t threadCount = 0);
+    ~BatchLoader();
+
+    BatchLoader(const BatchLoader&) = delete;
+    BatchLoader& operator=(const BatchLoader&) = delete;
+
+    size_t size() const;
+
+    // Blocks until the next item is loaded; returns false once every item has been handed out
+    bool next(BatchItem& item);
+};
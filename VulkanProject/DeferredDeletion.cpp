@@ -0,0 +1,26 @@
+#include "DeferredDeletion.h"
+
+void DeferredDeletionQueue::retire(uint64_t serial, std::function<void()> destroy) {
+    m_Entries.push_back({ serial, std::move(destroy) });
+}
+
+void DeferredDeletionQueue::collect(uint64_t completedSerial) {
+    // serials only grow, so the entries are already sorted
+    while (!m_Entries.empty() && m_Entries.front().serial <= completedSerial) {
+        Entry entry = std::move(m_Entries.front());
+        m_Entries.pop_front();
+        entry.destroy();
+    }
+}
+
+void DeferredDeletionQueue::flush() {
+    while (!m_Entries.empty()) {
+        Entry entry = std::move(m_Entries.front());
+        m_Entries.pop_front();
+        entry.destroy();
+    }
+}
+
+size_t DeferredDeletionQueue::size() const {
+    return m_Entries.size();
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// Destroys objects once the GPU has finished every submission that could still reference them, without idling the
+// device. Each queue submission gets a serial from the frame loop and its fence tells the loop when that serial has
+// completed; an object retired at serial N is destroyed by the first collect() that sees N completed.
+// Submissions on one queue complete in order, so a single completed serial covers everything before it.
+class DeferredDeletionQueue
+{
+private:
+
+    struct Entry {
+        uint64_t serial;
+        std::function<void()> destroy;
+    };
+
+    std::deque<Entry> m_Entries;
+
+public:
+
+    // serial is the last submission that may use the object
+    void retire(uint64_t serial, std::function<void()> destroy);
+
+    // Runs, in retirement order, everything retired at or before completedSerial
+    void collect(uint64_t completedSerial);
+
+    // Runs everything; only valid once the device is idle
+    void flush();
+
+    size_t size() const;
+};
@@ -0,0 +1,80 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Log.h"
+#include "Trace.h"
+
+const double GPU_TIME_SMOOTHING = 0.2;
+// aim this far under the budget, so noise doesn't push frames over it
+const double TARGET_HEADROOM = 0.9;
+// the largest change in one step, as a fraction of the scale
+const float MAX_SCALE_DROP = 0.25f;
+const float MAX_SCALE_RAISE = 0.05f;
+// smaller changes than this aren't worth it
+const float MIN_SCALE_CHANGE = 0.02f;
+// scales are rounded to this step so extents don't drift a pixel at a time
+const float SCALE_STEP = 1.0f / 64.0f;
+// frames to wait after a change, so the frames in flight at the old scale don't count
+const uint32_t CHANGE_COOLDOWN = 8;
+
+DynamicResolution::DynamicResolution(double targetMilliseconds, float minScale, float maxScale)
+    : m_TargetMilliseconds{ targetMilliseconds }, m_MinScale{ minScale }, m_MaxScale{ maxScale }, m_Scale{ maxScale }, m_LowestScale{ maxScale } {
+}
+
+float DynamicResolution::scale() const {
+    return m_Scale;
+}
+
+bool DynamicResolution::update(double gpuMilliseconds) {
+    m_Samples++;
+    m_ScaleSum += m_Scale;
+
+    if (m_Cooldown > 0) {
+        m_Cooldown--;
+        return false;
+    }
+    if (!m_HasSample) {
+        m_SmoothedMilliseconds = gpuMilliseconds;
+        m_HasSample = true;
+    }
+    else {
+        m_SmoothedMilliseconds += GPU_TIME_SMOOTHING * (gpuMilliseconds - m_SmoothedMilliseconds);
+    }
+    if (m_SmoothedMilliseconds <= 0.0) {
+        return false;
+    }
+
+    // pixels, and so (roughly) GPU time, go with the square of the scale
+    float wanted = m_Scale * static_cast<float>(std::sqrt(m_TargetMilliseconds * TARGET_HEADROOM / m_SmoothedMilliseconds));
+    wanted = std::clamp(wanted, m_Scale * (1.0f - MAX_SCALE_DROP), m_Scale * (1.0f + MAX_SCALE_RAISE));
+    wanted = std::round(wanted / SCALE_STEP) * SCALE_STEP;
+    wanted = std::clamp(wanted, m_MinScale, m_MaxScale);
+    if (std::abs(wanted - m_Scale) < MIN_SCALE_CHANGE && wanted != m_MinScale && wanted != m_MaxScale) {
+        return false;
+    }
+    if (wanted == m_Scale) {
+        return false;
+    }
+
+    Log::debug("Resolution Scale {} -> {} (GPU {} ms, budget {} ms)", m_Scale, wanted, m_SmoothedMilliseconds, m_TargetMilliseconds);
+    m_Scale = wanted;
+    m_LowestScale = std::min(m_LowestScale, m_Scale);
+    m_Changes++;
+    m_Cooldown = CHANGE_COOLDOWN;
+    // the smoothed time was measured at the old scale
+    m_HasSample = false;
+    if (Trace::enabled()) {
+        Trace::counter("Resolution Scale", "scale", m_Scale);
+    }
+    return true;
+}
+
+void DynamicResolution::printStats() {
+    if (m_Samples == 0) {
+        return;
+    }
+    Log::info("Dynamic Resolution ({} ms budget, scale {} to {}):", m_TargetMilliseconds, m_MinScale, m_MaxScale);
+    Log::info("\tScale: {} now, {} avg, {} lowest, {} changes over {} frames", m_Scale, m_ScaleSum / m_Samples, m_LowestScale, m_Changes, m_Samples);
+}
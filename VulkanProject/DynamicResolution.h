@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+// Picks the render resolution scale from measured GPU frame times, so slow GPUs trade resolution for keeping
+// within a frame time budget. GPU time is assumed to grow with the pixel count, i.e. with the square of the scale;
+// the scale moves toward the one that would put the smoothed GPU time a little under the budget, dropping quickly
+// and recovering slowly. Changes are held off for a few frames after each one, since the frames already in flight
+// were rendered at the old scale.
+class DynamicResolution
+{
+private:
+
+    double m_TargetMilliseconds;
+    float m_MinScale;
+    float m_MaxScale;
+    float m_Scale;
+
+    double m_SmoothedMilliseconds = 0.0;
+    bool m_HasSample = false;
+    uint32_t m_Cooldown = 0;
+
+    uint64_t m_Samples = 0;
+    uint64_t m_Changes = 0;
+    double m_ScaleSum = 0.0;
+    float m_LowestScale;
+
+public:
+
+    DynamicResolution(double targetMilliseconds, float minScale, float maxScale);
+
+    // Feeds the GPU time of a completed frame. Returns true if the scale changed.
+    bool update(double gpuMilliseconds);
+
+    float scale() const;
+
+    void printStats();
+};
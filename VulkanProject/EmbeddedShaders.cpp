@@ -0,0 +1,81 @@
+#include "EmbeddedShaders.h"
+
+#include <stdexcept>
+
+#include "Log.h"
+#include "Trace.h"
+
+// uint32_t arrays are already 4-byte aligned, so vkCreateShaderModule can read them in place
+static constexpr uint32_t s_VertSpv[] = {
+#include "res/vert.spv.inc"
+};
+
+static constexpr uint32_t s_FragSpv[] = {
+#include "res/frag.spv.inc"
+};
+
+ShaderBinary findEmbeddedShader(const std::string& name) {
+    if (name == "vert.spv") {
+        return { s_VertSpv, sizeof(s_VertSpv) };
+    }
+    if (name == "frag.spv") {
+        return { s_FragSpv, sizeof(s_FragSpv) };
+    }
+    return {};
+}
+
+static ShaderBinary toBinary(const ResourceSpan& span) {
+    // mappings are page aligned and cache copies word aligned
+    return { reinterpret_cast<const uint32_t*>(span.data), span.size };
+}
+
+ShaderLibrary::ShaderLibrary(ResourceCache* cache, AssetArchive* archive, std::string overrideDirectory, ResourceAccess access)
+    : m_Cache{ cache }, m_Archive{ archive }, m_OverrideDirectory{ std::move(overrideDirectory) }, m_Access{ access } {
+}
+
+bool ShaderLibrary::loadOverride(const std::string& name) {
+    std::string path = m_OverrideDirectory + "/" + name;
+    ResourceSpan span;
+    if (!m_Cache->tryLoad(path, span, m_Access)) {
+        return false;
+    }
+
+    if (span.size == 0 || span.size % sizeof(uint32_t) != 0) {
+        throw std::runtime_error("shader \"" + path + "\" is not valid SPIR-V!");
+    }
+
+    m_Overrides[name] = std::move(span);
+    Log::info("Loaded Shader Override \"{}\"", path);
+    return true;
+}
+
+ShaderBinary ShaderLibrary::get(const std::string& name) {
+    TRACE_SCOPE("ShaderLibrary::get", "loader");
+    auto found = m_Overrides.find(name);
+    if (found != m_Overrides.end()) {
+        return toBinary(found->second);
+    }
+
+    if (!m_OverrideDirectory.empty() && loadOverride(name)) {
+        return toBinary(m_Overrides[name]);
+    }
+
+    ResourceSpan packed;
+    if (m_Archive != nullptr && m_Archive->find(name, packed)) {
+        // stored entries are page aligned, decompressed ones word aligned
+        m_Overrides[name] = packed;
+        return toBinary(packed);
+    }
+
+    ShaderBinary embedded = findEmbeddedShader(name);
+    if (embedded.code == nullptr) {
+        throw std::runtime_error("no shader named \"" + name + "\"!");
+    }
+    return embedded;
+}
+
+ShaderBinary ShaderLibrary::replace(const std::string& name, ResourceSpan code) {
+    auto& span = m_Overrides[name];
+    span = std::move(code);
+    return toBinary(span);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "AssetArchive.h"
+#include "ResourceCache.h"
+
+// A view of SPIR-V words. Either points into the executable or into a ShaderLibrary override, never owns.
+struct ShaderBinary {
+    const uint32_t* code = nullptr;
+    size_t codeSize = 0; // bytes, as VkShaderModuleCreateInfo wants it
+};
+
+// Looks up SPIR-V compiled into the executable from the res/*.spv.inc files the build generates from the GLSL
+// (e.g. "vert.spv").
+// Returns an empty binary if there is no such shader.
+ShaderBinary findEmbeddedShader(const std::string& name);
+
+// Serves shaders by name. Files in the override directory win over the asset archive, which wins over the embedded
+// copies, so shaders can be iterated on without a rebuild. With neither, nothing is read from disk.
+// Overrides are loaded through the shared resource cache, mapped unless they are being watched for changes.
+class ShaderLibrary
+{
+private:
+
+    ResourceCache* m_Cache;
+    AssetArchive* m_Archive;
+    std::string m_OverrideDirectory;
+    ResourceAccess m_Access;
+    std::unordered_map<std::string, ResourceSpan> m_Overrides;
+
+    bool loadOverride(const std::string& name);
+
+public:
+
+    // archive may be null
+    ShaderLibrary(ResourceCache* cache, AssetArchive* archive, std::string overrideDirectory, ResourceAccess access);
+
+    // The returned binary stays valid as long as the library, or until the shader is replaced
+    ShaderBinary get(const std::string& name);
+
+    // Makes code the version served from now on, e.g. after a hot reload
+    ShaderBinary replace(const std::string& name, ResourceSpan code);
+};
@@ -0,0 +1,222 @@
+#include "FrameBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "Log.h"
+#include "Statistics.h"
+
+static int64_t now() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+static double toSeconds(int64_t ticks) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::duration(ticks)).count();
+}
+
+// The baseline is a file this class wrote, so finding "series": { ... "key": value ... } is all the parsing needed
+static bool findValue(const std::string& json, const char* series, const char* key, double& value) {
+    size_t begin = 0, end = json.size();
+    if (series != nullptr) {
+        begin = json.find(std::string("\"") + series + "\"");
+        if (begin == std::string::npos) {
+            return false;
+        }
+        end = json.find('}', begin);
+    }
+
+    size_t found = json.find(std::string("\"") + key + "\"", begin);
+    if (found == std::string::npos || found > end) {
+        return false;
+    }
+    size_t colon = json.find(':', found);
+    if (colon == std::string::npos) {
+        return false;
+    }
+
+    const char* start = json.c_str() + colon + 1;
+    char* parsed = nullptr;
+    value = std::strtod(start, &parsed);
+    return parsed != start;
+}
+
+static void writeSeries(std::ofstream& file, const BenchmarkSeries& series) {
+    file << "\t\t\"" << series.name << "\": { \"samples\": " << series.samples
+         << ", \"min\": " << series.min << ", \"avg\": " << series.average
+         << ", \"p50\": " << series.p50 << ", \"p95\": " << series.p95
+         << ", \"p99\": " << series.p99 << ", \"max\": " << series.max << " }";
+}
+
+FrameBenchmark::FrameBenchmark(BenchmarkSettings settings) : m_Settings{ std::move(settings) } {
+    size_t expected = m_Settings.seconds > 0.0 ? 1024 : m_Settings.frames;
+    m_Work.reserve(expected);
+    m_Gpu.reserve(expected);
+    m_Present.reserve(expected);
+
+    if (m_Settings.seconds > 0.0) {
+        Log::info("Benchmark: {} warm-up frames, then {} seconds", m_Settings.warmupFrames, m_Settings.seconds);
+    }
+    else {
+        Log::info("Benchmark: {} warm-up frames, then {} frames", m_Settings.warmupFrames, m_Settings.frames);
+    }
+}
+
+void FrameBenchmark::record(const FrameSample& sample) {
+    if (finished()) {
+        return;
+    }
+
+    m_Seen++;
+    if (m_Seen <= m_Settings.warmupFrames) {
+        return;
+    }
+    if (m_Start == 0) {
+        // the first measured frame has no present interval within the measured window, so it only starts the clock
+        m_Start = now();
+        m_End = m_Start;
+        Log::debug("Benchmark Warm-Up Done");
+        return;
+    }
+
+    m_Work.push_back(sample.workMilliseconds);
+    m_Present.push_back(sample.presentMilliseconds);
+    if (sample.hasGpuTime) {
+        m_Gpu.push_back(sample.gpuMilliseconds);
+    }
+    m_End = now();
+}
+
+bool FrameBenchmark::finished() const {
+    if (m_Start == 0) {
+        return false;
+    }
+    if (m_Settings.seconds > 0.0) {
+        return toSeconds(m_End - m_Start) >= m_Settings.seconds;
+    }
+    return m_Work.size() >= m_Settings.frames;
+}
+
+BenchmarkSeries FrameBenchmark::summarize(const char* name, std::vector<double> samples) {
+    BenchmarkSeries series;
+    series.name = name;
+    series.samples = samples.size();
+    if (samples.empty()) {
+        return series;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+
+    series.min = samples.front();
+    series.average = sum / samples.size();
+    series.p50 = percentile(samples, 0.50);
+    series.p95 = percentile(samples, 0.95);
+    series.p99 = percentile(samples, 0.99);
+    series.max = samples.back();
+    return series;
+}
+
+bool FrameBenchmark::report(const std::string& deviceName, uint32_t width, uint32_t height, bool headless) {
+    double seconds = toSeconds(m_End - m_Start);
+    double framesPerSecond = seconds > 0.0 ? m_Work.size() / seconds : 0.0;
+
+    std::vector<BenchmarkSeries> series = {
+        summarize("cpu_work_ms", m_Work),
+        summarize("present_ms", m_Present),
+    };
+    if (!m_Gpu.empty()) {
+        series.push_back(summarize("gpu_ms", m_Gpu));
+    }
+
+    Log::info("Benchmark Results ({} frames in {} s, {} fps):", m_Work.size(), seconds, framesPerSecond);
+    for (const auto& entry : series) {
+        Log::info("\t{}: min {}, avg {}, p50 {}, p95 {}, p99 {}, max {}", entry.name, entry.min, entry.average, entry.p50, entry.p95, entry.p99, entry.max);
+    }
+
+    if (!m_Settings.outputPath.empty()) {
+        std::ofstream file(m_Settings.outputPath, std::ios::trunc);
+        if (!file) {
+            Log::warn("Failed To Write Benchmark Results \"{}\"", m_Settings.outputPath);
+        }
+        else {
+            std::string device;
+            for (char c : deviceName) {
+                if (c == '"' || c == '\\') {
+                    device += '\\';
+                }
+                device += c;
+            }
+
+            file << "{\n";
+            file << "\t\"device\": \"" << device << "\",\n";
+            file << "\t\"width\": " << width << ",\n";
+            file << "\t\"height\": " << height << ",\n";
+            file << "\t\"headless\": " << (headless ? "true" : "false") << ",\n";
+            file << "\t\"warmup_frames\": " << m_Settings.warmupFrames << ",\n";
+            file << "\t\"frames\": " << m_Work.size() << ",\n";
+            file << "\t\"seconds\": " << seconds << ",\n";
+            file << "\t\"fps\": " << framesPerSecond << ",\n";
+            file << "\t\"series\": {\n";
+            for (size_t i = 0; i < series.size(); i++) {
+                writeSeries(file, series[i]);
+                file << (i + 1 < series.size() ? ",\n" : "\n");
+            }
+            file << "\t}\n}\n";
+            Log::info("Wrote Benchmark Results \"{}\"", m_Settings.outputPath);
+        }
+    }
+
+    if (m_Settings.baselinePath.empty()) {
+        return true;
+    }
+    return compare(series, framesPerSecond);
+}
+
+bool FrameBenchmark::compare(const std::vector<BenchmarkSeries>& series, double framesPerSecond) {
+    std::ifstream file(m_Settings.baselinePath);
+    if (!file) {
+        Log::warn("Failed To Open Benchmark Baseline \"{}\"", m_Settings.baselinePath);
+        return true;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string json = contents.str();
+
+    bool passed = true;
+    auto check = [&](const char* seriesName, const char* key, double current, bool higherIsWorse) {
+        double baseline;
+        if (!findValue(json, seriesName, key, baseline) || baseline <= 0.0) {
+            return;
+        }
+
+        std::string label = seriesName ? std::string(seriesName) + " " + key : key;
+        double change = (current - baseline) / baseline;
+        bool regressed = higherIsWorse ? change > m_Settings.threshold : -change > m_Settings.threshold;
+        if (regressed) {
+            Log::error("Benchmark Regression: {} {} -> {} ({}%)", label, baseline, current, change * 100.0);
+            passed = false;
+        }
+        else {
+            Log::debug("Benchmark: {} {} -> {} ({}%)", label, baseline, current, change * 100.0);
+        }
+    };
+
+    for (const auto& entry : series) {
+        check(entry.name, "avg", entry.average, true);
+        check(entry.name, "p50", entry.p50, true);
+        check(entry.name, "p95", entry.p95, true);
+        check(entry.name, "p99", entry.p99, true);
+    }
+    check(nullptr, "fps", framesPerSecond, false);
+
+    if (passed) {
+        Log::info("Benchmark Within {}% Of Baseline \"{}\"", m_Settings.threshold * 100.0, m_Settings.baselinePath);
+    }
+    return passed;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FrameMetrics.h"
+
+struct BenchmarkSettings {
+    // frames completed before measuring starts (pipeline compiles, cache warm-up, clock ramp)
+    uint32_t warmupFrames = 30;
+    // measured frames; ignored when seconds is set
+    uint32_t frames = 300;
+    double seconds = 0.0;
+    std::string outputPath;
+    // a previous run's output to compare against; empty skips the comparison
+    std::string baselinePath;
+    // how much worse than the baseline a statistic may get, as a fraction (0.05 = 5%)
+    double threshold = 0.05;
+};
+
+// Summary of one measured series, in milliseconds
+struct BenchmarkSeries {
+    const char* name;
+    size_t samples = 0;
+    double min = 0.0;
+    double average = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+// Fixed-length frame benchmark fed with completed FrameMetrics samples. After the warm-up it keeps every sample's
+// CPU work, GPU and present-to-present times, then writes min/avg/percentiles and throughput as JSON and checks
+// them against a baseline file written by an earlier run.
+class FrameBenchmark
+{
+private:
+
+    BenchmarkSettings m_Settings;
+    uint64_t m_Seen = 0;
+    int64_t m_Start = 0;
+    int64_t m_End = 0;
+    std::vector<double> m_Work;
+    std::vector<double> m_Gpu;
+    std::vector<double> m_Present;
+
+    static BenchmarkSeries summarize(const char* name, std::vector<double> samples);
+    bool compare(const std::vector<BenchmarkSeries>& series, double framesPerSecond);
+
+public:
+
+    FrameBenchmark(BenchmarkSettings settings);
+
+    void record(const FrameSample& sample);
+    bool finished() const;
+
+    // Prints and writes the results. Returns false if any statistic regressed past the threshold.
+    bool report(const std::string& deviceName, uint32_t width, uint32_t height, bool headless);
+};
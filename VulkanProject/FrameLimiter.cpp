@@ -0,0 +1,227 @@
+#include "FrameLimiter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "Log.h"
+#include "Statistics.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <time.h>
+#endif
+
+// the margin starts here and follows the timer's measured oversleep: mean plus this many standard deviations
+const double INITIAL_MARGIN_MILLISECONDS = 1.0;
+const double MIN_MARGIN_MILLISECONDS = 0.05;
+const double MARGIN_DEVIATIONS = 3.0;
+const double OVERSLEEP_SMOOTHING = 0.05;
+// frames starting later than this fraction of a period past their deadline count as late
+const double LATE_FRACTION = 0.1;
+
+static int64_t now() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+static double milliseconds(int64_t ticks) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::duration(ticks)).count();
+}
+
+static int64_t ticks(double milliseconds) {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(milliseconds)).count();
+}
+
+#ifdef _WIN32
+
+static double processCpuSeconds() {
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    auto toTicks = [](const FILETIME& time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    // 100 ns units
+    return (toTicks(kernel) + toTicks(user)) * 1e-7;
+}
+
+FrameLimiter::FrameLimiter(double framesPerSecond, bool plainSleep)
+    : m_FramesPerSecond{ framesPerSecond }, m_Period{ ticks(1000.0 / framesPerSecond) }, m_PlainSleep{ plainSleep }, m_Margin{ INITIAL_MARGIN_MILLISECONDS } {
+    m_Intervals.reserve(FRAME_LIMITER_HISTORY);
+    // Sleep() only wakes on the (default 15.6 ms) scheduler tick; high resolution timers need Windows 10 1803
+    m_Timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!m_Timer) {
+        Log::debug("High Resolution Timer Unavailable, Frame Limiter Will Spin More");
+        m_Timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+}
+
+void FrameLimiter::destroy() {
+    if (m_Timer) {
+        CloseHandle(m_Timer);
+        m_Timer = nullptr;
+    }
+}
+
+void FrameLimiter::sleepFor(int64_t duration) {
+    // relative due times are negative, in 100 ns units
+    LARGE_INTEGER due;
+    due.QuadPart = -std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::duration(duration)).count() / 100);
+    if (m_Timer && SetWaitableTimer(m_Timer, &due, 0, nullptr, nullptr, FALSE)) {
+        WaitForSingleObject(m_Timer, INFINITE);
+    }
+    else {
+        std::this_thread::sleep_for(std::chrono::steady_clock::duration(duration));
+    }
+}
+
+#else
+
+static double processCpuSeconds() {
+    timespec time;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time) != 0) {
+        return 0.0;
+    }
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+FrameLimiter::FrameLimiter(double framesPerSecond, bool plainSleep)
+    : m_FramesPerSecond{ framesPerSecond }, m_Period{ ticks(1000.0 / framesPerSecond) }, m_PlainSleep{ plainSleep }, m_Margin{ INITIAL_MARGIN_MILLISECONDS } {
+    m_Intervals.reserve(FRAME_LIMITER_HISTORY);
+}
+
+void FrameLimiter::destroy() {
+}
+
+void FrameLimiter::sleepFor(int64_t duration) {
+    std::this_thread::sleep_for(std::chrono::steady_clock::duration(duration));
+}
+
+#endif
+
+void FrameLimiter::addInterval(double interval) {
+    if (m_Intervals.size() < FRAME_LIMITER_HISTORY) {
+        m_Intervals.push_back(interval);
+    }
+    else {
+        m_Intervals[m_Next] = interval;
+    }
+    m_Next = (m_Next + 1) % FRAME_LIMITER_HISTORY;
+}
+
+void FrameLimiter::wait() {
+    int64_t time = now();
+    bool resumed = !m_Started || m_Restart;
+    if (!m_Started) {
+        m_Started = true;
+        m_Deadline = time;
+        m_RunStart = time;
+        m_CpuStart = processCpuSeconds();
+    }
+    else if (m_Restart) {
+        // still no sooner than a period after the last frame, so a short pause can't push past the cap
+        m_Restart = false;
+        m_Deadline = std::max(time, m_LastFrame + m_Period);
+    }
+
+    if (time < m_Deadline) {
+        // coarse part: the OS timer, stopping the margin short of the deadline unless only sleeping
+        int64_t wake = m_PlainSleep ? m_Deadline : m_Deadline - ticks(m_Margin);
+        if (time < wake) {
+            sleepFor(wake - time);
+            time = now();
+            m_Sleeps++;
+
+            double oversleep = std::max(0.0, milliseconds(time - wake));
+            double delta = oversleep - m_OversleepMean;
+            m_OversleepMean += OVERSLEEP_SMOOTHING * delta;
+            m_OversleepVariance = (1.0 - OVERSLEEP_SMOOTHING) * (m_OversleepVariance + OVERSLEEP_SMOOTHING * delta * delta);
+            m_OversleepMax = std::max(m_OversleepMax, oversleep);
+            m_Margin = std::clamp(m_OversleepMean + MARGIN_DEVIATIONS * std::sqrt(m_OversleepVariance), MIN_MARGIN_MILLISECONDS, milliseconds(m_Period));
+            if (Trace::enabled()) {
+                Trace::counter("Frame Limiter (ms)", "oversleep", oversleep);
+                Trace::counter("Frame Limiter (ms)", "margin", m_Margin);
+            }
+        }
+
+        // fine part: spin the rest of the way
+        if (!m_PlainSleep) {
+            int64_t spinStart = time;
+            while (time < m_Deadline) {
+                std::this_thread::yield();
+                time = now();
+            }
+            m_SpinMilliseconds += milliseconds(time - spinStart);
+        }
+    }
+
+    if (!resumed) {
+        double interval = milliseconds(time - m_LastFrame);
+        addInterval(interval);
+        if (Trace::enabled()) {
+            Trace::counter("Frame Limiter (ms)", "interval", interval);
+        }
+    }
+    if (milliseconds(time - m_Deadline) > LATE_FRACTION * milliseconds(m_Period)) {
+        m_Late++;
+    }
+    m_Frames++;
+    m_LastFrame = time;
+
+    // a frame that fell more than a period behind restarts the schedule instead of bursting to catch up
+    if (time - m_Deadline > m_Period) {
+        m_Deadline = time;
+    }
+    m_Deadline += m_Period;
+}
+
+void FrameLimiter::restart() {
+    m_Restart = true;
+}
+
+void FrameLimiter::printStats() {
+    if (m_Intervals.empty()) {
+        return;
+    }
+
+    double target = milliseconds(m_Period);
+    double sum = 0.0;
+    for (double interval : m_Intervals) {
+        sum += interval;
+    }
+    double average = sum / m_Intervals.size();
+
+    std::vector<double> errors;
+    errors.reserve(m_Intervals.size());
+    double squares = 0.0;
+    for (double interval : m_Intervals) {
+        errors.push_back(std::abs(interval - target));
+        squares += (interval - average) * (interval - average);
+    }
+    std::sort(errors.begin(), errors.end());
+    double p99 = percentile(errors, 0.99);
+
+    // CPU time of the whole process while limited, in percent of one core
+    double wallSeconds = milliseconds(now() - m_RunStart) / 1000.0;
+    double cpu = wallSeconds > 0.0 ? (processCpuSeconds() - m_CpuStart) / wallSeconds * 100.0 : 0.0;
+
+    Log::info("Frame Limiter ({} fps cap, {}, last {} of {} frames):", m_FramesPerSecond, m_PlainSleep ? "plain sleep" : "sleep and spin", m_Intervals.size(), m_Frames);
+    Log::info("\tInterval: {} ms avg (target {} ms), {} ms std dev, {} ms p99 error, {} late frames", average, target, std::sqrt(squares / m_Intervals.size()), p99, m_Late);
+    Log::info("\tOversleep: {} ms avg, {} ms max over {} sleeps", m_OversleepMean, m_OversleepMax, m_Sleeps);
+    if (m_PlainSleep) {
+        Log::info("\tCPU: process at {}% of a core", cpu);
+    }
+    else {
+        Log::info("\tCPU: {} ms spinning per frame ({} ms margin), process at {}% of a core", m_SpinMilliseconds / m_Frames, m_Margin, cpu);
+    }
+}
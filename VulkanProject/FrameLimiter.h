@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const size_t FRAME_LIMITER_HISTORY = 1000;
+
+// Caps the frame rate without relying on vsync, so mailbox or immediate presentation can run at an exact rate.
+// Every frame has a deadline one period after the last one's. wait() sleeps on an OS timer until shortly before
+// it and spins for the rest; the margin left for spinning follows how much the timer has been oversleeping, so it
+// stays as small (and as cheap in CPU time) as the timer allows. With plainSleep it only sleeps, for comparison.
+// Frame intervals, oversleep, spin time and process CPU usage are reported on exit.
+class FrameLimiter
+{
+private:
+
+    double m_FramesPerSecond;
+    int64_t m_Period;
+    bool m_PlainSleep;
+    // high resolution waitable timer on Windows
+    void* m_Timer = nullptr;
+
+    bool m_Started = false;
+    bool m_Restart = false;
+    int64_t m_Deadline = 0;
+    int64_t m_LastFrame = 0;
+    int64_t m_RunStart = 0;
+    double m_CpuStart = 0.0;
+
+    // running mean and variance of the timer's oversleep, in ms
+    double m_OversleepMean = 0.0;
+    double m_OversleepVariance = 0.0;
+    double m_OversleepMax = 0.0;
+    double m_Margin;
+
+    std::vector<double> m_Intervals;
+    size_t m_Next = 0;
+    uint64_t m_Frames = 0;
+    uint64_t m_Late = 0;
+    uint64_t m_Sleeps = 0;
+    double m_SpinMilliseconds = 0.0;
+
+    void sleepFor(int64_t duration);
+    void addInterval(double interval);
+
+public:
+
+    FrameLimiter(double framesPerSecond, bool plainSleep);
+
+    void destroy();
+
+    // Blocks until the next frame may start
+    void wait();
+    // Call when frames paused for a reason of their own (idle or throttled): the next frame starts a new schedule
+    // instead of counting as late, and the gap isn't counted as an interval
+    void restart();
+
+    void printStats();
+};
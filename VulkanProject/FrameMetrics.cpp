@@ -0,0 +1,178 @@
+#include "FrameMetrics.h"
+
+#include <chrono>
+
+#include "Log.h"
+#include "Trace.h"
+
+const size_t FRAME_METRICS_HISTORY = 240;
+
+DrawCounters& DrawCounters::operator+=(const DrawCounters& other) {
+    draws += other.draws;
+    vertices += other.vertices;
+    pipelineBinds += other.pipelineBinds;
+    return *this;
+}
+
+FrameMetrics::FrameMetrics(uint32_t framesInFlight, std::string csvPath)
+    : m_InFlight(framesInFlight), m_Submitted(framesInFlight, false), m_Path{ std::move(csvPath) } {
+    m_History.reserve(FRAME_METRICS_HISTORY);
+
+    if (m_Path.empty()) {
+        return;
+    }
+
+    m_File.open(m_Path, std::ios::trunc);
+    if (!m_File) {
+        Log::warn("Failed To Open Metrics File \"{}\"", m_Path);
+        return;
+    }
+    m_File << "frame,cpu_ms,cpu_work_ms,present_ms,gpu_ms,draws,vertices,pipeline_binds,pixels,"
+              "ia_vertices,ia_primitives,vs_invocations,clip_invocations,clip_primitives,fs_invocations,overdraw\n";
+    Log::info("Writing Frame Metrics To \"{}\"", m_Path);
+}
+
+void FrameMetrics::beginFrame() {
+    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    if (m_LastFrameStart != 0) {
+        m_FrameInterval = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::duration(now - m_LastFrameStart)).count();
+    }
+    m_LastFrameStart = now;
+    m_Waited = 0;
+}
+
+void FrameMetrics::beginWait() {
+    m_WaitStart = std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+void FrameMetrics::endWait() {
+    m_Waited += std::chrono::steady_clock::now().time_since_epoch().count() - m_WaitStart;
+}
+
+void FrameMetrics::submit(uint32_t frame, uint64_t serial, const DrawCounters& counters, uint64_t pixels) {
+    FrameSample& sample = m_InFlight[frame];
+    sample = FrameSample{};
+    sample.serial = serial;
+    sample.cpuMilliseconds = m_FrameInterval;
+    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    sample.workMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::duration(now - m_LastFrameStart - m_Waited)).count();
+    sample.counters = counters;
+    sample.pixels = pixels;
+    m_Submitted[frame] = true;
+}
+
+void FrameMetrics::present(uint32_t frame) {
+    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    if (m_LastPresent != 0) {
+        m_InFlight[frame].presentMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::duration(now - m_LastPresent)).count();
+    }
+    m_LastPresent = now;
+}
+
+const FrameSample* FrameMetrics::complete(uint32_t frame, const GpuFrameResult& gpu) {
+    if (!m_Submitted[frame]) {
+        return nullptr;
+    }
+    m_Submitted[frame] = false;
+
+    FrameSample& sample = m_InFlight[frame];
+    sample.hasGpuTime = gpu.valid;
+    sample.gpuMilliseconds = gpu.frameMilliseconds;
+    sample.hasStatistics = gpu.hasStatistics;
+    sample.statistics = gpu.statistics;
+
+    if (m_History.size() < FRAME_METRICS_HISTORY) {
+        m_History.push_back(sample);
+    }
+    else {
+        m_History[m_Next] = sample;
+    }
+    m_Next = (m_Next + 1) % FRAME_METRICS_HISTORY;
+    m_Completed++;
+
+    if (Trace::enabled()) {
+        Trace::counter("Frame Time (ms)", "cpu", sample.cpuMilliseconds);
+        Trace::counter("Frame Time (ms)", "cpu work", sample.workMilliseconds);
+        Trace::counter("Frame Time (ms)", "present", sample.presentMilliseconds);
+        Trace::counter("Draw Work", "draws", static_cast<double>(sample.counters.draws));
+        Trace::counter("Draw Work", "vertices", static_cast<double>(sample.counters.vertices));
+        Trace::counter("Draw Work", "pipeline binds", static_cast<double>(sample.counters.pipelineBinds));
+        if (sample.hasStatistics) {
+            Trace::counter("Pipeline Statistics", "vertex shader invocations", static_cast<double>(sample.statistics.vertexShaderInvocations));
+            Trace::counter("Pipeline Statistics", "clipping primitives", static_cast<double>(sample.statistics.clippingPrimitives));
+            Trace::counter("Pipeline Statistics", "fragment shader invocations", static_cast<double>(sample.statistics.fragmentShaderInvocations));
+        }
+    }
+
+    if (m_File) {
+        write(sample);
+    }
+    return &sample;
+}
+
+void FrameMetrics::write(const FrameSample& sample) {
+    m_File << sample.serial << ',' << sample.cpuMilliseconds << ',' << sample.workMilliseconds << ',' << sample.presentMilliseconds << ',';
+    if (sample.hasGpuTime) {
+        m_File << sample.gpuMilliseconds;
+    }
+    m_File << ',' << sample.counters.draws << ',' << sample.counters.vertices << ',' << sample.counters.pipelineBinds << ',' << sample.pixels << ',';
+
+    if (sample.hasStatistics) {
+        const PipelineStatistics& statistics = sample.statistics;
+        double overdraw = sample.pixels != 0 ? static_cast<double>(statistics.fragmentShaderInvocations) / sample.pixels : 0.0;
+        m_File << statistics.inputAssemblyVertices << ',' << statistics.inputAssemblyPrimitives << ','
+               << statistics.vertexShaderInvocations << ',' << statistics.clippingInvocations << ','
+               << statistics.clippingPrimitives << ',' << statistics.fragmentShaderInvocations << ',' << overdraw;
+    }
+    else {
+        m_File << ",,,,,,";
+    }
+    m_File << '\n';
+}
+
+void FrameMetrics::printSummary() {
+    if (m_History.empty()) {
+        return;
+    }
+
+    double cpu = 0.0, gpu = 0.0, draws = 0.0, vertices = 0.0, binds = 0.0;
+    size_t gpuFrames = 0, statisticsFrames = 0;
+    PipelineStatistics statistics;
+    uint64_t statisticsPixels = 0;
+
+    for (const auto& sample : m_History) {
+        cpu += sample.cpuMilliseconds;
+        draws += sample.counters.draws;
+        vertices += static_cast<double>(sample.counters.vertices);
+        binds += sample.counters.pipelineBinds;
+        if (sample.hasGpuTime) {
+            gpu += sample.gpuMilliseconds;
+            gpuFrames++;
+        }
+        if (sample.hasStatistics) {
+            statistics += sample.statistics;
+            statisticsPixels += sample.pixels;
+            statisticsFrames++;
+        }
+    }
+
+    double frames = static_cast<double>(m_History.size());
+    Log::info("Frame Metrics (last {} of {} frames, per frame):", m_History.size(), m_Completed);
+    Log::info("\tCPU Frame Time: {} ms", cpu / frames);
+    if (gpuFrames != 0) {
+        Log::info("\tGPU Frame Time: {} ms", gpu / gpuFrames);
+    }
+    Log::info("\tDraws: {}, Vertices: {}, Pipeline Binds: {}", draws / frames, vertices / frames, binds / frames);
+
+    if (statisticsFrames != 0) {
+        double count = static_cast<double>(statisticsFrames);
+        Log::info("\tInput Assembly: {} vertices, {} primitives", statistics.inputAssemblyVertices / count, statistics.inputAssemblyPrimitives / count);
+        Log::info("\tVertex Shader Invocations: {} ({} per input vertex)", statistics.vertexShaderInvocations / count,
+            statistics.inputAssemblyVertices != 0 ? static_cast<double>(statistics.vertexShaderInvocations) / statistics.inputAssemblyVertices : 0.0);
+        Log::info("\tClipping: {} primitives in, {} out ({} of input primitives never reached the clipper)",
+            statistics.clippingInvocations / count, statistics.clippingPrimitives / count,
+            statistics.inputAssemblyPrimitives != 0 ? 1.0 - static_cast<double>(statistics.clippingInvocations) / statistics.inputAssemblyPrimitives : 0.0);
+        Log::info("\tFragment Shader Invocations: {} (overdraw {}x)", statistics.fragmentShaderInvocations / count,
+            statisticsPixels != 0 ? static_cast<double>(statistics.fragmentShaderInvocations) / statisticsPixels : 0.0);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "GpuProfiler.h"
+
+// CPU-side work recorded into one command buffer. Kept per command buffer and added to a frame's totals each time
+// that buffer is submitted, so pre-recorded buffers are still counted every frame.
+struct DrawCounters {
+    uint32_t draws = 0;
+    uint64_t vertices = 0;
+    uint32_t pipelineBinds = 0;
+
+    DrawCounters& operator+=(const DrawCounters& other);
+};
+
+// Everything measured about one frame. GPU fields are only filled in when the profiler was running.
+struct FrameSample {
+    uint64_t serial = 0;
+    // interval between the starts of this frame and the previous one
+    double cpuMilliseconds = 0.0;
+    // CPU time spent on the frame up to its submission, not counting time blocked on fences or acquire
+    double workMilliseconds = 0.0;
+    // interval between this frame's present and the previous one (its submission when headless)
+    double presentMilliseconds = 0.0;
+    bool hasGpuTime = false;
+    double gpuMilliseconds = 0.0;
+    DrawCounters counters;
+    uint64_t pixels = 0;
+    bool hasStatistics = false;
+    PipelineStatistics statistics;
+};
+
+// The per-frame metrics stream. A frame is started when it is submitted and completed once its fence has
+// signalled and its GPU queries were read back; completed frames go to a rolling window for the exit summary, to
+// the trace as counters and, if a path was given, to a CSV file with one row per frame.
+class FrameMetrics
+{
+private:
+
+    std::vector<FrameSample> m_InFlight;
+    std::vector<bool> m_Submitted;
+    std::vector<FrameSample> m_History;
+    size_t m_Next = 0;
+    uint64_t m_Completed = 0;
+    int64_t m_LastFrameStart = 0;
+    double m_FrameInterval = 0.0;
+    int64_t m_WaitStart = 0;
+    int64_t m_Waited = 0;
+    int64_t m_LastPresent = 0;
+
+    std::string m_Path;
+    std::ofstream m_File;
+
+    void write(const FrameSample& sample);
+
+public:
+
+    FrameMetrics(uint32_t framesInFlight, std::string csvPath);
+
+    // Call at the top of every frame; measures the CPU frame time as the interval between calls
+    void beginFrame();
+    // Bracket calls that block on the GPU or the presentation engine so they aren't counted as CPU work
+    void beginWait();
+    void endWait();
+    void submit(uint32_t frame, uint64_t serial, const DrawCounters& counters, uint64_t pixels);
+    // Call once frame has been presented, or right after submit when there is nothing to present
+    void present(uint32_t frame);
+    // Call after frame's fence signalled, with what the GPU profiler read back for it. Returns the completed
+    // sample (valid until frame is submitted again), or nullptr if nothing was in flight.
+    const FrameSample* complete(uint32_t frame, const GpuFrameResult& gpu);
+
+    void printSummary();
+};
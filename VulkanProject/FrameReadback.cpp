@@ -0,0 +1,517 @@
+#include "FrameReadback.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include "Log.h"
+#include "Trace.h"
+
+// Frames waiting for the worker before new ones are dropped
+const size_t READBACK_MAX_QUEUED = 4;
+
+static uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    return UINT32_MAX;
+}
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256] = {};
+    if (table[1] == 0) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static void writeChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    appendBigEndian(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    appendBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+}
+
+// Uncompressed PNG (zlib stored blocks): writing it is a copy, which keeps the worker well ahead of the frame rate
+static void writePng(std::ofstream& file, const std::vector<uint8_t>& rgb, uint32_t width, uint32_t height) {
+    const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });
+    writeChunk(file, "IHDR", header);
+
+    // every scanline starts with filter type 0
+    size_t stride = size_t{ width } * 3;
+    std::vector<uint8_t> raw;
+    raw.reserve((stride + 1) * height);
+    for (uint32_t y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb.begin() + y * stride, rgb.begin() + (y + 1) * stride);
+    }
+
+    std::vector<uint8_t> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    for (size_t offset = 0; offset < raw.size(); offset += 65535) {
+        size_t size = std::min<size_t>(65535, raw.size() - offset);
+        bool last = offset + size >= raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(size));
+        zlib.push_back(static_cast<uint8_t>(size >> 8));
+        zlib.push_back(static_cast<uint8_t>(~size));
+        zlib.push_back(static_cast<uint8_t>(~size >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+    }
+
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+    writeChunk(file, "IDAT", zlib);
+    writeChunk(file, "IEND", {});
+}
+
+FrameReadback::FrameReadback(RenderDevice& renderDevice, uint32_t session, uint32_t framesInFlight, VkExtent2D extent, ReadbackOutput output, std::string directory, uint32_t every)
+    : m_RenderDevice{ renderDevice }, m_Session{ session }, m_Device{ renderDevice.getDevice() }, m_Frames(framesInFlight), m_Output{ output }, m_Directory{ std::move(directory) }, m_Every{ every > 0 ? every : 1 } {
+    std::error_code error;
+    if (m_Output != ReadbackOutput::Stream) {
+        std::filesystem::create_directories(m_Directory, error);
+    }
+    if (error) {
+        throw std::runtime_error("failed to create readback directory \"" + m_Directory + "\"!");
+    }
+
+    if (m_Output == ReadbackOutput::Hash) {
+        std::string path = (std::filesystem::path(m_Directory) / "hashes.txt").string();
+        m_HashFile.open(path, std::ios::trunc);
+        if (!m_HashFile) {
+            throw std::runtime_error("failed to open \"" + path + "\"!");
+        }
+    }
+
+    createBuffers(extent);
+    m_Worker = std::thread(&FrameReadback::workerLoop, this);
+    if (m_Output != ReadbackOutput::Stream) {
+        Log::info("Reading Back Every {} Frame(s) To \"{}\" ({} staging buffers, {})", m_Every, m_Directory, framesInFlight, m_Coherent ? "coherent" : "cached");
+    }
+}
+
+void FrameReadback::stream(std::unique_ptr<FrameSink> sink, bool i420, bool block) {
+    m_Sink = std::move(sink);
+    m_StreamI420 = i420;
+    m_BlockWhenBehind = block;
+    Log::info("Streaming Every {} Frame(s) As {} ({} staging buffers, {}, {} when behind)", m_Every, i420 ? "I420" : "RGBA", m_Frames.size(), m_Coherent ? "coherent" : "cached", block ? "block" : "drop");
+}
+
+void FrameReadback::blockWhenBehind() {
+    m_BlockWhenBehind = true;
+}
+
+FrameReadback::~FrameReadback() {
+    stopWorker();
+}
+
+void FrameReadback::createBuffers(VkExtent2D extent) {
+    m_Size = VkDeviceSize{ extent.width } * extent.height * 4;
+
+    for (auto& staging : m_Frames) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = m_Size;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(m_Device, &bufferInfo, nullptr, &staging.buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create readback buffer!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(m_Device, staging.buffer, &memRequirements);
+
+        // CPU reads of uncached memory are very slow, so prefer cached and invalidate by hand
+        uint32_t memoryType = findMemoryType(m_RenderDevice.getPhysicalDevice(), memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        m_Coherent = false;
+        if (memoryType == UINT32_MAX) {
+            memoryType = findMemoryType(m_RenderDevice.getPhysicalDevice(), memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            m_Coherent = true;
+        }
+        if (memoryType == UINT32_MAX) {
+            throw std::runtime_error("failed to find suitable memory type!");
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        if (m_RenderDevice.allocateMemory(m_Session, allocInfo, &staging.memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate readback buffer memory!");
+        }
+        vkBindBufferMemory(m_Device, staging.buffer, staging.memory, 0);
+        vkMapMemory(m_Device, staging.memory, 0, VK_WHOLE_SIZE, 0, &staging.mapped);
+        staging.pending = false;
+    }
+}
+
+void FrameReadback::destroyBuffers() {
+    for (auto& staging : m_Frames) {
+        if (staging.memory != VK_NULL_HANDLE) {
+            vkUnmapMemory(m_Device, staging.memory);
+        }
+        vkDestroyBuffer(m_Device, staging.buffer, nullptr);
+        m_RenderDevice.freeMemory(staging.memory);
+        staging = Staging{};
+    }
+}
+
+bool FrameReadback::wants(uint64_t serial) const {
+    return serial % m_Every == 0;
+}
+
+void FrameReadback::recordCopy(VkCommandBuffer commandBuffer, uint32_t frame, uint64_t serial, VkImage image, VkFormat format, VkExtent2D extent, VkImageLayout layout, const std::string& name) {
+    bool bgra = format == VK_FORMAT_B8G8R8A8_SRGB || format == VK_FORMAT_B8G8R8A8_UNORM;
+    bool rgba = format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_R8G8B8A8_UNORM;
+    if (!bgra && !rgba) {
+        if (!m_WarnedFormat) {
+            Log::warn("Readback Skipped: Unsupported Image Format {}", format);
+            m_WarnedFormat = true;
+        }
+        return;
+    }
+    if (VkDeviceSize{ extent.width } * extent.height * 4 > m_Size) {
+        return;
+    }
+
+    Staging& staging = m_Frames[frame];
+    if (m_Sink) {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if (staging.busy && !m_BlockWhenBehind) {
+            m_Dropped++;
+            return;
+        }
+        m_StagingReturned.wait(lock, [&staging] { return !staging.busy; });
+    }
+
+    staging.pending = true;
+    staging.timestamp = streamTimestamp();
+    staging.serial = serial;
+    staging.width = extent.width;
+    staging.height = extent.height;
+    staging.bgra = bgra;
+    staging.name = name;
+
+    // Moves the image to TRANSFER_SRC if it isn't there already. The render pass' output dependency (or the upscale
+    // blit's barrier) makes the image's writes and final transition available to the transfer stage, so waiting on
+    // that stage chains onto it; the color attachment stage covers a target without either.
+    VkImageMemoryBarrier toTransfer{};
+    toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    toTransfer.oldLayout = layout;
+    toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.image = image;
+    toTransfer.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    toTransfer.subresourceRange.levelCount = 1;
+    toTransfer.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { extent.width, extent.height, 1 };
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, staging.buffer, 1, &region);
+
+    if (layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+        VkImageMemoryBarrier restore = toTransfer;
+        restore.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        restore.dstAccessMask = 0;
+        restore.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        restore.newLayout = layout;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &restore);
+    }
+
+    VkBufferMemoryBarrier toHost{};
+    toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.buffer = staging.buffer;
+    toHost.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &toHost, 0, nullptr);
+}
+
+// Host-cached memory has to be invalidated before the CPU can see what the GPU wrote
+void FrameReadback::invalidate(const Staging& staging) {
+    if (m_Coherent) {
+        return;
+    }
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = staging.memory;
+    range.offset = 0;
+    range.size = VK_WHOLE_SIZE;
+    vkInvalidateMappedMemoryRanges(m_Device, 1, &range);
+}
+
+void FrameReadback::collect(uint32_t frame) {
+    collect(frame, m_BlockWhenBehind);
+}
+
+void FrameReadback::collect(uint32_t frame, bool wait) {
+    Staging& staging = m_Frames[frame];
+    if (!staging.pending) {
+        return;
+    }
+    staging.pending = false;
+    TRACE_SCOPE("FrameReadback::collect", "readback");
+
+    ReadbackFrame readback;
+    readback.serial = staging.serial;
+    readback.width = staging.width;
+    readback.height = staging.height;
+    readback.bgra = staging.bgra;
+    readback.timestamp = staging.timestamp;
+    readback.name = std::move(staging.name);
+
+    if (m_Sink) {
+        invalidate(staging);
+        readback.mapped = static_cast<const uint8_t*>(staging.mapped);
+        readback.staging = frame;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            staging.busy = true;
+            m_Queue.push_back(std::move(readback));
+        }
+        m_FrameAvailable.notify_one();
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if (wait) {
+            m_SpaceAvailable.wait(lock, [this] { return m_Queue.size() < READBACK_MAX_QUEUED; });
+        }
+        else if (m_Queue.size() >= READBACK_MAX_QUEUED) {
+            m_Dropped++;
+            return;
+        }
+        if (!m_FreePixels.empty()) {
+            readback.pixels = std::move(m_FreePixels.back());
+            m_FreePixels.pop_back();
+        }
+    }
+
+    invalidate(staging);
+
+    size_t size = size_t{ staging.width } * staging.height * 4;
+    readback.pixels.resize(size);
+    std::memcpy(readback.pixels.data(), staging.mapped, size);
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Queue.push_back(std::move(readback));
+    }
+    m_FrameAvailable.notify_one();
+}
+
+void FrameReadback::resize(VkExtent2D extent) {
+    for (uint32_t frame = 0; frame < m_Frames.size(); frame++) {
+        collect(frame, true);
+    }
+    waitForStaging();
+    if (VkDeviceSize{ extent.width } * extent.height * 4 == m_Size) {
+        return;
+    }
+    destroyBuffers();
+    createBuffers(extent);
+}
+
+void FrameReadback::workerLoop() {
+    Trace::setThreadName("Frame Readback");
+    while (true) {
+        ReadbackFrame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_FrameAvailable.wait(lock, [this] { return m_Stopping || !m_Queue.empty(); });
+
+            // write out everything already read back before stopping
+            if (m_Queue.empty()) {
+                return;
+            }
+            frame = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+        m_SpaceAvailable.notify_one();
+
+        if (frame.mapped != nullptr) {
+            streamFrame(frame);
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Frames[frame.staging].busy = false;
+            m_StagingReturned.notify_all();
+            continue;
+        }
+
+        encode(frame);
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Written++;
+        m_FreePixels.push_back(std::move(frame.pixels));
+    }
+}
+
+void FrameReadback::waitForStaging() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_StagingReturned.wait(lock, [this] {
+        for (const auto& staging : m_Frames) {
+            if (staging.busy) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+void FrameReadback::streamFrame(const ReadbackFrame& frame) {
+    TRACE_SCOPE("FrameReadback::streamFrame", "readback");
+
+    FrameStreamHeader header;
+    header.width = frame.width;
+    header.height = frame.height;
+    header.serial = frame.serial;
+    header.timestamp = frame.timestamp;
+
+    const uint8_t* payload = frame.mapped;
+    if (m_StreamI420) {
+        header.format = static_cast<uint32_t>(StreamPixelFormat::I420);
+        m_Converted.resize(streamPayloadSize(StreamPixelFormat::I420, frame.width, frame.height));
+        convertToI420(frame.mapped, frame.bgra, frame.width, frame.height, m_Converted.data());
+        payload = m_Converted.data();
+    }
+    else {
+        // sent in the image's own channel order, which the header tells the consumer
+        header.format = static_cast<uint32_t>(frame.bgra ? StreamPixelFormat::Bgra8 : StreamPixelFormat::Rgba8);
+    }
+    header.size = streamPayloadSize(static_cast<StreamPixelFormat>(header.format), frame.width, frame.height);
+
+    bool sent = m_Sink->write(header, payload, m_BlockWhenBehind);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (sent) {
+        m_Written++;
+    }
+    else {
+        m_Dropped++;
+    }
+}
+
+void FrameReadback::encode(const ReadbackFrame& frame) {
+    TRACE_SCOPE("FrameReadback::encode", "readback");
+
+    std::vector<uint8_t> rgb(size_t{ frame.width } * frame.height * 3);
+    size_t red = frame.bgra ? 2 : 0, blue = frame.bgra ? 0 : 2;
+    for (size_t pixel = 0, count = size_t{ frame.width } * frame.height; pixel < count; pixel++) {
+        rgb[pixel * 3 + 0] = frame.pixels[pixel * 4 + red];
+        rgb[pixel * 3 + 1] = frame.pixels[pixel * 4 + 1];
+        rgb[pixel * 3 + 2] = frame.pixels[pixel * 4 + blue];
+    }
+
+    if (m_Output == ReadbackOutput::Hash) {
+        // FNV-1a over the RGB bytes, so the hash doesn't depend on the swapchain's channel order
+        uint64_t hash = 14695981039346656037ull;
+        for (uint8_t byte : rgb) {
+            hash = (hash ^ byte) * 1099511628211ull;
+        }
+        char line[64];
+        std::snprintf(line, sizeof(line), "%016llx\n", static_cast<unsigned long long>(hash));
+        if (frame.name.empty()) {
+            m_HashFile << frame.serial << ' ' << line;
+        }
+        else {
+            m_HashFile << frame.name << ' ' << line;
+        }
+        return;
+    }
+
+    const char* extension = m_Output == ReadbackOutput::Png ? "png" : "ppm";
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%06llu.%s", static_cast<unsigned long long>(frame.serial), extension);
+    std::string fileName = frame.name.empty() ? std::string(name) : frame.name + "." + extension;
+    std::string path = (std::filesystem::path(m_Directory) / fileName).string();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        Log::warn("Failed To Write Frame \"{}\"", path);
+        return;
+    }
+
+    if (m_Output == ReadbackOutput::Png) {
+        writePng(file, rgb, frame.width, frame.height);
+    }
+    else {
+        file << "P6\n" << frame.width << ' ' << frame.height << "\n255\n";
+        file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+    }
+}
+
+void FrameReadback::stopWorker() {
+    if (m_Worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_FrameAvailable.notify_all();
+        m_Worker.join();
+        Log::info("Frame Readback: {} frames written, {} dropped", m_Written, m_Dropped);
+    }
+}
+
+void FrameReadback::destroy() {
+    // the device is idle by now, so the last frames in flight can still be written out
+    for (uint32_t frame = 0; frame < m_Frames.size(); frame++) {
+        collect(frame, true);
+    }
+    stopWorker();
+    m_Sink.reset();
+    destroyBuffers();
+}
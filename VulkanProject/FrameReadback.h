@@ -0,0 +1,142 @@
+#pragma once
+
+#ifndef GLFW_INCLUDE_VULKAN
+#define GLFW_INCLUDE_VULKAN
+#endif
+#include <GLFW/glfw3.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameStream.h"
+#include "RenderDevice.h"
+
+enum class ReadbackOutput {
+    Ppm,
+    Png,
+    Hash,
+    // handed to a FrameSink, see stream()
+    Stream
+};
+
+// One rendered frame copied back to the CPU: tightly packed 8-bit RGBA (or BGRA) rows, top row first
+struct ReadbackFrame {
+    uint64_t serial = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool bgra = false;
+    std::vector<uint8_t> pixels;
+    // when streaming the pixels are read straight out of the mapped staging buffer instead
+    const uint8_t* mapped = nullptr;
+    uint32_t staging = 0;
+    uint64_t timestamp = 0;
+    // written as <name>.ppm/.png instead of frame_<serial> when set
+    std::string name;
+};
+
+// Copies rendered images back to the CPU without stalling the queue. Every frame in flight owns a persistently
+// mapped host-cached staging buffer; the copy is recorded at the end of the frame's command buffer and the buffer is
+// only read once the frame's fence has signalled. Finished frames are queued for a background thread that writes
+// them out as PPM/PNG or hashes them. If that thread falls behind, frames are dropped instead of waited on, unless
+// blockWhenBehind() was called.
+// When streaming the staging buffer itself is lent to the worker instead of being copied out first, so the sink's
+// memcpy into the shared-memory ring slot is the frame's one CPU copy (I420 output is converted into a scratch buffer
+// first). The frame's next copy is dropped (or waits, with the block policy) until the buffer comes back.
+class FrameReadback
+{
+private:
+
+    struct Staging {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        bool pending = false;
+        uint64_t serial = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        bool bgra = false;
+        uint64_t timestamp = 0;
+        std::string name;
+        // lent to the worker for streaming
+        bool busy = false;
+    };
+
+    RenderDevice& m_RenderDevice;
+    uint32_t m_Session;
+    VkDevice m_Device;
+    VkDeviceSize m_Size = 0;
+    bool m_Coherent = false;
+    std::vector<Staging> m_Frames;
+    bool m_WarnedFormat = false;
+
+    ReadbackOutput m_Output;
+    std::string m_Directory;
+    uint32_t m_Every;
+    std::ofstream m_HashFile;
+
+    std::thread m_Worker;
+    std::mutex m_Mutex;
+    std::condition_variable m_FrameAvailable;
+    std::condition_variable m_SpaceAvailable;
+    std::condition_variable m_StagingReturned;
+    std::deque<ReadbackFrame> m_Queue;
+    std::vector<std::vector<uint8_t>> m_FreePixels;
+    bool m_Stopping = false;
+    uint64_t m_Dropped = 0;
+    uint64_t m_Written = 0;
+
+    std::unique_ptr<FrameSink> m_Sink;
+    bool m_StreamI420 = false;
+    bool m_BlockWhenBehind = false;
+    std::vector<uint8_t> m_Converted;
+
+    void createBuffers(VkExtent2D extent);
+    void destroyBuffers();
+    void invalidate(const Staging& staging);
+    // wait: block until the worker has room instead of dropping the frame
+    void collect(uint32_t frame, bool wait);
+    void workerLoop();
+    void stopWorker();
+    void encode(const ReadbackFrame& frame);
+    void streamFrame(const ReadbackFrame& frame);
+    void waitForStaging();
+
+public:
+
+    // every: only read back frames whose serial is a multiple of this. Staging memory is allocated through
+    // renderDevice on behalf of session.
+    FrameReadback(RenderDevice& renderDevice, uint32_t session, uint32_t framesInFlight, VkExtent2D extent, ReadbackOutput output, std::string directory, uint32_t every);
+    ~FrameReadback();
+
+    FrameReadback(const FrameReadback&) = delete;
+    FrameReadback& operator=(const FrameReadback&) = delete;
+
+    // With ReadbackOutput::Stream, call before the first copy. block: when the sink is behind, wait for it instead
+    // of dropping frames (this stalls rendering)
+    void stream(std::unique_ptr<FrameSink> sink, bool i420, bool block);
+    // Wait for the worker instead of dropping frames when it falls behind, e.g. for batch renders where every
+    // frame is an output
+    void blockWhenBehind();
+
+    bool wants(uint64_t serial) const;
+
+    // Records a copy of image (left in layout by the render pass) into frame's staging buffer. Must be recorded
+    // after the render pass, outside of it; image has to have been created with TRANSFER_SRC usage. name, if given,
+    // replaces frame_<serial> as the output file name (or the hash line's key).
+    void recordCopy(VkCommandBuffer commandBuffer, uint32_t frame, uint64_t serial, VkImage image, VkFormat format, VkExtent2D extent, VkImageLayout layout, const std::string& name = {});
+    // Call after frame's fence signalled; queues what its last submission copied for the worker
+    void collect(uint32_t frame);
+
+    // The device must be idle. Collects whatever is still pending, then resizes the staging buffers.
+    void resize(VkExtent2D extent);
+
+    // Waits for the worker to finish the queued frames, then frees the staging buffers
+    void destroy();
+};
@@ -0,0 +1,556 @@
+#include "FrameStream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include "Log.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Lives at the start of the shared memory ring; slots follow at SHARED_RING_SLOTS_OFFSET. The producer publishes a
+// slot by bumping written, the consumer frees it by bumping read, so each counter has a single writer.
+struct SharedRing {
+    uint32_t magic;
+    uint32_t slotCount;
+    uint64_t slotSize;
+    alignas(64) std::atomic<uint64_t> written;
+    alignas(64) std::atomic<uint64_t> read;
+    alignas(64) std::atomic<uint32_t> closed;
+};
+
+const size_t SHARED_RING_SLOTS_OFFSET = 256;
+
+static_assert(sizeof(SharedRing) <= SHARED_RING_SLOTS_OFFSET, "SharedRing must fit before the first slot");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring is shared between processes and can't use locks");
+
+static SharedRing* ring(void* view) {
+    return static_cast<SharedRing*>(view);
+}
+
+static uint8_t* slot(void* view, uint64_t index) {
+    SharedRing* header = ring(view);
+    return static_cast<uint8_t*>(view) + SHARED_RING_SLOTS_OFFSET + (index % header->slotCount) * header->slotSize;
+}
+
+bool parseStreamTarget(const std::string& target, StreamTransport& transport, std::string& path) {
+    size_t colon = target.find(':');
+    if (colon == std::string::npos || colon + 1 == target.size()) {
+        return false;
+    }
+
+    std::string scheme = target.substr(0, colon);
+    path = target.substr(colon + 1);
+    if (scheme == "pipe") {
+        transport = StreamTransport::Pipe;
+    }
+    else if (scheme == "unix") {
+        transport = StreamTransport::UnixSocket;
+    }
+    else if (scheme == "shm") {
+        transport = StreamTransport::SharedMemory;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+size_t streamPayloadSize(StreamPixelFormat format, uint32_t width, uint32_t height) {
+    if (format == StreamPixelFormat::I420) {
+        size_t chroma = size_t{ (width + 1) / 2 } * ((height + 1) / 2);
+        return size_t{ width } * height + chroma * 2;
+    }
+    return size_t{ width } * height * 4;
+}
+
+void convertToI420(const uint8_t* pixels, bool bgra, uint32_t width, uint32_t height, uint8_t* out) {
+    size_t red = bgra ? 2 : 0, blue = bgra ? 0 : 2;
+    uint32_t chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    uint8_t* yPlane = out;
+    uint8_t* uPlane = out + size_t{ width } * height;
+    uint8_t* vPlane = uPlane + size_t{ chromaWidth } * chromaHeight;
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* row = pixels + size_t{ y } * width * 4;
+        for (uint32_t x = 0; x < width; x++) {
+            int r = row[x * 4 + red], g = row[x * 4 + 1], b = row[x * 4 + blue];
+            yPlane[size_t{ y } * width + x] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+    }
+
+    // chroma from the average of each 2x2 block (clamped at odd edges)
+    for (uint32_t cy = 0; cy < chromaHeight; cy++) {
+        for (uint32_t cx = 0; cx < chromaWidth; cx++) {
+            int r = 0, g = 0, b = 0;
+            for (uint32_t dy = 0; dy < 2; dy++) {
+                for (uint32_t dx = 0; dx < 2; dx++) {
+                    uint32_t x = std::min(cx * 2 + dx, width - 1), y = std::min(cy * 2 + dy, height - 1);
+                    const uint8_t* pixel = pixels + (size_t{ y } * width + x) * 4;
+                    r += pixel[red];
+                    g += pixel[1];
+                    b += pixel[blue];
+                }
+            }
+            r /= 4;
+            g /= 4;
+            b /= 4;
+            uPlane[size_t{ cy } * chromaWidth + cx] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            vPlane[size_t{ cy } * chromaWidth + cx] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+uint64_t streamTimestamp() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Platform layer: byte streams, sockets and named shared memory
+
+#ifdef _WIN32
+
+static intptr_t openPipeForWriting(const std::string& path) {
+    while (true) {
+        HANDLE pipe = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (pipe != INVALID_HANDLE_VALUE) {
+            return reinterpret_cast<intptr_t>(pipe);
+        }
+        if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeA(path.c_str(), NMPWAIT_WAIT_FOREVER)) {
+            throw std::runtime_error("failed to open pipe \"" + path + "\" (is the consumer running?)!");
+        }
+    }
+}
+
+static intptr_t openPipeForReading(const std::string& path) {
+    HANDLE pipe = CreateNamedPipeA(path.c_str(), PIPE_ACCESS_INBOUND, PIPE_TYPE_BYTE | PIPE_WAIT, 1, 0, 1 << 20, 0, nullptr);
+    if (pipe == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to create pipe \"" + path + "\"!");
+    }
+    if (!ConnectNamedPipe(pipe, nullptr) && GetLastError() != ERROR_PIPE_CONNECTED) {
+        CloseHandle(pipe);
+        throw std::runtime_error("failed to wait for a producer on \"" + path + "\"!");
+    }
+    return reinterpret_cast<intptr_t>(pipe);
+}
+
+static intptr_t connectSocket(const std::string& path) {
+    throw std::runtime_error("unix sockets aren't supported on Windows, use pipe:\\\\.\\pipe\\<name> instead!");
+}
+
+static intptr_t acceptSocket(const std::string& path, intptr_t& listener) {
+    throw std::runtime_error("unix sockets aren't supported on Windows, use pipe:\\\\.\\pipe\\<name> instead!");
+}
+
+static bool writeHandle(intptr_t handle, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1 << 30)), written = 0;
+        if (!WriteFile(reinterpret_cast<HANDLE>(handle), data, chunk, &written, nullptr)) {
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+static bool readHandle(intptr_t handle, uint8_t* data, size_t size) {
+    while (size > 0) {
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1 << 30)), read = 0;
+        if (!ReadFile(reinterpret_cast<HANDLE>(handle), data, chunk, &read, nullptr) || read == 0) {
+            return false;
+        }
+        data += read;
+        size -= read;
+    }
+    return true;
+}
+
+static void closeHandle(intptr_t handle) {
+    if (handle != -1) {
+        CloseHandle(reinterpret_cast<HANDLE>(handle));
+    }
+}
+
+// handle keeps the section (and so its name) alive while mapped
+static void* createSharedMemory(const std::string& name, size_t size, intptr_t& handle) {
+    HANDLE section = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(uint64_t{ size } >> 32), static_cast<DWORD>(size), name.c_str());
+    if (section == nullptr) {
+        throw std::runtime_error("failed to create shared memory \"" + name + "\"!");
+    }
+    void* view = MapViewOfFile(section, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (view == nullptr) {
+        CloseHandle(section);
+        throw std::runtime_error("failed to map shared memory \"" + name + "\"!");
+    }
+    handle = reinterpret_cast<intptr_t>(section);
+    return view;
+}
+
+static void* openSharedMemory(const std::string& name, size_t& size, intptr_t& handle) {
+    HANDLE section = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+    if (section == nullptr) {
+        return nullptr;
+    }
+    void* view = MapViewOfFile(section, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(section);
+        throw std::runtime_error("failed to map shared memory \"" + name + "\"!");
+    }
+
+    MEMORY_BASIC_INFORMATION info;
+    VirtualQuery(view, &info, sizeof(info));
+    size = info.RegionSize;
+    handle = reinterpret_cast<intptr_t>(section);
+    return view;
+}
+
+// the section handle is closed with closeHandle()
+static void closeSharedMemory(const std::string& name, void* view, size_t size, bool owner) {
+    if (view != nullptr) {
+        UnmapViewOfFile(view);
+    }
+}
+
+#else
+
+static std::string sharedMemoryName(const std::string& name) {
+    return name[0] == '/' ? name : "/" + name;
+}
+
+static intptr_t openPipeForWriting(const std::string& path) {
+    // a consumer that exits mid-frame should fail the write, not kill the renderer
+    std::signal(SIGPIPE, SIG_IGN);
+    if (::mkfifo(path.c_str(), 0600) != 0 && errno != EEXIST) {
+        throw std::runtime_error("failed to create pipe \"" + path + "\"!");
+    }
+    int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open pipe \"" + path + "\"!");
+    }
+    return fd;
+}
+
+static intptr_t openPipeForReading(const std::string& path) {
+    if (::mkfifo(path.c_str(), 0600) != 0 && errno != EEXIST) {
+        throw std::runtime_error("failed to create pipe \"" + path + "\"!");
+    }
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open pipe \"" + path + "\"!");
+    }
+    return fd;
+}
+
+static sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("socket path \"" + path + "\" is too long!");
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+static intptr_t connectSocket(const std::string& path) {
+    std::signal(SIGPIPE, SIG_IGN);
+    sockaddr_un address = socketAddress(path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw std::runtime_error("failed to connect to \"" + path + "\" (is the consumer running?)!");
+    }
+    return fd;
+}
+
+static intptr_t acceptSocket(const std::string& path, intptr_t& listener) {
+    sockaddr_un address = socketAddress(path);
+    ::unlink(path.c_str());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 1) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw std::runtime_error("failed to listen on \"" + path + "\"!");
+    }
+    listener = fd;
+
+    int connection = ::accept(fd, nullptr, nullptr);
+    if (connection < 0) {
+        throw std::runtime_error("failed to accept a producer on \"" + path + "\"!");
+    }
+    return connection;
+}
+
+static bool writeHandle(intptr_t handle, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(static_cast<int>(handle), data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+static bool readHandle(intptr_t handle, uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t read = ::read(static_cast<int>(handle), data, size);
+        if (read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read <= 0) {
+            return false;
+        }
+        data += read;
+        size -= static_cast<size_t>(read);
+    }
+    return true;
+}
+
+static void closeHandle(intptr_t handle) {
+    if (handle != -1) {
+        ::close(static_cast<int>(handle));
+    }
+}
+
+static void* createSharedMemory(const std::string& name, size_t size, intptr_t& handle) {
+    std::string objectName = sharedMemoryName(name);
+    int fd = ::shm_open(objectName.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw std::runtime_error("failed to create shared memory \"" + name + "\"!");
+    }
+    void* view = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        throw std::runtime_error("failed to map shared memory \"" + name + "\"!");
+    }
+    // the mapping alone keeps the object alive
+    handle = -1;
+    return view;
+}
+
+static void* openSharedMemory(const std::string& name, size_t& size, intptr_t& handle) {
+    int fd = ::shm_open(sharedMemoryName(name).c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat info;
+    // the producer may not have sized it yet
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < SHARED_RING_SLOTS_OFFSET) {
+        ::close(fd);
+        return nullptr;
+    }
+    size = static_cast<size_t>(info.st_size);
+    void* view = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        throw std::runtime_error("failed to map shared memory \"" + name + "\"!");
+    }
+    handle = -1;
+    return view;
+}
+
+static void closeSharedMemory(const std::string& name, void* view, size_t size, bool owner) {
+    if (view != nullptr) {
+        ::munmap(view, size);
+    }
+    // the consumer keeps its mapping; only the name goes away
+    if (owner) {
+        ::shm_unlink(sharedMemoryName(name).c_str());
+    }
+}
+
+#endif
+
+// FrameSink
+
+FrameSink::FrameSink(const std::string& target, uint64_t maxPayload, uint32_t ringSlots) {
+    if (!parseStreamTarget(target, m_Transport, m_Path)) {
+        throw std::runtime_error("invalid stream target \"" + target + "\" (expected pipe:, unix: or shm:)!");
+    }
+
+    switch (m_Transport) {
+    case StreamTransport::Pipe:
+        Log::info("Waiting For A Consumer On Pipe \"{}\"", m_Path);
+        m_Handle = openPipeForWriting(m_Path);
+        break;
+    case StreamTransport::UnixSocket:
+        m_Handle = connectSocket(m_Path);
+        break;
+    case StreamTransport::SharedMemory: {
+        uint64_t slotSize = (sizeof(FrameStreamHeader) + maxPayload + 63) & ~uint64_t{ 63 };
+        m_ViewSize = SHARED_RING_SLOTS_OFFSET + slotSize * ringSlots;
+        m_View = createSharedMemory(m_Path, m_ViewSize, m_Handle);
+
+        SharedRing* header = new (m_View) SharedRing{};
+        header->slotCount = ringSlots;
+        header->slotSize = slotSize;
+        header->written.store(0);
+        header->read.store(0);
+        header->closed.store(0);
+        // published last, so a consumer that sees the magic sees a complete header
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = FRAME_STREAM_MAGIC;
+        break;
+    }
+    }
+    Log::info("Streaming Frames To \"{}\"", target);
+}
+
+FrameSink::~FrameSink() {
+    if (m_View != nullptr) {
+        ring(m_View)->closed.store(1, std::memory_order_release);
+        closeSharedMemory(m_Path, m_View, m_ViewSize, true);
+    }
+    closeHandle(m_Handle);
+}
+
+bool FrameSink::writeAll(const void* data, size_t size) {
+    if (!writeHandle(m_Handle, static_cast<const uint8_t*>(data), size)) {
+        if (!m_Broken) {
+            Log::warn("Frame Stream \"{}\" Closed By The Consumer", m_Path);
+        }
+        m_Broken = true;
+        return false;
+    }
+    return true;
+}
+
+bool FrameSink::write(const FrameStreamHeader& header, const uint8_t* payload, bool wait) {
+    if (m_Broken) {
+        return false;
+    }
+
+    if (m_Transport != StreamTransport::SharedMemory) {
+        return writeAll(&header, sizeof(header)) && writeAll(payload, header.size);
+    }
+
+    SharedRing* shared = ring(m_View);
+    if (sizeof(FrameStreamHeader) + header.size > shared->slotSize) {
+        // the slots are sized up front, for the largest frame the producer expects
+        if (m_Oversized++ == 0) {
+            Log::warn("Dropping {}x{} Frames: {} Bytes, But Ring Slots Hold {}", header.width, header.height, header.size, shared->slotSize - sizeof(FrameStreamHeader));
+        }
+        return false;
+    }
+
+    uint64_t written = shared->written.load(std::memory_order_relaxed);
+    while (written - shared->read.load(std::memory_order_acquire) >= shared->slotCount) {
+        if (!wait) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    uint8_t* target = slot(m_View, written);
+    std::memcpy(target, &header, sizeof(header));
+    std::memcpy(target + sizeof(header), payload, header.size);
+    shared->written.store(written + 1, std::memory_order_release);
+    return true;
+}
+
+// FrameSource
+
+FrameSource::FrameSource(const std::string& target) {
+    if (!parseStreamTarget(target, m_Transport, m_Path)) {
+        throw std::runtime_error("invalid stream target \"" + target + "\" (expected pipe:, unix: or shm:)!");
+    }
+
+    switch (m_Transport) {
+    case StreamTransport::Pipe:
+        m_Handle = openPipeForReading(m_Path);
+        break;
+    case StreamTransport::UnixSocket:
+        m_Handle = acceptSocket(m_Path, m_Listener);
+        break;
+    case StreamTransport::SharedMemory:
+        // the renderer creates the ring once it knows the frame size
+        while ((m_View = openSharedMemory(m_Path, m_ViewSize, m_Handle)) == nullptr || ring(m_View)->magic != FRAME_STREAM_MAGIC) {
+            if (m_View != nullptr) {
+                closeSharedMemory(m_Path, m_View, m_ViewSize, false);
+                closeHandle(m_Handle);
+                m_View = nullptr;
+                m_Handle = -1;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (SHARED_RING_SLOTS_OFFSET + ring(m_View)->slotSize * ring(m_View)->slotCount > m_ViewSize) {
+            throw std::runtime_error("shared memory \"" + m_Path + "\" is smaller than its ring!");
+        }
+        break;
+    }
+}
+
+FrameSource::~FrameSource() {
+    if (m_View != nullptr) {
+        closeSharedMemory(m_Path, m_View, m_ViewSize, false);
+    }
+    closeHandle(m_Handle);
+    closeHandle(m_Listener);
+}
+
+bool FrameSource::readAll(void* data, size_t size) {
+    return readHandle(m_Handle, static_cast<uint8_t*>(data), size);
+}
+
+bool FrameSource::read(FrameStreamHeader& header, std::vector<uint8_t>& payload) {
+    if (m_Transport != StreamTransport::SharedMemory) {
+        if (!readAll(&header, sizeof(header))) {
+            return false;
+        }
+        if (header.magic != FRAME_STREAM_MAGIC) {
+            throw std::runtime_error("frame stream is out of sync!");
+        }
+        payload.resize(header.size);
+        return readAll(payload.data(), header.size);
+    }
+
+    SharedRing* shared = ring(m_View);
+    uint64_t read = shared->read.load(std::memory_order_relaxed);
+    while (shared->written.load(std::memory_order_acquire) == read) {
+        if (shared->closed.load(std::memory_order_acquire)) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    const uint8_t* source = slot(m_View, read);
+    std::memcpy(&header, source, sizeof(header));
+    // the ring is shared with another process, so nothing in it is trusted to fit
+    if (header.magic != FRAME_STREAM_MAGIC || header.size > shared->slotSize - sizeof(header)) {
+        throw std::runtime_error("frame stream is out of sync!");
+    }
+    payload.resize(header.size);
+    std::memcpy(payload.data(), source + sizeof(header), header.size);
+    shared->read.store(read + 1, std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const uint32_t FRAME_STREAM_MAGIC = 0x53464B56; // "VKFS"
+
+enum class StreamPixelFormat : uint32_t {
+    Rgba8 = 0,
+    Bgra8 = 1,
+    // 8-bit Y plane, then quarter size U and V planes (BT.601, limited range)
+    I420 = 2
+};
+
+// Precedes every frame in a pipe or socket stream and every shared memory ring slot
+struct FrameStreamHeader {
+    uint32_t magic = FRAME_STREAM_MAGIC;
+    uint32_t format = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint64_t serial = 0;
+    // steady clock nanoseconds when the frame was submitted; comparable across processes on the same machine
+    uint64_t timestamp = 0;
+    // payload bytes that follow
+    uint64_t size = 0;
+};
+
+static_assert(sizeof(FrameStreamHeader) == 40, "FrameStreamHeader is a wire format");
+
+enum class StreamTransport {
+    Pipe,
+    UnixSocket,
+    SharedMemory
+};
+
+// "pipe:<path>" (a FIFO, or \\.\pipe\<name> on Windows), "unix:<path>" or "shm:<name>"
+bool parseStreamTarget(const std::string& target, StreamTransport& transport, std::string& path);
+
+size_t streamPayloadSize(StreamPixelFormat format, uint32_t width, uint32_t height);
+
+// Converts tightly packed 8-bit RGBA/BGRA pixels to I420; out must hold streamPayloadSize(I420, width, height)
+void convertToI420(const uint8_t* pixels, bool bgra, uint32_t width, uint32_t height, uint8_t* out);
+
+uint64_t streamTimestamp();
+
+// Writing end of a frame stream. Pipes and sockets carry header + payload back to back; the shared memory ring has
+// a fixed number of slots, each big enough for a header and maxPayload bytes, that the consumer hands back by
+// advancing its read counter. The slots can't grow, so maxPayload has to cover the largest frame that will be sent.
+// The consumer creates pipes and listens on sockets, the producer creates the ring.
+class FrameSink
+{
+private:
+
+    StreamTransport m_Transport;
+    std::string m_Path;
+    // the pipe or socket, or on Windows the shared memory section
+    intptr_t m_Handle = -1;
+    void* m_View = nullptr;
+    size_t m_ViewSize = 0;
+    bool m_Broken = false;
+    uint64_t m_Oversized = 0;
+
+    bool writeAll(const void* data, size_t size);
+
+public:
+
+    // Throws if the target can't be opened. Blocks until the consumer has opened a pipe.
+    FrameSink(const std::string& target, uint64_t maxPayload, uint32_t ringSlots = 4);
+    ~FrameSink();
+
+    FrameSink(const FrameSink&) = delete;
+    FrameSink& operator=(const FrameSink&) = delete;
+
+    // Returns false if the frame was dropped: the consumer went away, the frame doesn't fit a ring slot, or the ring
+    // was full and wait was false. Pipe and socket writes always wait for the consumer.
+    bool write(const FrameStreamHeader& header, const uint8_t* payload, bool wait);
+};
+
+// Reading end, used by the FrameConsumer tool
+class FrameSource
+{
+private:
+
+    StreamTransport m_Transport;
+    std::string m_Path;
+    intptr_t m_Handle = -1;
+    intptr_t m_Listener = -1;
+    void* m_View = nullptr;
+    size_t m_ViewSize = 0;
+
+    bool readAll(void* data, size_t size);
+
+public:
+
+    // Throws if the target can't be opened. Blocks until a producer connects (pipes, sockets) or creates the ring.
+    FrameSource(const std::string& target);
+    ~FrameSource();
+
+    FrameSource(const FrameSource&) = delete;
+    FrameSource& operator=(const FrameSource&) = delete;
+
+    // Blocks for the next frame; returns false once the producer has closed the stream
+    bool read(FrameStreamHeader& header, std::vector<uint8_t>& payload);
+};
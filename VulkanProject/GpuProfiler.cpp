@@ -0,0 +1,249 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Log.h"
+#include "Statistics.h"
+#include "Trace.h"
+
+const uint32_t NO_REGION = UINT32_MAX;
+
+// Results come back in bit order, one uint64_t per set bit
+const VkQueryPipelineStatisticFlags STATISTICS_FLAGS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+// vkGetQueryPoolResults writes straight into PipelineStatistics
+static_assert(sizeof(PipelineStatistics) == 6 * sizeof(uint64_t), "PipelineStatistics must match STATISTICS_FLAGS");
+
+PipelineStatistics& PipelineStatistics::operator+=(const PipelineStatistics& other) {
+    inputAssemblyVertices += other.inputAssemblyVertices;
+    inputAssemblyPrimitives += other.inputAssemblyPrimitives;
+    vertexShaderInvocations += other.vertexShaderInvocations;
+    clippingInvocations += other.clippingInvocations;
+    clippingPrimitives += other.clippingPrimitives;
+    fragmentShaderInvocations += other.fragmentShaderInvocations;
+    return *this;
+}
+
+GpuProfiler::GpuProfiler(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, bool pipelineStatistics, uint32_t maxRegions)
+    : m_Device{ device }, m_MaxRegions{ maxRegions }, m_PipelineStatistics{ pipelineStatistics } {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_TimestampPeriod = properties.limits.timestampPeriod;
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+    uint32_t validBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 0;
+    if (validBits == 0) {
+        throw std::runtime_error("queue family does not support timestamp queries!");
+    }
+    m_TimestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t{ 1 } << validBits) - 1;
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = maxRegions * 2;
+
+    m_Frames.resize(framesInFlight);
+    for (auto& frame : m_Frames) {
+        if (vkCreateQueryPool(m_Device, &poolInfo, nullptr, &frame.pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+        frame.regions.reserve(maxRegions);
+    }
+    m_Results.resize(maxRegions * 2);
+
+    if (m_PipelineStatistics) {
+        VkQueryPoolCreateInfo statisticsInfo{};
+        statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        statisticsInfo.queryCount = maxRegions;
+        statisticsInfo.pipelineStatistics = STATISTICS_FLAGS;
+
+        for (auto& frame : m_Frames) {
+            if (vkCreateQueryPool(m_Device, &statisticsInfo, nullptr, &frame.statisticsPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create pipeline statistics query pool!");
+            }
+            frame.passes.reserve(maxRegions);
+        }
+        m_StatisticsResults.resize(maxRegions);
+    }
+
+    Log::info("Created GPU Profiler ({} query pools, {} ns per tick, {} valid bits, pipeline statistics {})", framesInFlight, m_TimestampPeriod, validBits, m_PipelineStatistics ? "on" : "off");
+}
+
+uint32_t GpuProfiler::findHistory(const char* name) {
+    for (uint32_t i = 0; i < m_History.size(); i++) {
+        if (m_History[i].name == name || std::strcmp(m_History[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    History history{};
+    history.name = name;
+    history.samples.reserve(GPU_PROFILER_HISTORY);
+    m_History.push_back(std::move(history));
+    return static_cast<uint32_t>(m_History.size() - 1);
+}
+
+GpuFrameResult GpuProfiler::collect(uint32_t frame) {
+    GpuFrameResult frameResult;
+    Frame& queries = m_Frames[frame];
+    if (!queries.pending) {
+        return frameResult;
+    }
+    queries.pending = false;
+
+    // the fence has signalled, so these only fail if a region or pass was left open
+    if (!queries.passes.empty()) {
+        uint32_t passCount = static_cast<uint32_t>(queries.passes.size());
+        VkResult result = vkGetQueryPoolResults(m_Device, queries.statisticsPool, 0, passCount, passCount * sizeof(PipelineStatistics), m_StatisticsResults.data(), sizeof(PipelineStatistics), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS) {
+            frameResult.hasStatistics = true;
+            for (uint32_t pass = 0; pass < passCount; pass++) {
+                frameResult.statistics += m_StatisticsResults[pass];
+            }
+        }
+    }
+
+    if (queries.regions.empty()) {
+        return frameResult;
+    }
+
+    uint32_t queryCount = static_cast<uint32_t>(queries.regions.size() * 2);
+    VkResult result = vkGetQueryPoolResults(m_Device, queries.pool, 0, queryCount, queryCount * sizeof(uint64_t), m_Results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        return frameResult;
+    }
+
+    for (size_t region = 0; region < queries.regions.size(); region++) {
+        uint64_t ticks = (m_Results[region * 2 + 1] - m_Results[region * 2]) & m_TimestampMask;
+        double milliseconds = ticks * m_TimestampPeriod / 1000000.0;
+
+        History& history = m_History[queries.regions[region]];
+        if (history.samples.size() < GPU_PROFILER_HISTORY) {
+            history.samples.push_back(milliseconds);
+        }
+        else {
+            history.samples[history.next] = milliseconds;
+        }
+        history.next = (history.next + 1) % GPU_PROFILER_HISTORY;
+        history.total++;
+
+        if (Trace::enabled()) {
+            Trace::counter("GPU (ms)", history.name, milliseconds);
+        }
+        if (region == 0) {
+            frameResult.valid = true;
+            frameResult.frameMilliseconds = milliseconds;
+        }
+    }
+    return frameResult;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frame) {
+    m_Recording = &m_Frames[frame];
+    m_Recording->regions.clear();
+    m_Recording->passes.clear();
+    m_Recording->pending = true;
+    vkCmdResetQueryPool(commandBuffer, m_Recording->pool, 0, m_MaxRegions * 2);
+    if (m_PipelineStatistics) {
+        vkCmdResetQueryPool(commandBuffer, m_Recording->statisticsPool, 0, m_MaxRegions);
+    }
+}
+
+uint32_t GpuProfiler::beginRegion(VkCommandBuffer commandBuffer, const char* name) {
+    if (m_Recording == nullptr || m_Recording->regions.size() >= m_MaxRegions) {
+        return NO_REGION;
+    }
+
+    uint32_t region = static_cast<uint32_t>(m_Recording->regions.size());
+    m_Recording->regions.push_back(findHistory(name));
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_Recording->pool, region * 2);
+    return region;
+}
+
+void GpuProfiler::endRegion(VkCommandBuffer commandBuffer, uint32_t region) {
+    if (m_Recording == nullptr || region == NO_REGION) {
+        return;
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_Recording->pool, region * 2 + 1);
+}
+
+uint32_t GpuProfiler::beginStatistics(VkCommandBuffer commandBuffer, const char* name) {
+    if (!m_PipelineStatistics || m_Recording == nullptr || m_Recording->passes.size() >= m_MaxRegions) {
+        return NO_REGION;
+    }
+
+    uint32_t pass = static_cast<uint32_t>(m_Recording->passes.size());
+    m_Recording->passes.push_back(name);
+    vkCmdBeginQuery(commandBuffer, m_Recording->statisticsPool, pass, 0);
+    return pass;
+}
+
+void GpuProfiler::endStatistics(VkCommandBuffer commandBuffer, uint32_t pass) {
+    if (m_Recording == nullptr || pass == NO_REGION) {
+        return;
+    }
+    vkCmdEndQuery(commandBuffer, m_Recording->statisticsPool, pass);
+}
+
+bool GpuProfiler::hasPipelineStatistics() const {
+    return m_PipelineStatistics;
+}
+
+std::vector<GpuRegionStats> GpuProfiler::getStats() {
+    std::vector<GpuRegionStats> stats;
+    std::vector<double> sorted;
+
+    for (const auto& history : m_History) {
+        GpuRegionStats region;
+        region.name = history.name;
+        region.samples = history.total;
+
+        if (!history.samples.empty()) {
+            sorted = history.samples;
+            std::sort(sorted.begin(), sorted.end());
+
+            double sum = 0.0;
+            for (double sample : sorted) {
+                sum += sample;
+            }
+
+            region.average = sum / sorted.size();
+            region.p50 = percentile(sorted, 0.50);
+            region.p95 = percentile(sorted, 0.95);
+            region.p99 = percentile(sorted, 0.99);
+            region.max = sorted.back();
+        }
+        stats.push_back(region);
+    }
+    return stats;
+}
+
+void GpuProfiler::printStats() {
+    Log::info("GPU Timings (last {} frames, ms):", GPU_PROFILER_HISTORY);
+    for (const auto& region : getStats()) {
+        Log::info("\t{}: avg {}, p50 {}, p95 {}, p99 {}, max {} ({} samples)", region.name, region.average, region.p50, region.p95, region.p99, region.max, region.samples);
+    }
+}
+
+void GpuProfiler::destroy() {
+    for (auto& frame : m_Frames) {
+        vkDestroyQueryPool(m_Device, frame.pool, nullptr);
+        vkDestroyQueryPool(m_Device, frame.statisticsPool, nullptr);
+        frame.pool = VK_NULL_HANDLE;
+        frame.statisticsPool = VK_NULL_HANDLE;
+    }
+    m_Recording = nullptr;
+}
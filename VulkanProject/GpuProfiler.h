@@ -0,0 +1,113 @@
+#pragma once
+
+#ifndef GLFW_INCLUDE_VULKAN
+#define GLFW_INCLUDE_VULKAN
+#endif
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Milliseconds of GPU time spent in one named region over the last GPU_PROFILER_HISTORY frames
+struct GpuRegionStats {
+    std::string name;
+    uint64_t samples = 0;
+    double average = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+const size_t GPU_PROFILER_HISTORY = 240;
+
+// VK_QUERY_TYPE_PIPELINE_STATISTICS counters for one pass (or the sum over a frame's passes)
+struct PipelineStatistics {
+    uint64_t inputAssemblyVertices = 0;
+    uint64_t inputAssemblyPrimitives = 0;
+    uint64_t vertexShaderInvocations = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentShaderInvocations = 0;
+
+    PipelineStatistics& operator+=(const PipelineStatistics& other);
+};
+
+// What collect() read back for one frame
+struct GpuFrameResult {
+    bool valid = false;
+    // the first region the frame opened, normally the one spanning the whole command buffer
+    double frameMilliseconds = 0.0;
+    bool hasStatistics = false;
+    PipelineStatistics statistics;
+};
+
+// Times named regions of recorded command buffers with timestamp queries. There is one query pool per frame in
+// flight: a frame's command buffer resets and writes its pool, and collect() reads the pool back once the frame's
+// fence has signalled, so reading never waits on the GPU. Region names must be string literals.
+// With pipeline statistics enabled (the device must have been created with pipelineStatisticsQuery) each frame
+// also gets a statistics pool, and passes wrapped in beginStatistics/endStatistics report how many vertices,
+// primitives and fragment shader invocations they cost.
+class GpuProfiler
+{
+private:
+
+    struct Frame {
+        VkQueryPool pool = VK_NULL_HANDLE;
+        // history index of each region written this frame; region n uses queries 2n and 2n+1
+        std::vector<uint32_t> regions;
+        VkQueryPool statisticsPool = VK_NULL_HANDLE;
+        std::vector<const char*> passes;
+        bool pending = false;
+    };
+
+    struct History {
+        const char* name;
+        std::vector<double> samples;
+        size_t next = 0;
+        uint64_t total = 0;
+    };
+
+    VkDevice m_Device;
+    // nanoseconds per timestamp tick
+    double m_TimestampPeriod;
+    uint64_t m_TimestampMask;
+    uint32_t m_MaxRegions;
+    bool m_PipelineStatistics;
+
+    std::vector<Frame> m_Frames;
+    Frame* m_Recording = nullptr;
+    std::vector<History> m_History;
+    std::vector<uint64_t> m_Results;
+    std::vector<PipelineStatistics> m_StatisticsResults;
+
+    uint32_t findHistory(const char* name);
+
+public:
+
+    // Throws if the graphics queue family has no timestamp support
+    GpuProfiler(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, bool pipelineStatistics, uint32_t maxRegions = 16);
+
+    // Reads back the queries written by frame's last submission. Call after its fence has signalled and before
+    // recording the frame again.
+    GpuFrameResult collect(uint32_t frame);
+
+    // Resets frame's pool; must be recorded outside a render pass, before any region
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frame);
+    // Returns the region to pass to endRegion; regions may nest
+    uint32_t beginRegion(VkCommandBuffer commandBuffer, const char* name);
+    void endRegion(VkCommandBuffer commandBuffer, uint32_t region);
+
+    // Pipeline statistics for a pass. Begin and end must both be inside or both outside the same render pass
+    // instance, and passes may not nest. No-ops when statistics are disabled.
+    uint32_t beginStatistics(VkCommandBuffer commandBuffer, const char* name);
+    void endStatistics(VkCommandBuffer commandBuffer, uint32_t pass);
+
+    bool hasPipelineStatistics() const;
+
+    std::vector<GpuRegionStats> getStats();
+    void printStats();
+
+    void destroy();
+};
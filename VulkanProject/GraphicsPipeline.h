@@ -0,0 +1,56 @@
+#pragma once
+
+#ifndef GLFW_INCLUDE_VULKAN
+#define GLFW_INCLUDE_VULKAN
+#endif
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+// One specialization constant. Every constant the shaders declare is 32 bits wide (bool, int, uint or float),
+// so the value is stored as raw bits.
+struct SpecializationConstant {
+    uint32_t id;
+    uint32_t value;
+};
+
+// Everything needed to create one graphics pipeline, held by value so a description can be queued,
+// copied to a worker thread and outlive the function that filled it in.
+struct GraphicsPipelineDesc {
+    std::string name;
+
+    VkShaderModule vertexShader = VK_NULL_HANDLE;
+    VkShaderModule fragmentShader = VK_NULL_HANDLE;
+    std::string vertexEntryPoint = "main";
+    std::string fragmentEntryPoint = "main";
+    std::vector<SpecializationConstant> vertexConstants;
+    std::vector<SpecializationConstant> fragmentConstants;
+
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+    float lineWidth = 1.0f;
+
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState colorBlend = defaultColorBlend();
+
+    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+
+    // straight alpha blending into an RGBA target
+    static VkPipelineColorBlendAttachmentState defaultColorBlend();
+};
+
+// Fills in the Vulkan create-info structs for desc and creates the pipeline through cache.
+// Safe to call from several threads at once: VkPipelineCache is internally synchronized.
+VkPipeline buildGraphicsPipeline(VkDevice device, VkPipelineCache cache, const GraphicsPipelineDesc& desc);
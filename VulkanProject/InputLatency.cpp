@@ -0,0 +1,148 @@
+#include "InputLatency.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "Log.h"
+#include "Statistics.h"
+#include "Trace.h"
+
+// frames whose display is never reported (a timed out wait) are given up on after this many newer ones
+const size_t MAX_TAGGED_FRAMES = 16;
+
+static int64_t now() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+static double millisecondsSince(int64_t start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::duration(now() - start)).count();
+}
+
+static void addSample(std::vector<double>& samples, size_t& next, double value) {
+    if (samples.size() < INPUT_LATENCY_HISTORY) {
+        samples.push_back(value);
+    }
+    else {
+        samples[next] = value;
+    }
+    next = (next + 1) % INPUT_LATENCY_HISTORY;
+}
+
+static void printDistribution(const char* label, std::vector<double> samples) {
+    if (samples.empty()) {
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    Log::info("\t{}: p50 {} ms, p95 {} ms, p99 {} ms, max {} ms", label, percentile(samples, 0.5), percentile(samples, 0.95), percentile(samples, 0.99), samples.back());
+}
+
+InputLatency::InputLatency(std::string csvPath, std::string policy, uint32_t framesInFlight, bool tracksDisplay)
+    : m_Policy{ std::move(policy) }, m_FramesInFlight{ framesInFlight }, m_TracksDisplay{ tracksDisplay }, m_Path{ std::move(csvPath) } {
+    m_Present.reserve(INPUT_LATENCY_HISTORY);
+    m_Displayed.reserve(INPUT_LATENCY_HISTORY);
+
+    if (m_Path.empty()) {
+        return;
+    }
+
+    // appended to, so one file collects runs with different policies
+    m_File.open(m_Path, std::ios::app);
+    if (!m_File) {
+        Log::warn("Failed To Open Latency File \"{}\"", m_Path);
+        return;
+    }
+    if (m_File.tellp() == 0) {
+        m_File << "policy,frames_in_flight,frame,input_to_present_ms,input_to_display_ms\n";
+    }
+    Log::info("Appending Input Latency To \"{}\"", m_Path);
+}
+
+void InputLatency::input() {
+    // the earliest event waiting for a frame is the one the latency is measured from
+    if (!m_HasInput) {
+        m_PendingInput = now();
+        m_HasInput = true;
+    }
+}
+
+void InputLatency::submitted(uint64_t serial) {
+    if (!m_HasInput) {
+        return;
+    }
+    Frame frame;
+    frame.serial = serial;
+    frame.input = m_PendingInput;
+    m_Frames.push_back(frame);
+    m_HasInput = false;
+
+    if (m_Frames.size() > MAX_TAGGED_FRAMES) {
+        const Frame& oldest = m_Frames.front();
+        if (oldest.presentMilliseconds >= 0.0) {
+            finish(oldest, -1.0);
+        }
+        m_Frames.pop_front();
+    }
+}
+
+void InputLatency::presented(uint64_t serial) {
+    for (auto it = m_Frames.begin(); it != m_Frames.end(); ++it) {
+        if (it->serial != serial) {
+            continue;
+        }
+        it->presentMilliseconds = millisecondsSince(it->input);
+        if (!m_TracksDisplay) {
+            finish(*it, -1.0);
+            m_Frames.erase(it);
+        }
+        return;
+    }
+}
+
+void InputLatency::displayed(uint64_t presentId) {
+    // a present id being displayed means every earlier present has been displayed or replaced
+    while (!m_Frames.empty() && m_Frames.front().serial <= presentId) {
+        const Frame& frame = m_Frames.front();
+        if (frame.presentMilliseconds >= 0.0) {
+            finish(frame, millisecondsSince(frame.input));
+        }
+        m_Frames.pop_front();
+    }
+}
+
+void InputLatency::finish(const Frame& frame, double displayedMilliseconds) {
+    m_Samples++;
+    addSample(m_Present, m_NextPresent, frame.presentMilliseconds);
+    if (displayedMilliseconds >= 0.0) {
+        addSample(m_Displayed, m_NextDisplayed, displayedMilliseconds);
+    }
+
+    if (Trace::enabled()) {
+        Trace::counter("Input Latency (ms)", "present", frame.presentMilliseconds);
+        if (displayedMilliseconds >= 0.0) {
+            Trace::counter("Input Latency (ms)", "display", displayedMilliseconds);
+        }
+    }
+
+    if (m_File) {
+        m_File << m_Policy << ',' << m_FramesInFlight << ',' << frame.serial << ',' << frame.presentMilliseconds << ',';
+        if (displayedMilliseconds >= 0.0) {
+            m_File << displayedMilliseconds;
+        }
+        m_File << '\n';
+    }
+}
+
+void InputLatency::printSummary() {
+    if (m_Present.empty()) {
+        return;
+    }
+    Log::info("Input Latency ({} policy, {} frames in flight, last {} of {} inputs):", m_Policy, m_FramesInFlight, m_Present.size(), m_Samples);
+    printDistribution("To Present", m_Present);
+    if (m_TracksDisplay) {
+        printDistribution("To Display", m_Displayed);
+    }
+    else {
+        // without present wait nothing says when a frame reached the screen, so only the present call was timed
+        Log::info("\tTo Display: Not Measured (no present wait), the figures above end at the present call");
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+const size_t INPUT_LATENCY_HISTORY = 1000;
+
+// Input-to-present latency. GLFW callbacks stamp input events as they are polled, the next frame submitted after
+// them is tagged with the earliest unconsumed one, and its latency runs until that frame's present returns and,
+// when the display time is known (present wait), until it is on screen. Without present wait the summary says the
+// display latency was not measured rather than leaving it out.
+// Samples go to a rolling window for the exit summary and, if a path was given, are appended to a CSV labelled with
+// the present policy and frames in flight, so runs with different settings can be compared from one file.
+class InputLatency
+{
+private:
+
+    struct Frame {
+        uint64_t serial;
+        int64_t input;
+        double presentMilliseconds = -1.0;
+    };
+
+    std::string m_Policy;
+    uint32_t m_FramesInFlight;
+    bool m_TracksDisplay;
+
+    int64_t m_PendingInput = 0;
+    bool m_HasInput = false;
+    // tagged frames waiting for their present, then (when tracking display) for their display
+    std::deque<Frame> m_Frames;
+
+    std::vector<double> m_Present;
+    std::vector<double> m_Displayed;
+    size_t m_NextPresent = 0;
+    size_t m_NextDisplayed = 0;
+    uint64_t m_Samples = 0;
+
+    std::string m_Path;
+    std::ofstream m_File;
+
+    void finish(const Frame& frame, double displayedMilliseconds);
+
+public:
+
+    // tracksDisplay: displayed() will be called for presented frames
+    InputLatency(std::string csvPath, std::string policy, uint32_t framesInFlight, bool tracksDisplay);
+
+    // Call from input callbacks
+    void input();
+    // Tags the frame with serial with the pending input, if any
+    void submitted(uint64_t serial);
+    // Call once the present of the frame with serial returned
+    void presented(uint64_t serial);
+    // Every frame up to presentId is on screen
+    void displayed(uint64_t presentId);
+
+    void printSummary();
+};
@@ -0,0 +1,410 @@
+#include "Log.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Must be a power of two
+const size_t LOG_RING_CAPACITY = 4096;
+// The writer hands this much formatted text to stdout at once
+const size_t LOG_BATCH_SIZE = 64 * 1024;
+
+void LogRecord::append(LogArgType type, const void* value, size_t valueSize) {
+    if (size + 1 + valueSize > LOG_PAYLOAD_SIZE) {
+        // out of room; the writer leaves this and later placeholders unfilled
+        return;
+    }
+    payload[size] = static_cast<uint8_t>(type);
+    std::memcpy(payload + size + 1, value, valueSize);
+    size = static_cast<uint16_t>(size + 1 + valueSize);
+}
+
+void LogRecord::appendString(const char* text, size_t length) {
+    if (length <= UINT16_MAX && size + 1 + sizeof(uint16_t) + length <= LOG_PAYLOAD_SIZE) {
+        uint16_t shortLength = static_cast<uint16_t>(length);
+        payload[size] = static_cast<uint8_t>(LogArgType::String);
+        std::memcpy(payload + size + 1, &shortLength, sizeof(shortLength));
+        std::memcpy(payload + size + 1 + sizeof(shortLength), text, length);
+        size = static_cast<uint16_t>(size + 1 + sizeof(shortLength) + length);
+        return;
+    }
+
+    // long strings (validation messages, mostly) are rare enough to pay for an allocation
+    if (size + 1 + sizeof(char*) > LOG_PAYLOAD_SIZE) {
+        return;
+    }
+    char* copy = new char[length + 1];
+    std::memcpy(copy, text, length);
+    copy[length] = '\0';
+    append(LogArgType::HeapString, &copy, sizeof(copy));
+}
+
+// Bounded multi-producer queue (Vyukov). Each cell's sequence number says whether it is free for the producer
+// that claimed position pos (sequence == pos) or holds a record for the consumer (sequence == pos + 1).
+class LogRing
+{
+private:
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    std::unique_ptr<Cell[]> m_Cells;
+    size_t m_Mask;
+
+    alignas(64) std::atomic<size_t> m_EnqueuePosition{ 0 };
+    alignas(64) std::atomic<size_t> m_DequeuePosition{ 0 };
+
+    static void copy(LogRecord& destination, const LogRecord& source) {
+        std::memcpy(&destination, &source, offsetof(LogRecord, payload) + source.size);
+    }
+
+public:
+
+    explicit LogRing(size_t capacity) : m_Cells{ new Cell[capacity] }, m_Mask{ capacity - 1 } {
+        for (size_t i = 0; i < capacity; i++) {
+            m_Cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(const LogRecord& record) {
+        size_t position = m_EnqueuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_Cells[position & m_Mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (m_EnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    copy(cell.record, record);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0) {
+                return false; // full
+            }
+            else {
+                position = m_EnqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(LogRecord& record) {
+        size_t position = m_DequeuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_Cells[position & m_Mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (difference == 0) {
+                if (m_DequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    copy(record, cell.record);
+                    cell.sequence.store(position + m_Mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0) {
+                return false; // empty
+            }
+            else {
+                position = m_DequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+struct Logger {
+    std::atomic<LogLevel> level{ LogLevel::Info };
+    std::atomic<bool> running{ false };
+    std::atomic<bool> stopping{ false };
+    // callers inside submit() that may still push to the ring; stop() waits for them before draining it
+    std::atomic<uint32_t> producers{ 0 };
+    std::atomic<uint64_t> submitted{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+    int64_t startTime = std::chrono::steady_clock::now().time_since_epoch().count();
+
+    std::unique_ptr<LogRing> ring;
+    std::thread writer;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable written;
+    uint64_t writtenCount = 0;
+
+    // serializes output from the writer thread and from callers logging while it isn't running
+    std::mutex outputMutex;
+};
+
+static Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+// Reads one packed argument at cursor and appends its text to out (when out isn't null). Heap strings are
+// freed on the way, so every record must be walked to the end exactly once.
+static void readArgument(const LogRecord& record, size_t& cursor, std::string* out) {
+    LogArgType type = static_cast<LogArgType>(record.payload[cursor++]);
+    const uint8_t* value = record.payload + cursor;
+    char buffer[64];
+
+    switch (type) {
+    case LogArgType::Int: {
+        int64_t bits;
+        std::memcpy(&bits, value, sizeof(bits));
+        cursor += sizeof(bits);
+        std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(bits));
+        break;
+    }
+    case LogArgType::UInt: {
+        uint64_t bits;
+        std::memcpy(&bits, value, sizeof(bits));
+        cursor += sizeof(bits);
+        std::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(bits));
+        break;
+    }
+    case LogArgType::Float: {
+        double bits;
+        std::memcpy(&bits, value, sizeof(bits));
+        cursor += sizeof(bits);
+        std::snprintf(buffer, sizeof(buffer), "%g", bits);
+        break;
+    }
+    case LogArgType::Bool:
+        cursor += 1;
+        std::snprintf(buffer, sizeof(buffer), "%s", *value ? "true" : "false");
+        break;
+    case LogArgType::Char:
+        cursor += 1;
+        buffer[0] = static_cast<char>(*value);
+        buffer[1] = '\0';
+        break;
+    case LogArgType::Pointer: {
+        const void* pointer;
+        std::memcpy(&pointer, value, sizeof(pointer));
+        cursor += sizeof(pointer);
+        std::snprintf(buffer, sizeof(buffer), "%p", pointer);
+        break;
+    }
+    case LogArgType::String: {
+        uint16_t length;
+        std::memcpy(&length, value, sizeof(length));
+        cursor += sizeof(length) + length;
+        if (out != nullptr) {
+            out->append(reinterpret_cast<const char*>(value + sizeof(length)), length);
+        }
+        return;
+    }
+    case LogArgType::HeapString: {
+        char* text;
+        std::memcpy(&text, value, sizeof(text));
+        cursor += sizeof(text);
+        if (out != nullptr) {
+            out->append(text);
+        }
+        delete[] text;
+        return;
+    }
+    }
+
+    if (out != nullptr) {
+        out->append(buffer);
+    }
+}
+
+static void formatRecord(const LogRecord& record, int64_t startTime, std::string& out) {
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::duration(record.time - startTime)).count();
+    char prefix[48];
+    std::snprintf(prefix, sizeof(prefix), "%10.3f [%s] ", seconds, Log::levelName(record.level));
+    out.append(prefix);
+
+    // only an exact "{}" is a placeholder; other braces in messages are printed as they are
+    size_t cursor = 0;
+    for (const char* c = record.format; *c != '\0'; c++) {
+        if (c[0] == '{' && c[1] == '}' && cursor < record.size) {
+            readArgument(record, cursor, &out);
+            c++;
+        }
+        else {
+            out.push_back(*c);
+        }
+    }
+    out.push_back('\n');
+
+    while (cursor < record.size) {
+        readArgument(record, cursor, nullptr);
+    }
+}
+
+static void output(Logger& log, const std::string& text) {
+    std::lock_guard<std::mutex> lock(log.outputMutex);
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    std::fflush(stdout);
+}
+
+static void writerLoop(Logger& log) {
+    std::string batch;
+    batch.reserve(LOG_BATCH_SIZE + 1024);
+    LogRecord record;
+    uint64_t reportedDrops = 0;
+
+    for (;;) {
+        // read before draining, so everything pushed before stop() is written
+        bool stopping = log.stopping.load();
+
+        uint64_t count = 0;
+        while (batch.size() < LOG_BATCH_SIZE && log.ring->pop(record)) {
+            formatRecord(record, log.startTime, batch);
+            count++;
+        }
+
+        uint64_t drops = log.dropped.load(std::memory_order_relaxed);
+        if (drops != reportedDrops) {
+            batch += "Log ring full, dropped " + std::to_string(drops - reportedDrops) + " records\n";
+            reportedDrops = drops;
+        }
+
+        if (!batch.empty()) {
+            output(log, batch);
+            batch.clear();
+        }
+
+        if (count > 0) {
+            std::lock_guard<std::mutex> lock(log.mutex);
+            log.writtenCount += count;
+            log.written.notify_all();
+            continue;
+        }
+
+        if (stopping) {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(log.mutex);
+        log.wake.wait_for(lock, std::chrono::milliseconds(5));
+    }
+}
+
+void Log::start(LogLevel level) {
+    Logger& log = logger();
+    if (log.running) {
+        return;
+    }
+
+    log.level = level;
+    log.ring = std::make_unique<LogRing>(LOG_RING_CAPACITY);
+    log.stopping = false;
+    log.writer = std::thread(writerLoop, std::ref(log));
+    log.running = true;
+}
+
+void Log::stop() {
+    Logger& log = logger();
+    if (!log.running) {
+        return;
+    }
+
+    // later records go straight to stdout; callers that already saw the writer running finish their push, then
+    // the writer drains what's queued and the ring can go
+    log.running = false;
+    while (log.producers.load() != 0) {
+        std::this_thread::yield();
+    }
+    log.stopping = true;
+    log.wake.notify_one();
+    log.writer.join();
+    log.ring.reset();
+
+    std::lock_guard<std::mutex> lock(log.mutex);
+    log.written.notify_all();
+}
+
+void Log::setLevel(LogLevel level) {
+    logger().level.store(level, std::memory_order_relaxed);
+}
+
+LogLevel Log::getLevel() {
+    return logger().level.load(std::memory_order_relaxed);
+}
+
+bool Log::enabled(LogLevel level) {
+    return level != LogLevel::Off && level >= logger().level.load(std::memory_order_relaxed);
+}
+
+void Log::flush() {
+    Logger& log = logger();
+    if (!log.running) {
+        return;
+    }
+
+    uint64_t target = log.submitted.load();
+    std::unique_lock<std::mutex> lock(log.mutex);
+    log.wake.notify_one();
+    log.written.wait(lock, [&]() {
+        return log.writtenCount >= target || !log.running;
+    });
+}
+
+uint64_t Log::getDroppedCount() {
+    return logger().dropped.load();
+}
+
+const char* Log::levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Trace:
+        return "trace";
+    case LogLevel::Debug:
+        return "debug";
+    case LogLevel::Info:
+        return "info";
+    case LogLevel::Warn:
+        return "warn";
+    case LogLevel::Error:
+        return "error";
+    default:
+        return "off";
+    }
+}
+
+bool Log::parseLevel(const std::string& name, LogLevel& level) {
+    for (LogLevel candidate : { LogLevel::Trace, LogLevel::Debug, LogLevel::Info, LogLevel::Warn, LogLevel::Error, LogLevel::Off }) {
+        if (name == levelName(candidate)) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Log::submit(LogRecord& record) {
+    Logger& log = logger();
+
+    log.producers.fetch_add(1);
+    if (log.running) {
+        if (log.ring->push(record)) {
+            log.submitted.fetch_add(1, std::memory_order_relaxed);
+        }
+        else {
+            log.dropped.fetch_add(1, std::memory_order_relaxed);
+            size_t cursor = 0;
+            while (cursor < record.size) {
+                readArgument(record, cursor, nullptr);
+            }
+        }
+        log.producers.fetch_sub(1);
+        return;
+    }
+    log.producers.fetch_sub(1);
+
+    std::string line;
+    formatRecord(record, log.startTime, line);
+    output(log, line);
+}
+
+int64_t Log::now() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
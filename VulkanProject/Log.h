@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+enum class LogLevel : uint8_t {
+    Trace = 0, // per-object dumps (every extension, layer, framebuffer, command, ...)
+    Debug = 1, // individual init / cleanup steps
+    Info = 2,  // milestones and summaries
+    Warn = 3,
+    Error = 4,
+    Off = 5
+};
+
+enum class LogArgType : uint8_t {
+    Int,
+    UInt,
+    Float,
+    Bool,
+    Char,
+    Pointer,
+    String,    // length + bytes copied into the record
+    HeapString // pointer to a copy that did not fit; freed by the writer thread
+};
+
+// Bytes of packed arguments one record can hold
+const size_t LOG_PAYLOAD_SIZE = 232;
+
+// One log call as it travels to the writer thread. The format string must be a literal (only its pointer is
+// kept); the arguments are packed after it as a type tag followed by the raw value. Nothing is formatted until
+// the writer thread picks the record up.
+struct LogRecord {
+    int64_t time;
+    const char* format;
+    LogLevel level;
+    uint8_t argCount;
+    uint16_t size;
+    uint8_t payload[LOG_PAYLOAD_SIZE];
+
+    void append(LogArgType type, const void* value, size_t valueSize);
+    void appendString(const char* text, size_t length);
+};
+
+// Leveled logger. Log calls below the current level return after one comparison; the rest pack their arguments
+// into a LogRecord and push it into a bounded lock-free ring. A background thread formats the records ("{}" is
+// replaced by the next argument) and writes them out in batches, so no caller ever blocks on the terminal.
+// When the ring is full records are dropped and counted instead of waiting.
+// Before start() and after stop() records are formatted and written on the calling thread.
+namespace Log {
+    // Starts the writer thread. Call once, before other threads log.
+    void start(LogLevel level);
+    // Writes everything still queued and joins the writer thread
+    void stop();
+
+    void setLevel(LogLevel level);
+    LogLevel getLevel();
+    bool enabled(LogLevel level);
+
+    // Blocks until every record submitted before the call has been written
+    void flush();
+    uint64_t getDroppedCount();
+
+    const char* levelName(LogLevel level);
+    // trace, debug, info, warn, error or off
+    bool parseLevel(const std::string& name, LogLevel& level);
+
+    void submit(LogRecord& record);
+    int64_t now();
+
+    template<typename T>
+    struct Unsupported : std::false_type {};
+
+    template<typename T>
+    void pack(LogRecord& record, const T& value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            uint8_t bits = value ? 1 : 0;
+            record.append(LogArgType::Bool, &bits, sizeof(bits));
+        }
+        else if constexpr (std::is_same_v<T, char>) {
+            record.append(LogArgType::Char, &value, sizeof(value));
+        }
+        else if constexpr (std::is_enum_v<T>) {
+            int64_t bits = static_cast<int64_t>(value);
+            record.append(LogArgType::Int, &bits, sizeof(bits));
+        }
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            int64_t bits = value;
+            record.append(LogArgType::Int, &bits, sizeof(bits));
+        }
+        else if constexpr (std::is_integral_v<T>) {
+            uint64_t bits = value;
+            record.append(LogArgType::UInt, &bits, sizeof(bits));
+        }
+        else if constexpr (std::is_floating_point_v<T>) {
+            double bits = value;
+            record.append(LogArgType::Float, &bits, sizeof(bits));
+        }
+        else if constexpr (std::is_convertible_v<const T&, const char*>) {
+            const char* text = value;
+            if (text == nullptr) {
+                text = "(null)";
+            }
+            record.appendString(text, std::strlen(text));
+        }
+        else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            std::string_view text = value;
+            record.appendString(text.data(), text.size());
+        }
+        else if constexpr (std::is_pointer_v<T>) {
+            const void* pointer = value;
+            record.append(LogArgType::Pointer, &pointer, sizeof(pointer));
+        }
+        else {
+            static_assert(Unsupported<T>::value, "unsupported log argument type");
+        }
+    }
+
+    template<typename... Args>
+    void write(LogLevel level, const char* format, const Args&... args) {
+        if (!enabled(level)) {
+            return;
+        }
+
+        LogRecord record;
+        record.time = now();
+        record.format = format;
+        record.level = level;
+        record.argCount = static_cast<uint8_t>(sizeof...(Args));
+        record.size = 0;
+        (pack(record, args), ...);
+        submit(record);
+    }
+
+    template<typename... Args>
+    void trace(const char* format, const Args&... args) {
+        write(LogLevel::Trace, format, args...);
+    }
+
+    template<typename... Args>
+    void debug(const char* format, const Args&... args) {
+        write(LogLevel::Debug, format, args...);
+    }
+
+    template<typename... Args>
+    void info(const char* format, const Args&... args) {
+        write(LogLevel::Info, format, args...);
+    }
+
+    template<typename... Args>
+    void warn(const char* format, const Args&... args) {
+        write(LogLevel::Warn, format, args...);
+    }
+
+    template<typename... Args>
+    void error(const char* format, const Args&... args) {
+        write(LogLevel::Error, format, args...);
+    }
+}
@@ -0,0 +1,155 @@
+#include "Lz4.h"
+
+#include <cstring>
+
+const size_t MIN_MATCH = 4;
+// the format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end
+const size_t LAST_LITERALS = 5;
+const size_t MATCH_LIMIT = 12;
+const size_t MAX_OFFSET = 65535;
+const int HASH_BITS = 12;
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash32(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void writeLength(std::vector<uint8_t>& dst, size_t length) {
+    while (length >= 255) {
+        dst.push_back(255);
+        length -= 255;
+    }
+    dst.push_back(static_cast<uint8_t>(length));
+}
+
+static void writeSequence(std::vector<uint8_t>& dst, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength) {
+    size_t tokenMatch = matchLength - MIN_MATCH;
+    uint8_t token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+    token |= static_cast<uint8_t>(tokenMatch < 15 ? tokenMatch : 15);
+    dst.push_back(token);
+
+    if (literalLength >= 15) {
+        writeLength(dst, literalLength - 15);
+    }
+    dst.insert(dst.end(), literals, literals + literalLength);
+
+    dst.push_back(static_cast<uint8_t>(offset & 0xff));
+    dst.push_back(static_cast<uint8_t>(offset >> 8));
+
+    if (tokenMatch >= 15) {
+        writeLength(dst, tokenMatch - 15);
+    }
+}
+
+static void writeLastLiterals(std::vector<uint8_t>& dst, const uint8_t* literals, size_t literalLength) {
+    dst.push_back(static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4));
+    if (literalLength >= 15) {
+        writeLength(dst, literalLength - 15);
+    }
+    dst.insert(dst.end(), literals, literals + literalLength);
+}
+
+size_t lz4Compress(const uint8_t* src, size_t srcSize, std::vector<uint8_t>& dst) {
+    size_t start = dst.size();
+
+    // positions + 1, so 0 means empty
+    std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+
+    size_t anchor = 0;
+    size_t ip = 0;
+    while (srcSize >= MATCH_LIMIT && ip <= srcSize - MATCH_LIMIT) {
+        uint32_t sequence = read32(src + ip);
+        uint32_t h = hash32(sequence);
+        size_t candidate = table[h];
+        table[h] = static_cast<uint32_t>(ip + 1);
+
+        if (candidate == 0 || ip - (candidate - 1) > MAX_OFFSET || read32(src + candidate - 1) != sequence) {
+            ip++;
+            continue;
+        }
+        size_t ref = candidate - 1;
+
+        size_t matchLength = MIN_MATCH;
+        while (ip + matchLength < srcSize - LAST_LITERALS && src[ref + matchLength] == src[ip + matchLength]) {
+            matchLength++;
+        }
+
+        writeSequence(dst, src + anchor, ip - anchor, ip - ref, matchLength);
+        ip += matchLength;
+        anchor = ip;
+    }
+
+    writeLastLiterals(dst, src + anchor, srcSize - anchor);
+    return dst.size() - start;
+}
+
+static bool readLength(const uint8_t* src, size_t srcSize, size_t& ip, size_t& length) {
+    uint8_t byte;
+    do {
+        if (ip >= srcSize) {
+            return false;
+        }
+        byte = src[ip++];
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+    size_t ip = 0;
+    size_t op = 0;
+
+    while (ip < srcSize) {
+        uint8_t token = src[ip++];
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(src, srcSize, ip, literalLength)) {
+            return false;
+        }
+        if (literalLength > srcSize - ip || literalLength > dstSize - op) {
+            return false;
+        }
+        if (literalLength != 0) {
+            std::memcpy(dst + op, src + ip, literalLength);
+        }
+        ip += literalLength;
+        op += literalLength;
+
+        // the last sequence has no match
+        if (ip == srcSize) {
+            break;
+        }
+
+        if (srcSize - ip < 2) {
+            return false;
+        }
+        size_t offset = src[ip] | (static_cast<size_t>(src[ip + 1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > op) {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(src, srcSize, ip, matchLength)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if (matchLength > dstSize - op) {
+            return false;
+        }
+
+        // byte by byte, matches may overlap their own output
+        const uint8_t* match = dst + op - offset;
+        for (size_t i = 0; i < matchLength; i++) {
+            dst[op + i] = match[i];
+        }
+        op += matchLength;
+    }
+
+    return op == dstSize;
+}
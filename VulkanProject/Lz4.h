@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LZ4 block format (no frame header, no checksums); the sizes live in the asset archive's table of contents.
+// Greedy single-probe compressor: decompression speed is what matters at load time, ratio comes second.
+
+// Appends the compressed form of src to dst and returns the number of bytes appended
+size_t lz4Compress(const uint8_t* src, size_t srcSize, std::vector<uint8_t>& dst);
+
+// Decompresses exactly dstSize bytes. Returns false on malformed input instead of reading or writing out of bounds.
+bool lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
@@ -3,637 +3,550 @@
 
 #include <cstdint>
 #include <optional>
-#include <iostream>
 #include <stdexcept>
 #include <cstdlib>
 #include <vector>
-#include <set>
 #include <fstream>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include <iostream>
 
-
-#ifdef NDEBUG
-const bool enableValidationLayers = false;
-#else
-const bool enableValidationLayers = true;
-#endif
+#include "Options.h"
+#include "PipelineCache.h"
+#include "GraphicsPipeline.h"
+#include "PipelineBuildService.h"
+#include "PipelineRegistry.h"
+#include "ShaderVariants.h"
+#include "EmbeddedShaders.h"
+#include "ShaderWatcher.h"
+#include "DeferredDeletion.h"
+#include "ResourceCache.h"
+#include "Mesh.h"
+#include "AssetArchive.h"
+#include "Log.h"
+#include "Trace.h"
+#include "GpuProfiler.h"
+#include "FrameMetrics.h"
+#include "FrameBenchmark.h"
+#include "FrameReadback.h"
+#include "BatchLoader.h"
+#include "RenderDevice.h"
+#include "PresentPolicy.h"
+#include "InputLatency.h"
+#include "FrameLimiter.h"
+#include "DynamicResolution.h"
+
+
+// the most frames in flight any present policy uses; per-frame arrays are sized by it
 const int MAX_FRAMES_IN_FLIGHT = 2;
+// with --on-demand and a shader watcher, how often an idle loop wakes to check for reloaded shaders
+const double SHADER_POLL_SECONDS = 0.25;
+// a hidden or occluded window may never display a frame, so present pacing gives up after this long (nanoseconds)
+const uint64_t PRESENT_WAIT_TIMEOUT = 100 * 1000 * 1000;
+// Resize events arrive in bursts while the window is dragged; only rebuild once they settle
+const double RESIZE_SETTLE_SECONDS = 0.1;
+const std::string RESOURCE_DIRECTORY = "res";
+const std::string MESH_NAME = "object.csv";
 
 
-// Proxy Functions
-VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
-    auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
-    if (func != nullptr) {
-        return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
-    }
-    else {
-        return VK_ERROR_EXTENSION_NOT_PRESENT;
-    }
-}
-
-void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator) {
-    auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
-    if (func != nullptr) {
-        func(instance, debugMessenger, pAllocator);
-    }
-}
-
-// Structs
-
-struct QueueFamilyIndices {
-    std::optional<uint32_t> graphicsFamily;
-    std::optional<uint32_t> presentFamily;
-
-    bool isComplete() {
-        return graphicsFamily.has_value() && presentFamily.has_value();
-    }
-};
-
-struct SwapChainSupportDetails {
-    VkSurfaceCapabilitiesKHR capabilities;
-    std::vector<VkSurfaceFormatKHR> formats;
-    std::vector<VkPresentModeKHR> presentModes;
-};
-
 // Application
-class HelloTriangleApplication {
+class RenderSession {
 public:
     const uint32_t WIDTH = 800, HEIGHT = 800;
     const std::string TITLE = "Vulkan";
 
-    void run() {
-        initWindow();
-        initVulkan();
-        mainLoop();
-        cleanup();
+    RenderSession(RenderDevice& renderDevice, AppOptions options) : renderDevice{ renderDevice }, options{ options }, colorMode{ options.colorMode } {
+        instance = renderDevice.getInstance();
+        sessionId = renderDevice.registerSession();
     }
 
-private:
-
-
-    const std::vector<const char*> validationLayers = {
-        "VK_LAYER_KHRONOS_validation"
-    };
-
-
-    const std::vector<const char*> deviceExtensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
-
-
-    static std::vector<char> readFile(const std::string& filename) {
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-        if (!file.is_open()) {
-            throw std::runtime_error("failed to open file!");
+    void run() {
+        try {
+            createTargets();
+            if (!options.batchInputs.empty()) {
+                // the first files load while Vulkan initializes
+                batchLoader = std::make_unique<BatchLoader>(expandBatchInputs(options.batchInputs), options.batchLookahead);
+            }
+            initVulkan();
+            if (options.pipelineBenchThreads > 0) {
+                runPipelineBenchmark();
+            }
+            else if (batchLoader) {
+                runBatch();
+            }
+            else {
+                mainLoop();
+            }
+            if (frameBenchmark) {
+                VkPhysicalDeviceProperties properties;
+                vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+                VkExtent2D extent = targets[0]->swapChainExtent;
+                benchmarkRegressed = !frameBenchmark->report(properties.deviceName, extent.width, extent.height, options.headless);
+            }
+        }
+        catch (...) {
+            // The device outlives this session, so whatever it created (and its memory accounting) has to be handed
+            // back even when it fails part way. A fence may have been reset without its submit going through, so
+            // this waits for the whole device; it only happens on failure.
+            if (device != VK_NULL_HANDLE) {
+                renderDevice.waitIdle();
+            }
+            cleanup();
+            throw;
+        }
+        cleanup();
+        if (benchmarkRegressed) {
+            throw std::runtime_error("benchmark regressed against the baseline!");
         }
-
-        size_t fileSize = (size_t)file.tellg();
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-
-        file.close();
-
-        return buffer;
     }
 
+private:
 
+    // Instance, device, queues and pipeline cache are shared with every other session; the handles below are copies
+    RenderDevice& renderDevice;
+    uint32_t sessionId = 0;
+    AppOptions options;
 
-
-
-    GLFWwindow* window;
     VkInstance instance;
-    VkDebugUtilsMessengerEXT debugMessenger;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-    VkDevice device;
+    VkDevice device = VK_NULL_HANDLE;
     VkQueue graphicsQueue, presentQueue;
-    VkSurfaceKHR surface;
-    VkSwapchainKHR swapChain;
-    std::vector<VkImage> swapChainImages;
-    VkFormat swapChainImageFormat;
-    VkExtent2D swapChainExtent;
-    std::vector<VkImageView> swapChainImageViews;
-    VkRenderPass renderPass;
-    VkPipelineLayout pipelineLayout;
-    VkPipeline graphicsPipeline;
-    std::vector<VkFramebuffer> swapChainFramebuffers;
-    VkCommandPool commandPool;
-    std::vector<VkCommandBuffer> commandBuffers;
-
-    std::vector<VkSemaphore> imageAvailableSemaphores;
+
+    // One window and its swapchain, or with --headless the offscreen images standing in for one. Everything sized by
+    // the swapchain lives here, so each window is rebuilt on its own when resized; the render pass, pipelines, vertex
+    // data, command pool and frame fences are shared by all of them.
+    struct RenderTarget {
+        RenderSession* session = nullptr;
+        uint32_t index = 0;
+        GLFWwindow* window = nullptr;
+        VkSurfaceKHR surface = VK_NULL_HANDLE;
+        VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+        // swapchain images, or with --headless images created by createOffscreenTargets (backed by offscreenImageMemory)
+        std::vector<VkImage> swapChainImages;
+        std::vector<VkDeviceMemory> offscreenImageMemory;
+        VkFormat swapChainImageFormat = VK_FORMAT_UNDEFINED;
+        VkExtent2D swapChainExtent = {};
+        VkImageUsageFlags swapChainImageUsage = 0;
+        std::vector<VkImageView> swapChainImageViews;
+        // with dynamic resolution the render pass draws into these instead, one per swapchain image and of the same
+        // size, within the scaled extent; that part is then blitted up into the swapchain image
+        std::vector<VkImage> sceneImages;
+        std::vector<VkDeviceMemory> sceneImageMemory;
+        std::vector<VkImageView> sceneImageViews;
+        std::vector<VkFramebuffer> swapChainFramebuffers;
+        std::vector<VkCommandBuffer> commandBuffers;
+        // re-recorded right before their next submission, once their previous one is known to be done
+        std::vector<bool> commandBufferStale;
+        std::vector<DrawCounters> commandBufferCounters;
+        std::vector<VkFence> imagesInFlight;
+        VkSemaphore imageAvailableSemaphores[MAX_FRAMES_IN_FLIGHT] = {};
+        PresentSettings presentSettings;
+        // the image acquired for the frame being built
+        uint32_t imageIndex = 0;
+        // with present wait: the id of the last present on the current swapchain, and of the last one seen displayed
+        uint64_t presentId = 0;
+        uint64_t displayedId = 0;
+        PresentTiming presentTiming;
+        bool framebufferResized = false;
+        double lastResizeTime = 0.0;
+
+        // CPU cost of this window, printed by printTargetStats
+        uint64_t frames = 0;
+        double acquireMilliseconds = 0.0;
+        double recordMilliseconds = 0.0;
+        uint32_t rebuilds = 0;
+    };
+    // unique_ptr so the pointers handed to GLFW stay put
+    std::vector<std::unique_ptr<RenderTarget>> targets;
+    // the format the render pass and pipelines were built for, which every window's swapchain has to use
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline graphicsPipeline = VK_NULL_HANDLE;
+    ResourceCache resourceCache;
+    std::unique_ptr<AssetArchive> assetArchive;
+    std::unique_ptr<ShaderLibrary> shaderLibrary;
+    VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+    VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+    std::unique_ptr<ShaderVariantCache> shaderVariants;
+    ColorMode colorMode = ColorMode::Vertex;
+    bool shaderVariantChanged = false;
+    // the variant being switched to, drawn with once it's built
+    std::shared_future<VkPipeline> pendingVariant;
+
+    // Shader hot reload: new modules and the pipeline being built from them, swapped in once the build is done
+    struct PendingShaderReload {
+        VkShaderModule vertShaderModule;
+        VkShaderModule fragShaderModule;
+        std::unique_ptr<ShaderVariantCache> shaderVariants;
+        std::shared_future<VkPipeline> pipeline;
+    };
+    std::unique_ptr<ShaderWatcher> shaderWatcher;
+    std::optional<PendingShaderReload> shaderReload;
+    DeferredDeletionQueue deletionQueue;
+    PipelineCache* pipelineCache = nullptr;
+    PipelineBuildService* pipelineBuildService = nullptr;
+    std::unique_ptr<PipelineRegistry> pipelineRegistry;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    std::vector<Vertex> vertices;
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory vertexBufferMemory = VK_NULL_HANDLE;
+    // --batch: every frame in flight draws its own file, copied from a mapped staging buffer into a device local
+    // vertex buffer by the frame's command buffer. Both grow to the largest file seen.
+    struct BatchSlot {
+        VkBuffer stagingBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        VkBuffer vertexBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+        VkDeviceSize capacity = 0;
+        uint32_t vertexCount = 0;
+        std::string name;
+    };
+    std::unique_ptr<BatchLoader> batchLoader;
+    std::vector<BatchSlot> batchSlots;
+    BatchItem batchItem;
+    // with --gpu-profile command buffers are recorded every frame, since each frame writes its own query pool
+    std::unique_ptr<GpuProfiler> gpuProfiler;
+    // the "Frame" region opens in the frame's first command buffer and closes in its last, spanning every window
+    uint32_t gpuFrameRegion = 0;
+    std::unique_ptr<FrameMetrics> frameMetrics;
+    // windowed only; fed by the input callbacks
+    std::unique_ptr<InputLatency> inputLatency;
+    std::unique_ptr<FrameBenchmark> frameBenchmark;
+    std::unique_ptr<FrameLimiter> frameLimiter;
+    // --dynamic-resolution, when the color format can be blitted and GPU timestamps are available
+    std::unique_ptr<DynamicResolution> dynamicResolution;
+    bool benchmarkRegressed = false;
+    // with --readback command buffers are also recorded every frame, since each copies into its frame's staging buffer
+    std::unique_ptr<FrameReadback> frameReadback;
+    bool pipelineStatisticsEnabled = false;
+
+    // every window's present waits on the frame's one renderFinished semaphore
     std::vector<VkSemaphore> renderFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> imagesInFlight;
+    // every submission gets the next serial; a frame's fence signalling means its serial (and all before) completed
+    uint64_t frameSerials[MAX_FRAMES_IN_FLIGHT] = {};
+    uint64_t submittedFrames = 0;
+    uint64_t completedFrames = 0;
     size_t currentFrame = 0;
-    bool framebufferResized = false;
+    // set by the first window's present policy; headless runs always use MAX_FRAMES_IN_FLIGHT
+    uint32_t framesInFlight = MAX_FRAMES_IN_FLIGHT;
+    // VK_KHR_present_wait is available, so presents carry ids and the policy's pacing applies
+    bool presentWait = false;
+
+    // Scratch for building a frame's one submit and one present over every window, kept to avoid allocating per frame
+    struct FrameBatch {
+        std::vector<RenderTarget*> targets;
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<VkPipelineStageFlags> waitStages;
+        std::vector<VkCommandBuffer> commandBuffers;
+        std::vector<VkSwapchainKHR> swapChains;
+        std::vector<uint32_t> imageIndices;
+        std::vector<uint64_t> presentIds;
+        std::vector<VkResult> results;
+    };
+    FrameBatch frameBatch;
+    uint64_t presentCalls = 0;
+    uint64_t presentedImages = 0;
+    double presentMilliseconds = 0.0;
+
+    // Idle throttling, see waitForFrame. Starts dirty so the first frame is drawn.
+    bool frameDirty = true;
+    double nextTick = 0.0;
+    double lastFrameTime = 0.0;
+    uint64_t idleWaits = 0;
 
     // Init
-    void initWindow() {
-        glfwInit();
 
-        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    // One target per window, or a single windowless one when headless
+    void createTargets() {
+        TRACE_SCOPE("createTargets", "init");
+        if (!options.headless) {
+            glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        }
+
+        uint32_t count = options.headless ? 1 : options.windowCount;
+        for (uint32_t i = 0; i < count; i++) {
+            auto target = std::make_unique<RenderTarget>();
+            target->session = this;
+            target->index = i;
 
-        window = glfwCreateWindow(WIDTH, HEIGHT, TITLE.c_str(), nullptr, nullptr);
-        std::cout << "Created Window {size: (" << WIDTH << ", " << HEIGHT << "), title:\"" << TITLE << "\"}\n";
-        glfwSetWindowUserPointer(window, this);
-        glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+            if (!options.headless) {
+                std::string title = i == 0 ? TITLE : TITLE + " (" + std::to_string(i + 1) + ")";
+                target->window = glfwCreateWindow(WIDTH, HEIGHT, title.c_str(), nullptr, nullptr);
+                if (target->window == nullptr) {
+                    throw std::runtime_error("failed to create window!");
+                }
+                Log::info("Created Window {size: ({}, {}), title:\"{}\"}", WIDTH, HEIGHT, title);
+                glfwSetWindowUserPointer(target->window, target.get());
+                glfwSetFramebufferSizeCallback(target->window, framebufferResizeCallback);
+                glfwSetKeyCallback(target->window, keyCallback);
+                glfwSetMouseButtonCallback(target->window, mouseButtonCallback);
+                glfwSetCursorPosCallback(target->window, cursorPosCallback);
+                glfwSetScrollCallback(target->window, scrollCallback);
+                glfwSetWindowRefreshCallback(target->window, windowRefreshCallback);
+                glfwSetWindowIconifyCallback(target->window, windowIconifyCallback);
+            }
+            targets.push_back(std::move(target));
+        }
     }
 
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
-        auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
-        app->framebufferResized = true;
+        auto target = reinterpret_cast<RenderTarget*>(glfwGetWindowUserPointer(window));
+        target->framebufferResized = true;
+        target->lastResizeTime = glfwGetTime();
+        target->session->frameDirty = true;
     }
 
-    void initVulkan() {
-        std::cout << "Initializing Vulkan\n";
-        createInstance();
-        setupDebugMessenger();
-        createSurface();
-        pickPhysicalDevice();
-        createLogicalDevice();
-        createSwapChain();
-        createImageViews();
-        createRenderPass();
-        createGraphicsPipeline();
-        createFramebuffers();
-        createCommandPool();
-        createCommandBuffers();
-        createSyncObjects();
+    // the window's contents were damaged, e.g. it was uncovered
+    static void windowRefreshCallback(GLFWwindow* window) {
+        reinterpret_cast<RenderTarget*>(glfwGetWindowUserPointer(window))->session->frameDirty = true;
     }
 
-    void recreateSwapChain() {
-        std::cout << "Recreating SwapChain\n";
-
-        int width = 0, height = 0;
-        glfwGetFramebufferSize(window, &width, &height);
-        while (width == 0 || height == 0) {
-            glfwGetFramebufferSize(window, &width, &height);
-            glfwWaitEvents();
-        }
-
-        vkDeviceWaitIdle(device);
-
-        cleanupSwapChain();
-
-        createSwapChain();
-        createImageViews();
-        createRenderPass();
-        createGraphicsPipeline();
-        createFramebuffers();
-        createCommandBuffers();
+    static void windowIconifyCallback(GLFWwindow* window, int iconified) {
+        reinterpret_cast<RenderTarget*>(glfwGetWindowUserPointer(window))->session->frameDirty = true;
     }
-    /*
-std::cout << "\n";
-    */
-
-
-    void cleanupSwapChain() {
-        std::cout << "Cleaning Up SwapChain + dependencies (Tasks 0->6)\n";
-
-        int i = 0;
-        for (auto framebuffer : swapChainFramebuffers) {
-            vkDestroyFramebuffer(device, framebuffer, nullptr);
-            std::cout << "(0." << i << "/6)Destroyed Framebuffer " << i << "\n";
-            i++;
 
+    // Any input starts an input latency measurement and needs a frame; the other callbacks exist only for that
+    static void recordInput(GLFWwindow* window) {
+        auto app = reinterpret_cast<RenderTarget*>(glfwGetWindowUserPointer(window))->session;
+        app->frameDirty = true;
+        if (app->inputLatency) {
+            app->inputLatency->input();
         }
-
-        vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-        std::cout << "(1/6) Freed " << commandBuffers.size() << " Command Buffers\n";
-
-        vkDestroyPipeline(device, graphicsPipeline, nullptr);
-        std::cout << "(2/6) Destroyed Graphics Pipeline\n";
-
-        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-        std::cout << "(3/6) Destroyed Pipeline Layout\n";
-
-        vkDestroyRenderPass(device, renderPass, nullptr);
-        std::cout << "(4/6) Destroyed Render Pass\n";
-
-        i = 0;
-        for (auto imageView : swapChainImageViews) {
-            vkDestroyImageView(device, imageView, nullptr);
-            std::cout << "(5." << i << "/6) Destroyed Image View " << i << "\n";
-            i++;
-        }
-
-        vkDestroySwapchainKHR(device, swapChain, nullptr);
-        std::cout << "(6/6) Destroyed Swapshain\n";
     }
 
-
-    // Instance
-
-    std::vector<const char*> getRequiredExtensions() {
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
-
-        if (enableValidationLayers) {
-            extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
-        }
-
-        return extensions;
+    static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+        recordInput(window);
     }
 
-    void createInstance() {
-        std::cout << "Creating Instance\n";
-
-        if (enableValidationLayers && !checkValidationLayerSupport()) {
-            throw std::runtime_error("validation layers requested, but not available!");
-        }
-
-        if (enableValidationLayers) {
-            std::cout << "Validation Layers: Enabled\n";
-        }
-        else if (checkValidationLayerSupport()) {
-            std::cout << "Validation Layers: Disabled (available)\n";
-        }
-        else {
-            std::cout << "Validation Layers: Disabled\n";
-        }
-
-        VkApplicationInfo appInfo{};
-        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-        appInfo.pApplicationName = "1001 ways to fail at making a Triangle";
-        appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.pEngineName = "KAT Engine";
-        appInfo.engineVersion = VK_MAKE_VERSION(1, 6, 9);
-        appInfo.apiVersion = VK_API_VERSION_1_2;
-
-        std::cout << "AppInfo:\n";
-        std::cout << "\tApplication Name: \"" << appInfo.pApplicationName << "\"\n";
-        std::cout << "\tApplication Version: 1.0.0\n";
-        std::cout << "\tEngine Name: \"" << appInfo.pEngineName << "\"\n";
-        std::cout << "\tEngine Version: 1.6.9\n";
-        std::cout << "\tVulkan API Version: 1.2\n";
-
-
-        VkInstanceCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-        createInfo.pApplicationInfo = &appInfo;
-
-        auto extensions = getRequiredExtensions();
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
-        createInfo.ppEnabledExtensionNames = extensions.data();
-
-        if (enableValidationLayers) {
-            createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-            createInfo.ppEnabledLayerNames = validationLayers.data();
-            std::cout << "Validation Layers (" << validationLayers.size() << "):\n";
-            for (std::string name : validationLayers) {
-                std::cout << "\t" << name << "\n";
-            }
-        }
-        else {
-            createInfo.enabledLayerCount = 0;
-            std::cout << "Validation Layers Disabled. Not enabling any layers.\n";
-        }
+    static void cursorPosCallback(GLFWwindow* window, double x, double y) {
+        recordInput(window);
+    }
 
-        uint32_t extensionCount = 0;
-        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
-        std::vector<VkExtensionProperties> extensionsav(extensionCount);
-        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensionsav.data());
-        std::cout << "Available Instance Extensions (" << extensionsav.size() << "):\n";
+    static void scrollCallback(GLFWwindow* window, double x, double y) {
+        recordInput(window);
+    }
 
-        for (const auto& extension : extensionsav) {
-            std::cout << '\t' << extension.extensionName << '\n';
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+        recordInput(window);
+        auto app = reinterpret_cast<RenderTarget*>(glfwGetWindowUserPointer(window))->session;
+        if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+            app->colorMode = static_cast<ColorMode>((static_cast<int32_t>(app->colorMode) + 1) % 3);
+            app->shaderVariantChanged = true;
         }
-
-
-        if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create instance!");
+        if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+            // trace -> debug -> info -> warn -> error -> trace
+            LogLevel level = static_cast<LogLevel>((static_cast<int>(Log::getLevel()) + 1) % static_cast<int>(LogLevel::Off));
+            Log::setLevel(level);
+            Log::write(level, "Log Level: {}", Log::levelName(level));
         }
-        std::cout << "Created Instance\n";
     }
 
-    // Validation Layers
-
-    void setupDebugMessenger() {
-        if (!enableValidationLayers) return;
-        std::cout << "Setting Up Debug Messenger\n";
-
-        VkDebugUtilsMessengerCreateInfoEXT createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-        createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-        createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-        createInfo.pfnUserCallback = debugCallback;
-        createInfo.pUserData = nullptr; // Optional
-
-        std::cout << "Debug Messenger:\n";
-        std::cout << "\tSeverity: Warning + Error\n";
-        std::cout << "\tTypes: General, Validation, Performance\n";
-
-        if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS) {
-            throw std::runtime_error("failed to set up debug messenger!");
-        }
-        std::cout << "Created Debug Messenger\n";
+    bool resizeSettled(const RenderTarget& target) {
+        return glfwGetTime() - target.lastResizeTime >= RESIZE_SETTLE_SECONDS;
     }
 
-    bool checkValidationLayerSupport() {
-        uint32_t layerCount;
-        vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
-        std::cout << "Available Instance Layers (" << layerCount << "):\n";
-
-        std::vector<VkLayerProperties> availableLayers(layerCount);
-        vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
-
-        for (VkLayerProperties prop : availableLayers) {
-            std::cout << "\t" << prop.layerName << ":\n";
-            std::cout << "\t\tSpecification Version: " << prop.specVersion << "\n";
-            std::cout << "\t\tImplementation Verison: " << prop.implementationVersion << "\n";
-            std::cout << "\t\tDescription: " << prop.description << "\n";
-        }
-
-
-        for (const char* layerName : validationLayers) {
-            std::cout << "Checking For Layer: " << layerName << '\n';
-            bool layerFound = false;
-
-            for (const auto& layerProperties : availableLayers) {
-                if (strcmp(layerName, layerProperties.layerName) == 0) {
-                    std::cout << "Found Matching Layer (" << layerName << ")\n";
-                    layerFound = true;
-                    break;
-                }
-            }
+    bool windowMinimized(const RenderTarget& target) {
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(target.window, &width, &height);
+        return width == 0 || height == 0;
+    }
 
-            if (!layerFound) {
-                std::cout << "Matching Layer Not Found (" << layerName << ")\n";
-                return false;
+    // closing any window ends the session
+    bool windowClosed() {
+        for (const auto& target : targets) {
+            if (glfwWindowShouldClose(target->window)) {
+                return true;
             }
         }
-        std::cout << "Validation isn't noita'd.\n";
-        return true;
-        // hmmmmmmmmmmmmmmmmmmm
-
-        std::cout << "how?\n";
         return false;
     }
 
-
-
-    // Physical Device
-
-    void pickPhysicalDevice() {
-        uint32_t deviceCount = 0;
-        vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
-
-        std::cout << "Physical Devices With Vulkan Support: " << deviceCount << "\n";
-
-        if (deviceCount == 0) {
-            throw std::runtime_error("failed to find GPUs with Vulkan support!");
-        }
-
-        std::vector<VkPhysicalDevice> devices(deviceCount);
-        vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
-
-        for (const auto& device : devices) {
-            if (isDeviceSuitable(device)) {
-                std::cout << "Device " << device << ": Suitable\n";
-                physicalDevice = device;
-                std::cout << "Picking device " << physicalDevice << "\n";
-                break;
+    void initVulkan() {
+        TRACE_SCOPE("initVulkan", "init");
+        Log::info("Initializing Vulkan");
+        if (!options.headless) {
+            createSurfaces();
+        }
+        // the first session picks the device; later sessions, and this one's other windows, only check they can
+        // present with it
+        for (auto& target : targets) {
+            renderDevice.initialize(target->surface);
+        }
+        physicalDevice = renderDevice.getPhysicalDevice();
+        device = renderDevice.getDevice();
+        graphicsQueue = renderDevice.getGraphicsQueue();
+        presentQueue = renderDevice.getPresentQueue();
+        pipelineStatisticsEnabled = renderDevice.pipelineStatisticsEnabled();
+        presentWait = !options.headless && renderDevice.presentWaitEnabled();
+        pipelineCache = &renderDevice.getPipelineCache();
+        pipelineBuildService = &renderDevice.getPipelineBuildService();
+
+        createPipelineRegistry();
+        openAssetArchive();
+        createShaderModules();
+        createShaderWatcher();
+        for (auto& target : targets) {
+            if (options.headless) {
+                createOffscreenTargets(*target);
             }
             else {
-                std::cout << "Device " << device << ": Unsuitable\n";
+                createSwapChain(*target);
             }
+            createImageViews(*target);
         }
-
-        if (physicalDevice == VK_NULL_HANDLE) {
-            throw std::runtime_error("failed to find a suitable GPU!");
-        }
-    }
-
-    bool isDeviceSuitable(VkPhysicalDevice device) {
-        QueueFamilyIndices indices = findQueueFamilies(device);
-
-        bool extensionsSupported = checkDeviceExtensionSupport(device);
-        if (extensionsSupported) {
-            std::cout << "Device Extensions Supported: true\n";
-        }
-        else {
-            std::cout << "Device Extensions Supported: false\n";
-        }
-
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
-            SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
-            swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
-        }
-
-        if (swapChainAdequate) {
-            std::cout << "Swap Chain: Adequate\n";
+        // the first window's present policy decides how many frames are in flight, so everything sized by that
+        // comes after the swapchains
+        if (!options.headless) {
+            framesInFlight = targets[0]->presentSettings.framesInFlight;
+            Log::info("Present Policy: {} ({} frames in flight, present wait {})", presentPolicyName(options.presentPolicy), framesInFlight, presentWait ? "on" : "off");
         }
-        else {
-            std::cout << "Swap Chain: Inadequate\n";
+        createGpuProfiler();
+        createDynamicResolution();
+        createFrameMetrics();
+        createRenderPass();
+        createGraphicsPipeline();
+        for (auto& target : targets) {
+            createFramebuffers(*target);
         }
-
-        if (indices.isComplete()) {
-            std::cout << "Queue Family Indices: Complete\n";
+        createFrameReadback();
+        createCommandPool();
+        if (batchLoader) {
+            batchSlots.resize(framesInFlight);
         }
         else {
-            std::cout << "Queue Family Indices: Incomplete\n";
-        }
-
-        return indices.isComplete() && extensionsSupported && swapChainAdequate;
-    }
-
-
-    bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
-        uint32_t extensionCount;
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
-
-        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
-
-        std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
-
-        for (const auto& extension : availableExtensions) {
-            requiredExtensions.erase(extension.extensionName);
-        }
-
-        if (!requiredExtensions.empty()) {
-            std::cout << "Unsupported Extensions (" << requiredExtensions.size() << "):\n";
-            for (std::string n : requiredExtensions) {
-                std::cout << "\t" << n << "\n";
-            }
+            createVertexBuffer();
         }
-
-        return requiredExtensions.empty();
-    }
-
-    // Logical Device
-    void printAvailableDeviceExtensions() {
-        uint32_t extensionCount = 0;
-        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
-        std::vector<VkExtensionProperties> extensionsav(extensionCount);
-        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensionsav.data());
-        std::cout << "Available Device Extensions (" << extensionCount << "):\n";
-
-        for (const auto& extension : extensionsav) {
-            std::cout << '\t' << extension.extensionName << '\n';
+        for (auto& target : targets) {
+            createCommandBuffers(*target);
         }
+        createSyncObjects();
     }
 
+    // Viewport and scissor are dynamic, so only the window's swapchain and the objects sized by it are rebuilt here;
+    // other windows keep theirs. The render pass and pipeline survive unless the surface format changes.
+    void recreateSwapChain(RenderTarget& target) {
+        TRACE_SCOPE("recreateSwapChain", "swapchain");
 
-    void createLogicalDevice() {
-        std::cout << "Creating Logical Device\n";
-
-        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
-        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(),indices.presentFamily.value() };
-        float queuePriority = 1.0f;
-        std::cout << "Unique Queue Families: " << uniqueQueueFamilies.size() << "\n";
-
-        for (uint32_t queueFamily : uniqueQueueFamilies) {
-            std::cout << "Creating Queue Family for Index " << queueFamily << "\n";
-            std::cout << "\tQueue Priority: " << queuePriority << "\n";
-
-            VkDeviceQueueCreateInfo queueCreateInfo{};
-            queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-            queueCreateInfo.queueFamilyIndex = queueFamily;
-            queueCreateInfo.queueCount = 1;
-            queueCreateInfo.pQueuePriorities = &queuePriority;
-            queueCreateInfos.push_back(queueCreateInfo);
+        // a minimized window keeps its swapchain until it is restored, while the others go on drawing
+        if (windowMinimized(target)) {
+            target.framebufferResized = true;
+            return;
         }
+        Log::info("Recreating SwapChain {}", target.index);
 
+        waitIdle();
 
-        VkPhysicalDeviceFeatures deviceFeatures{};
-
-        VkDeviceCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-
-
-        createInfo.pQueueCreateInfos = queueCreateInfos.data();
-        createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+        target.framebufferResized = false;
+        target.rebuilds++;
+        // present ids belong to the old swapchain
+        target.presentId = 0;
+        target.displayedId = 0;
+        target.presentTiming.restart();
 
-        createInfo.pEnabledFeatures = &deviceFeatures;
+        VkSwapchainKHR oldSwapChain = target.swapChain;
 
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        cleanupSwapChain(target);
 
-        std::cout << "Enabled Device Extensions (" << deviceExtensions.size() << "):\n";
-        for (std::string n : deviceExtensions) {
-            std::cout << "\t" << n << "\n";
+        createSwapChain(target, oldSwapChain);
+        vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+        Log::debug("Destroyed Old SwapChain");
 
+        if (frameReadback && target.index == 0) {
+            frameReadback->resize(target.swapChainExtent);
         }
 
-        printAvailableDeviceExtensions();
-
-        if (enableValidationLayers) {
-            createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-            createInfo.ppEnabledLayerNames = validationLayers.data();
-        }
-        else {
-            createInfo.enabledLayerCount = 0;
+        if (target.swapChainImageFormat != colorFormat) {
+            Log::info("SwapChain Format Changed, Rebuilding Render Pass + Pipeline");
+            colorFormat = target.swapChainImageFormat;
+            // variant builds still in flight reference the old render pass
+            pipelineBuildService->waitIdle();
+            vkDestroyRenderPass(device, renderPass, nullptr);
+            createRenderPass();
+            createGraphicsPipeline();
         }
 
-        if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create logical device!");
+        createImageViews(target);
+        if (dynamicResolution) {
+            createSceneTargets(target);
         }
+        createFramebuffers(target);
+        createCommandBuffers(target);
 
-        vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
-        vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
-
-        std::cout << "Logical Device Created\n";
-
+        target.imagesInFlight.assign(target.swapChainImages.size(), VK_NULL_HANDLE);
+        frameDirty = true;
     }
 
-    // Queue Families
-
-    QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) {
-        QueueFamilyIndices indices;
-
-        uint32_t queueFamilyCount = 0;
-        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
-
-        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+    // Destroys everything sized by the target's swapchain. The swapchain handle itself is kept alive so it can be
+    // handed to vkCreateSwapchainKHR as oldSwapchain.
+    void cleanupSwapChain(RenderTarget& target) {
+        TRACE_SCOPE("cleanupSwapChain", "swapchain");
+        Log::debug("Cleaning Up SwapChain Dependencies (Tasks 0->2)");
 
         int i = 0;
-        for (const auto& queueFamily : queueFamilies) {
-            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-                indices.graphicsFamily = i;
-            }
-
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        for (auto framebuffer : target.swapChainFramebuffers) {
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+            Log::trace("(0.{}/2)Destroyed Framebuffer {}", i, i);
+            i++;
 
-            if (presentSupport) {
-                indices.presentFamily = i;
-            }
+        }
+        target.swapChainFramebuffers.clear();
 
-            if (indices.isComplete()) {
-                break;
-            }
+        if (!target.commandBuffers.empty()) {
+            vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(target.commandBuffers.size()), target.commandBuffers.data());
+            Log::debug("(1/2) Freed {} Command Buffers", target.commandBuffers.size());
+            target.commandBuffers.clear();
+        }
 
+        i = 0;
+        for (auto imageView : target.swapChainImageViews) {
+            vkDestroyImageView(device, imageView, nullptr);
+            Log::trace("(2.{}/2) Destroyed Image View {}", i, i);
             i++;
         }
+        target.swapChainImageViews.clear();
 
-        return indices;
+        destroySceneTargets(target);
     }
 
 
     // Surface
 
-    void createSurface() {
-        if (glfwCreateWindowSurface(instance, window, NULL, &surface) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create window surface");
+    void createSurfaces() {
+        TRACE_SCOPE("createSurfaces", "init");
+        for (auto& target : targets) {
+            if (glfwCreateWindowSurface(instance, target->window, NULL, &target->surface) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create window surface");
+            }
+            Log::debug("Created window surface {}", target->index);
         }
-        std::cout << "Created window surface\n";
     }
 
     // Swap Chain
-    SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device) {
-        SwapChainSupportDetails details;
-
-        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
-
-        uint32_t formatCount;
-        vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
-
-        if (formatCount != 0) {
-            details.formats.resize(formatCount);
-            vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
-        }
-
-        uint32_t presentModeCount;
-        vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
-
-        if (presentModeCount != 0) {
-            details.presentModes.resize(presentModeCount);
-            vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
-        }
-
-        return details;
-    }
-
-
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
+        // every window draws with the same render pass, so once one has picked a format the others keep to it
         for (const auto& availableFormat : availableFormats) {
-            if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+            if (availableFormat.format == colorFormat) {
                 return availableFormat;
             }
         }
-
-        return availableFormats[0];
-    }
-
-    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-        for (const auto& availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                return availablePresentMode;
+        for (const auto& availableFormat : availableFormats) {
+            if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+                return availableFormat;
             }
         }
 
-        return VK_PRESENT_MODE_FIFO_KHR;
+        return availableFormats[0];
     }
 
-    VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
+    VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window) {
         if (capabilities.currentExtent.width != UINT32_MAX) {
             return capabilities.currentExtent;
         }
@@ -654,24 +567,29 @@ std::cout << "\n";
     }
 
 
-    void createSwapChain() {
-        std::cout << "Creating SwapChain\n";
+    void createSwapChain(RenderTarget& target, VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE) {
+        TRACE_SCOPE("createSwapChain", "swapchain");
+        Log::debug("Creating SwapChain");
 
-        SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
+        SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice, target.surface);
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-        VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
-        VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
-
-        uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-
-        if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-            imageCount = swapChainSupport.capabilities.maxImageCount;
+        if (colorFormat == VK_FORMAT_UNDEFINED) {
+            colorFormat = surfaceFormat.format;
         }
+        else if (surfaceFormat.format != colorFormat && targets.size() > 1) {
+            throw std::runtime_error("failed to find a surface format every window supports!");
+        }
+        // present mode and image count come from the present policy, clamped to what the surface allows
+        target.presentSettings = choosePresentSettings(options.presentPolicy, swapChainSupport.capabilities, swapChainSupport.presentModes, MAX_FRAMES_IN_FLIGHT);
+        VkPresentModeKHR presentMode = target.presentSettings.presentMode;
+        VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities, target.window);
+
+        uint32_t imageCount = target.presentSettings.imageCount;
 
         VkSwapchainCreateInfoKHR createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-        createInfo.surface = surface;
+        createInfo.surface = target.surface;
 
         createInfo.minImageCount = imageCount;
         createInfo.imageFormat = surfaceFormat.format;
@@ -679,25 +597,38 @@ std::cout << "\n";
         createInfo.imageExtent = extent;
         createInfo.imageArrayLayers = 1;
         createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        if (options.readback && target.index == 0) {
+            if (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) {
+                createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            }
+            else {
+                Log::warn("SwapChain Images Can't Be Copied From; Readback Disabled");
+            }
+        }
+        // dynamic resolution blits into the swapchain images; createDynamicResolution gives up if they can't be
+        if (options.resolutionBudget > 0.0f && (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+            createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        }
+        target.swapChainImageUsage = createInfo.imageUsage;
 
-        std::cout << "SwapChain:\n";
-        std::cout << "\tMin Image Count: " << createInfo.minImageCount << "\n";
-        std::cout << "\tArray Layers: " << createInfo.imageArrayLayers << "\n";
+        Log::trace("SwapChain:");
+        Log::trace("\tMin Image Count: {}", createInfo.minImageCount);
+        Log::trace("\tArray Layers: {}", createInfo.imageArrayLayers);
 
-        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        QueueFamilyIndices indices = renderDevice.getQueueFamilies();
         uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
 
         if (indices.graphicsFamily != indices.presentFamily) {
-            std::cout << "\tImage Sharing Mode: Concurrent\n";
-            std::cout << "\tQueue Family Index Count: 2\n";
+            Log::trace("\tImage Sharing Mode: Concurrent");
+            Log::trace("\tQueue Family Index Count: 2");
 
             createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
             createInfo.queueFamilyIndexCount = 2;
             createInfo.pQueueFamilyIndices = queueFamilyIndices;
         }
         else {
-            std::cout << "\tImage Sharing Mode: Exclusive\n";
-            std::cout << "\tQueue Family Index Count: 0\n";
+            Log::trace("\tImage Sharing Mode: Exclusive");
+            Log::trace("\tQueue Family Index Count: 0");
 
             createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
             createInfo.queueFamilyIndexCount = 0; // Optional
@@ -710,115 +641,286 @@ std::cout << "\n";
         createInfo.clipped = VK_TRUE;
 
         if (createInfo.clipped == VK_TRUE) {
-            std::cout << "\tClipped: true\n";
+            Log::trace("\tClipped: true");
         }
         else {
-            std::cout << "\tClipped: false\n";
+            Log::trace("\tClipped: false");
         }
 
 
-        createInfo.oldSwapchain = VK_NULL_HANDLE;
+        // Retiring the old swapchain lets the presentation engine keep showing its images until the new one takes over
+        createInfo.oldSwapchain = oldSwapChain;
 
-        if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
+        if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &target.swapChain) != VK_SUCCESS) {
             throw std::runtime_error("failed to create swap chain!");
         }
-        std::cout << "Created SwapChain\n";
+        Log::info("Created SwapChain");
 
-        vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
-        swapChainImages.resize(imageCount);
-        vkGetSwapchainImagesKHR(device, swapChain, &imageCount, swapChainImages.data());
+        vkGetSwapchainImagesKHR(device, target.swapChain, &imageCount, nullptr);
+        target.swapChainImages.resize(imageCount);
+        vkGetSwapchainImagesKHR(device, target.swapChain, &imageCount, target.swapChainImages.data());
 
-        swapChainImageFormat = surfaceFormat.format;
-        swapChainExtent = extent;
+        target.swapChainImageFormat = surfaceFormat.format;
+        target.swapChainExtent = extent;
     }
 
-    // Image Views
+    // Offscreen Targets
 
-    void createImageViews() {
-        std::cout << "Creating Image Views (" << swapChainImages.size() << ")\n";
+    // Stands in for the swapchain when headless: plain images the same render pass and framebuffers draw into
+    void createOffscreenTargets(RenderTarget& target) {
+        TRACE_SCOPE("createOffscreenTargets", "swapchain");
+        Log::debug("Creating Offscreen Targets");
 
-        swapChainImageViews.resize(swapChainImages.size());
+        const VkFormat candidates[] = { VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM };
+        const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT;
 
-        for (size_t i = 0; i < swapChainImages.size(); i++) {
-            std::cout << "Image View #" << i << ":\n";
+        target.swapChainImageFormat = VK_FORMAT_UNDEFINED;
+        for (VkFormat format : candidates) {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+            if ((properties.optimalTilingFeatures & requiredFeatures) == requiredFeatures) {
+                target.swapChainImageFormat = format;
+                break;
+            }
+        }
+        if (target.swapChainImageFormat == VK_FORMAT_UNDEFINED) {
+            throw std::runtime_error("failed to find a color attachment format for offscreen rendering!");
+        }
+        colorFormat = target.swapChainImageFormat;
 
-            VkImageViewCreateInfo createInfo{};
-            createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            createInfo.image = swapChainImages[i];
-            createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-            createInfo.format = swapChainImageFormat;
+        target.swapChainExtent = { WIDTH, HEIGHT };
 
-            createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+        // as many as a swapchain would usually hand out, so frames in flight never share a target
+        uint32_t imageCount = MAX_FRAMES_IN_FLIGHT + 1;
+        target.swapChainImages.resize(imageCount);
+        target.offscreenImageMemory.resize(imageCount);
 
-            std::cout << "\tView Type: 2D\n";
-            std::cout << "\tComponents: Swizzle RGBA\n";
+        target.swapChainImageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        // dynamic resolution blits into them
+        if (options.resolutionBudget > 0.0f) {
+            target.swapChainImageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        }
+        for (uint32_t i = 0; i < imageCount; i++) {
+            createColorImage(target.swapChainExtent, target.swapChainImageFormat, target.swapChainImageUsage, target.swapChainImages[i], target.offscreenImageMemory[i]);
+            Log::trace("Offscreen Image #{}", i);
+        }
 
-            createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            createInfo.subresourceRange.baseMipLevel = 0;
-            createInfo.subresourceRange.levelCount = 1;
-            createInfo.subresourceRange.baseArrayLayer = 0;
-            createInfo.subresourceRange.layerCount = 1;
+        Log::info("Created {} Offscreen Targets ({}x{}, format {})", imageCount, target.swapChainExtent.width, target.swapChainExtent.height, target.swapChainImageFormat);
+    }
 
-            std::cout << "\tSubresource Aspect Mask: Color Bit\n";
-            std::cout << "\tSubresource Base Mip Level: 0\n";
-            std::cout << "\tSubresource Level Count: 1\n";
-            std::cout << "\tSubresource Base Array Layer: 0\n";
-            std::cout << "\tSubresource Layer Count: 1\n";
+    void createColorImage(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format;
+        imageInfo.extent = { extent.width, extent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-            if (vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews[i]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create image views!");
-            }
-            std::cout << "Created Image Views\n";
+        if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create color image!");
         }
 
-    }
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-    // Render Passes
-    void createRenderPass() {
-        std::cout << "Creating Render Pass\n";
-        VkAttachmentDescription colorAttachment{};
-        colorAttachment.format = swapChainImageFormat;
-        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-        std::cout << "Color Attachment:\n";
-        std::cout << "\tSamples: 1\n";
+        if (renderDevice.allocateMemory(sessionId, allocInfo, &memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate color image memory!");
+        }
+        vkBindImageMemory(device, image, memory, 0);
+    }
 
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    void destroyOffscreenTargets(RenderTarget& target) {
+        for (size_t i = 0; i < target.swapChainImages.size(); i++) {
+            vkDestroyImage(device, target.swapChainImages[i], nullptr);
+            renderDevice.freeMemory(target.offscreenImageMemory[i]);
+        }
+        target.swapChainImages.clear();
+        target.offscreenImageMemory.clear();
+    }
 
-        std::cout << "\tLoad Operation: Clear\n";
-        std::cout << "\tStore Operation: Store\n";
+    // Image Views
 
-        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        std::cout << "\tStencil Load Operation: Don't Care\n";
-        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        std::cout << "\tStencil Store Operation: Don't Care\n";
+    void createImageViews(RenderTarget& target) {
+        TRACE_SCOPE("createImageViews", "swapchain");
+        Log::debug("Creating Image Views ({})", target.swapChainImages.size());
+
+        target.swapChainImageViews.resize(target.swapChainImages.size());
+
+        for (size_t i = 0; i < target.swapChainImages.size(); i++) {
+            Log::trace("Image View #{}:", i);
+            target.swapChainImageViews[i] = createColorImageView(target.swapChainImages[i], target.swapChainImageFormat);
+        }
+
+    }
+
+    VkImageView createColorImageView(VkImage image, VkFormat format) {
+        VkImageViewCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        createInfo.image = image;
+        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        createInfo.format = format;
+
+        createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+        createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+        Log::trace("\tView Type: 2D");
+        Log::trace("\tComponents: Swizzle RGBA");
+
+        createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        createInfo.subresourceRange.baseMipLevel = 0;
+        createInfo.subresourceRange.levelCount = 1;
+        createInfo.subresourceRange.baseArrayLayer = 0;
+        createInfo.subresourceRange.layerCount = 1;
+
+        Log::trace("\tSubresource Aspect Mask: Color Bit");
+        Log::trace("\tSubresource Base Mip Level: 0");
+        Log::trace("\tSubresource Level Count: 1");
+        Log::trace("\tSubresource Base Array Layer: 0");
+        Log::trace("\tSubresource Layer Count: 1");
+
+        VkImageView imageView;
+        if (vkCreateImageView(device, &createInfo, nullptr, &imageView) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create image views!");
+        }
+        Log::trace("Created Image View");
+        return imageView;
+    }
+
+    // Dynamic Resolution
+
+    // The scene is only drawn at a lower resolution when it can be scaled up with a linear blit into the swapchain
+    // images, and the GPU time to steer by is measured
+    void createDynamicResolution() {
+        if (options.resolutionBudget <= 0.0f) {
+            return;
+        }
+        if (!gpuProfiler) {
+            Log::warn("Dynamic Resolution Disabled: GPU Timestamps Unavailable");
+            return;
+        }
+
+        const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, colorFormat, &properties);
+        if ((properties.optimalTilingFeatures & requiredFeatures) != requiredFeatures) {
+            Log::warn("Dynamic Resolution Disabled: Format {} Can't Be Scaled With A Blit", colorFormat);
+            return;
+        }
+        for (auto& target : targets) {
+            if (!(target->swapChainImageUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+                Log::warn("Dynamic Resolution Disabled: SwapChain Images Can't Be Blitted To");
+                return;
+            }
+        }
+
+        dynamicResolution = std::make_unique<DynamicResolution>(options.resolutionBudget, options.minResolutionScale, 1.0f);
+        for (auto& target : targets) {
+            createSceneTargets(*target);
+        }
+        Log::info("Dynamic Resolution: {} ms GPU budget, scale {} to 1", options.resolutionBudget, options.minResolutionScale);
+    }
+
+    // Sized like the swapchain, so a scale change only moves the viewport and blit region; nothing is recreated
+    void createSceneTargets(RenderTarget& target) {
+        TRACE_SCOPE("createSceneTargets", "swapchain");
+        size_t count = target.swapChainImages.size();
+        target.sceneImages.resize(count);
+        target.sceneImageMemory.resize(count);
+        target.sceneImageViews.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            createColorImage(target.swapChainExtent, target.swapChainImageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, target.sceneImages[i], target.sceneImageMemory[i]);
+            target.sceneImageViews[i] = createColorImageView(target.sceneImages[i], target.swapChainImageFormat);
+        }
+        Log::debug("Created {} Scene Targets ({}x{})", count, target.swapChainExtent.width, target.swapChainExtent.height);
+    }
+
+    void destroySceneTargets(RenderTarget& target) {
+        for (size_t i = 0; i < target.sceneImages.size(); i++) {
+            vkDestroyImageView(device, target.sceneImageViews[i], nullptr);
+            vkDestroyImage(device, target.sceneImages[i], nullptr);
+            renderDevice.freeMemory(target.sceneImageMemory[i]);
+        }
+        target.sceneImages.clear();
+        target.sceneImageMemory.clear();
+        target.sceneImageViews.clear();
+    }
+
+    // The part of the target the scene is drawn into this frame
+    VkExtent2D renderExtent(const RenderTarget& target) {
+        if (!dynamicResolution) {
+            return target.swapChainExtent;
+        }
+        float scale = dynamicResolution->scale();
+        return {
+            std::max(1u, static_cast<uint32_t>(target.swapChainExtent.width * scale + 0.5f)),
+            std::max(1u, static_cast<uint32_t>(target.swapChainExtent.height * scale + 0.5f))
+        };
+    }
+
+    // Render Passes
+    void createRenderPass() {
+        TRACE_SCOPE("createRenderPass", "init");
+        Log::debug("Creating Render Pass");
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = colorFormat;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+
+        Log::trace("Color Attachment:");
+        Log::trace("\tSamples: 1");
+
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+        Log::trace("\tLoad Operation: Clear");
+        Log::trace("\tStore Operation: Store");
+
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        Log::trace("\tStencil Load Operation: Don't Care");
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        Log::trace("\tStencil Store Operation: Don't Care");
 
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        std::cout << "\tInitial Layout: Undefined\n";
+        Log::trace("\tInitial Layout: Undefined");
 
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-        std::cout << "\tFinal Layout: Present Source\n";
+        // offscreen targets are left ready to be copied out, scene targets ready to be blitted from
+        if (options.headless || dynamicResolution) {
+            colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            Log::trace("\tFinal Layout: Transfer Source");
+        }
+        else {
+            colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+            Log::trace("\tFinal Layout: Present Source");
+        }
 
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;
         colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-        std::cout << "Color Attachment Reference\n";
-        std::cout << "\tAttachment: 0\n";
-        std::cout << "\tLayout: Optimal Color Attachment\n";
+        Log::trace("Color Attachment Reference");
+        Log::trace("\tAttachment: 0");
+        Log::trace("\tLayout: Optimal Color Attachment");
 
 
         VkSubpassDescription subpass{};
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-        std::cout << "Subpass:\n";
-        std::cout << "\tPipeline Bind Point: Graphics\n";
+        Log::trace("Subpass:");
+        Log::trace("\tPipeline Bind Point: Graphics");
 
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments = &colorAttachmentRef;
-        std::cout << "\tColor Attachments: 1\n";
+        Log::trace("\tColor Attachments: 1");
 
         VkSubpassDependency dependency{};
         dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
@@ -828,13 +930,35 @@ std::cout << "\n";
         dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
         dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
-        std::cout << "Subpass Dependency:\n";
-        std::cout << "\tSource Subpass: External\n";
-        std::cout << "\tDestination Subpass: 0\n";
-        std::cout << "\tSource Stage: Color Attachment Output\n";
-        std::cout << "\tSource Access: 0\n";
-        std::cout << "\tDestination Stage: Color Attachment Output\n";
-        std::cout << "\tDestination Access: Write\n";
+        Log::trace("Subpass Dependency:");
+        Log::trace("\tSource Subpass: External");
+        Log::trace("\tDestination Subpass: 0");
+        Log::trace("\tSource Stage: Color Attachment Output");
+        Log::trace("\tSource Access: 0");
+        Log::trace("\tDestination Stage: Color Attachment Output");
+        Log::trace("\tDestination Access: Write");
+
+        // The implicit dependency out of the render pass only reaches BOTTOM_OF_PIPE, which nothing after it can wait
+        // on, so the blit out of a TRANSFER_SRC target and the readback copy (from either final layout) get an explicit
+        // one covering the final transition
+        VkSubpassDependency outputDependency{};
+        outputDependency.srcSubpass = 0;
+        outputDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+        outputDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        outputDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        outputDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        outputDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        VkSubpassDependency dependencies[] = { dependency, outputDependency };
+        uint32_t dependencyCount = colorAttachment.finalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL || options.readback ? 2 : 1;
+        if (dependencyCount == 2) {
+            Log::trace("Subpass Dependency:");
+            Log::trace("\tSource Subpass: 0");
+            Log::trace("\tDestination Subpass: External");
+            Log::trace("\tSource Stage: Color Attachment Output");
+            Log::trace("\tSource Access: Write");
+            Log::trace("\tDestination Stage: Transfer");
+            Log::trace("\tDestination Access: Transfer Read");
+        }
 
         VkRenderPassCreateInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -842,297 +966,414 @@ std::cout << "\n";
         renderPassInfo.pAttachments = &colorAttachment;
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
+        renderPassInfo.dependencyCount = dependencyCount;
+        renderPassInfo.pDependencies = dependencies;
 
-        std::cout << "Render Pass:\n";
-        std::cout << "\tAttachments: 1\n";
-        std::cout << "\tSubpasses: 1\n";
-        std::cout << "\tDependencies: 1\n";
+        Log::trace("Render Pass:");
+        Log::trace("\tAttachments: 1");
+        Log::trace("\tSubpasses: 1");
+        Log::trace("\tDependencies: {}", dependencyCount);
 
         if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
         }
-        std::cout << "Created Render Pass\n";
+        Log::info("Created Render Pass");
+
+        RenderPassCompatibility compatibility;
+        compatibility.colorFormats = { colorFormat };
+        compatibility.samples = VK_SAMPLE_COUNT_1_BIT;
+        compatibility.subpassCount = 1;
+        pipelineRegistry->registerRenderPass(renderPass, compatibility);
+    }
+
+    // Pipeline Registry
+    void createPipelineRegistry() {
+        TRACE_SCOPE("createPipelineRegistry", "init");
+        pipelineRegistry = std::make_unique<PipelineRegistry>(device, pipelineCache->getInternalCache());
     }
 
     // Graphics Pipelines
+    // Assets
+    void openAssetArchive() {
+        TRACE_SCOPE("openAssetArchive", "init");
+        if (options.archive.empty()) {
+            return;
+        }
+
+        auto openStart = std::chrono::steady_clock::now();
+        assetArchive = std::make_unique<AssetArchive>(resourceCache, options.archive);
+        auto openTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - openStart).count();
+        Log::info("Opened Asset Archive \"{}\" ({} entries) in {} ms", options.archive, assetArchive->getEntryCount(), openTime);
+    }
+
+    // From the archive if there is one and it has the asset, from the loose file otherwise
+    ResourceSpan loadAsset(const std::string& name) {
+        TRACE_SCOPE("loadAsset", "loader");
+        ResourceSpan span;
+        if (assetArchive && assetArchive->find(name, span)) {
+            return span;
+        }
+        return resourceCache.load(RESOURCE_DIRECTORY + "/" + name);
+    }
+
+    // Shader modules are created once and outlive every pipeline (and variant) built from them
+    void createShaderModules() {
+        TRACE_SCOPE("createShaderModules", "init");
+        // watched shaders are copied rather than mapped so compilers can keep rewriting the files
+        ResourceAccess access = options.hotReload ? ResourceAccess::Copy : ResourceAccess::Map;
+        shaderLibrary = std::make_unique<ShaderLibrary>(&resourceCache, assetArchive.get(), options.shaderDirectory, access);
+
+        vertShaderModule = createShaderModule(shaderLibrary->get("vert.spv"));
+        fragShaderModule = createShaderModule(shaderLibrary->get("frag.spv"));
+    }
+
     void createGraphicsPipeline() {
-        std::cout << "Creating Graphics Pipeline\n";
+        TRACE_SCOPE("createGraphicsPipeline", "pipeline");
+        Log::debug("Creating Graphics Pipeline");
 
-        // load shaders
-        auto vertShaderCode = readFile("res/vert.spv");
-        std::cout << "Read Shader \"res/vert.spv\"\n";
+        createPipelineLayout();
 
-        auto fragShaderCode = readFile("res/frag.spv");
-        std::cout << "Read Shader \"res/frag.spv\"\n";
+        GraphicsPipelineDesc desc = describeGraphicsPipeline(vertShaderModule, fragShaderModule);
+        shaderVariants = std::make_unique<ShaderVariantCache>(desc, pipelineRegistry.get());
 
-        VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+        Log::trace("Graphics Pipeline");
+        Log::trace("\tStages: 2");
+        Log::trace("\tVariant: {}", describeShaderVariant(colorMode).str());
 
-        // Vertex Shader Stage
-        VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-        vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+        auto pipelineStart = std::chrono::steady_clock::now();
+        graphicsPipeline = shaderVariants->get(describeShaderVariant(colorMode));
+        pendingVariant = {};
+        auto pipelineTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count();
+        Log::info("Created Graphics Pipeline in {} ms ({} pipeline cache)", pipelineTime, (pipelineCache->isWarm() ? "warm" : "cold"));
 
-        std::cout << "Vertex Shader Stage:\n";
-        std::cout << "\tType: Vertex\n";
+        prewarmShaderVariants();
+    }
 
-        vertShaderStageInfo.module = vertShaderModule;
-        vertShaderStageInfo.pName = "main";
-        std::cout << "\tName: \"main\"\n";
+    // Builds the other color modes in the background so switching to them doesn't stall a frame
+    void prewarmShaderVariants() {
+        TRACE_SCOPE("prewarmShaderVariants", "pipeline");
+        std::vector<ShaderVariantKey> otherVariants;
+        for (ColorMode mode : { ColorMode::Vertex, ColorMode::Grayscale, ColorMode::Inverted }) {
+            if (mode != colorMode) {
+                otherVariants.push_back(describeShaderVariant(mode));
+            }
+        }
+        shaderVariants->prewarm(otherVariants, *pipelineBuildService);
+        Log::debug("\tPrewarming {} Shader Variants", otherVariants.size());
+    }
 
+    void destroyShaderModules() {
+        // outstanding variant builds still reference the modules
+        if (pipelineBuildService) {
+            pipelineBuildService->waitIdle();
+        }
+        shaderVariants.reset();
 
-        // Fragment Shader Stage
-        VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-        fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName = "main";
+        if (shaderReload) {
+            // its pipeline (if any) belongs to the registry
+            vkDestroyShaderModule(device, shaderReload->fragShaderModule, nullptr);
+            vkDestroyShaderModule(device, shaderReload->vertShaderModule, nullptr);
+            shaderReload.reset();
+        }
 
-        std::cout << "Fragment Shader Stage:\n";
-        std::cout << "\tType: Fragment\n";
-        std::cout << "\tName: \"main\"\n";
+        vkDestroyShaderModule(device, fragShaderModule, nullptr);
+        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+        Log::debug("\tDestroyed Shader Modules");
+    }
 
-        // CombinederShaderStajizz
-        VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+    ShaderVariantKey describeShaderVariant(ColorMode mode) {
+        ShaderVariantKey key;
+        key.setFloat(VK_SHADER_STAGE_VERTEX_BIT, ShaderConstants::PositionScale, options.positionScale);
+        key.setInt(VK_SHADER_STAGE_FRAGMENT_BIT, ShaderConstants::ColorMode, static_cast<int32_t>(mode));
+        return key;
+    }
 
-        // Vertex Input
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 0;
-        vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
-        vertexInputInfo.vertexAttributeDescriptionCount = 0;
-        vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
+    // Starts building the pipeline for the current variant, unless it was prewarmed; frames keep using the current
+    // pipeline until it's done
+    void requestShaderVariant() {
+        shaderVariantChanged = false;
+        pendingVariant = shaderVariants->request(describeShaderVariant(colorMode), *pipelineBuildService);
+    }
 
-        std::cout << "Vertex Input:\n";
-        std::cout << "\tVertex Binding Descriptions: 0\n";
-        std::cout << "\tVertex Attribute Descriptions: 0\n";
+    // Swaps in the pipeline for the current variant once it's built. The registry keeps the previous one alive, so
+    // command buffers still using it can finish; each is re-recorded before its next submission.
+    void applyShaderVariant() {
+        TRACE_SCOPE("applyShaderVariant", "pipeline");
+        try {
+            if (PipelineBuildService::readyOr(pendingVariant, VK_NULL_HANDLE) == VK_NULL_HANDLE) {
+                return;
+            }
+        }
+        catch (const std::exception& e) {
+            Log::warn("Shader Variant Build Failed ({}), Keeping Current Pipeline", e.what());
+            pendingVariant = {};
+            return;
+        }
+        pendingVariant = {};
 
-        // Input Assembly
-        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        inputAssembly.primitiveRestartEnable = VK_FALSE;
-        std::cout << "Input Assembly\n";
-        std::cout << "\tTopology: Triangle List\n";
-        std::cout << "\tPrimitive Restart Enabled: False\n";
-
-        // Viewport
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float)swapChainExtent.width;
-        viewport.height = (float)swapChainExtent.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
+        // already built, so this is a lookup
+        graphicsPipeline = shaderVariants->get(describeShaderVariant(colorMode));
+        Log::info("Switched Shader Variant to {} ({} variants built)", describeShaderVariant(colorMode).str(), shaderVariants->size());
+
+        markCommandBuffersStale();
+    }
 
-        std::cout << "Viewport:\n";
-        std::cout << "\tX: " << viewport.x << "\n";
-        std::cout << "\tY: " << viewport.y << "\n";
-        std::cout << "\tWidth: " << viewport.width << "\n";
-        std::cout << "\tHeight: " << viewport.height << "\n";
-        std::cout << "\tMin Depth: " << viewport.minDepth << "\n";
-        std::cout << "\tMax Depth: " << viewport.maxDepth << "\n";
+    // Shader Hot Reload
+    void createShaderWatcher() {
+        TRACE_SCOPE("createShaderWatcher", "init");
+        if (!options.hotReload) {
+            return;
+        }
 
+        std::string directory = options.shaderDirectory.empty() ? RESOURCE_DIRECTORY : options.shaderDirectory;
+        std::vector<WatchedShader> shaders = {
+            { "vert.spv", "shader.vert" },
+            { "frag.spv", "shader.frag" }
+        };
+        shaderWatcher = std::make_unique<ShaderWatcher>(&resourceCache, directory, shaders, options.glslc);
+    }
 
+    // Called once per frame. Picks up changed shaders, starts building their pipeline on the build service and swaps
+    // it in on a later frame once it is ready; the frame loop keeps drawing with the current pipeline meanwhile.
+    void pollShaderReload() {
+        if (!shaderWatcher) {
+            return;
+        }
 
-        // Scissor
-        VkRect2D scissor{};
-        scissor.offset = { 0, 0 };
-        scissor.extent = swapChainExtent;
+        // changes that arrive while a reload is building wait for the next one
+        if (!shaderReload) {
+            auto changes = shaderWatcher->takeChanges();
+            if (!changes.empty()) {
+                beginShaderReload(changes);
+            }
+        }
+
+        if (shaderReload && shaderReload->pipeline.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            finishShaderReload();
+        }
+    }
 
-        std::cout << "Scissor\n";
-        std::cout << "\tOffset: (0,0)\n";
+    void beginShaderReload(std::unordered_map<std::string, ResourceSpan>& changes) {
+        TRACE_SCOPE("beginShaderReload", "shader");
+        for (auto& change : changes) {
+            Log::info("Reloading Shader \"{}\"", change.first);
+            shaderLibrary->replace(change.first, std::move(change.second));
+        }
+
+        // both stages get new modules so the old pair can be retired as a unit
+        PendingShaderReload reload;
+        reload.vertShaderModule = createShaderModule(shaderLibrary->get("vert.spv"));
+        reload.fragShaderModule = createShaderModule(shaderLibrary->get("frag.spv"));
+
+        GraphicsPipelineDesc desc = describeGraphicsPipeline(reload.vertShaderModule, reload.fragShaderModule);
+        reload.shaderVariants = std::make_unique<ShaderVariantCache>(desc, pipelineRegistry.get());
+        reload.pipeline = reload.shaderVariants->request(describeShaderVariant(colorMode), *pipelineBuildService);
+
+        shaderReload = std::move(reload);
+    }
+
+    void finishShaderReload() {
+        TRACE_SCOPE("finishShaderReload", "shader");
+        PendingShaderReload reload = std::move(*shaderReload);
+        shaderReload.reset();
+
+        try {
+            reload.pipeline.get();
+        }
+        catch (const std::exception& e) {
+            Log::warn("Shader Reload Failed ({}), Keeping Current Pipeline", e.what());
+            retireShaderModules(reload.vertShaderModule, reload.fragShaderModule);
+            return;
+        }
+
+        retireShaderModules(vertShaderModule, fragShaderModule);
+
+        vertShaderModule = reload.vertShaderModule;
+        fragShaderModule = reload.fragShaderModule;
+        shaderVariants = std::move(reload.shaderVariants);
+
+        // already built, so this is a lookup
+        graphicsPipeline = shaderVariants->get(describeShaderVariant(colorMode));
+        pendingVariant = {};
+        markCommandBuffersStale();
+        frameDirty = true;
+        Log::info("Swapped In Reloaded Shaders");
+
+        prewarmShaderVariants();
+    }
+
+    // Destroys the modules and every pipeline built from them once all frames submitted so far have completed.
+    // Nothing submitted later uses them: the current pipeline has already been replaced and stale command buffers
+    // are re-recorded before they are submitted again.
+    void retireShaderModules(VkShaderModule vert, VkShaderModule frag) {
+        deletionQueue.retire(submittedFrames, [this, vert, frag] {
+            for (VkShaderModule module : { vert, frag }) {
+                for (VkPipeline pipeline : pipelineRegistry->evictShaderModule(module)) {
+                    vkDestroyPipeline(device, pipeline, nullptr);
+                }
+                vkDestroyShaderModule(device, module, nullptr);
+            }
+            Log::debug("Destroyed Retired Shader Modules + Pipelines");
+        });
+    }
+
+    void createPipelineLayout() {
+        TRACE_SCOPE("createPipelineLayout", "pipeline");
+        PipelineLayoutDesc layoutDesc{};
+
+        Log::trace("Pipeline Layout:");
+        Log::trace("\tLayout Count: 0");
+        Log::trace("\tPush Constant Ranges: 0");
+
+        pipelineLayout = pipelineRegistry->getPipelineLayout(layoutDesc);
+        Log::debug("Got Pipeline Layout");
+    }
+
+    // The fixed-function state of the main pipeline. Shader modules, layout and render pass must outlive any build of it.
+    GraphicsPipelineDesc describeGraphicsPipeline(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule) {
+        GraphicsPipelineDesc desc;
+        desc.name = "main";
 
-        // Viewport State
-        VkPipelineViewportStateCreateInfo viewportState{};
-        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport;
-        viewportState.scissorCount = 1;
-        viewportState.pScissors = &scissor;
+        // Shader Stages
+        desc.vertexShader = vertShaderModule;
+        desc.fragmentShader = fragShaderModule;
+        desc.vertexEntryPoint = "main";
+        desc.fragmentEntryPoint = "main";
 
-        std::cout << "Viewport State:\n";
-        std::cout << "\tViewports: 1\n";
-        std::cout << "\tScissors: 1\n";
+        Log::trace("Vertex Shader Stage:");
+        Log::trace("\tType: Vertex");
+        Log::trace("\tName: \"main\"");
+        Log::trace("Fragment Shader Stage:");
+        Log::trace("\tType: Fragment");
+        Log::trace("\tName: \"main\"");
 
+        // Vertex Input
+        desc.vertexBindings = Vertex::getBindingDescriptions();
+        desc.vertexAttributes = Vertex::getAttributeDescriptions();
+
+        Log::trace("Vertex Input:");
+        Log::trace("\tVertex Binding Descriptions: {}", desc.vertexBindings.size());
+        Log::trace("\tVertex Attribute Descriptions: {}", desc.vertexAttributes.size());
+
+        // Input Assembly
+        desc.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        Log::trace("Input Assembly");
+        Log::trace("\tTopology: Triangle List");
+        Log::trace("\tPrimitive Restart Enabled: False");
+
+        Log::trace("Viewport State:");
+        Log::trace("\tViewports: 1 (Dynamic)");
+        Log::trace("\tScissors: 1 (Dynamic)");
 
         //rastering image filter. eYES
-        VkPipelineRasterizationStateCreateInfo rasterizer{};
-        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizer.depthClampEnable = VK_FALSE;
-        rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-
-        rasterizer.lineWidth = 1.0f;
-
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-
-        rasterizer.depthBiasEnable = VK_FALSE;
-        rasterizer.depthBiasConstantFactor = 0.0f; // Optional
-        rasterizer.depthBiasClamp = 0.0f; // Optional
-        rasterizer.depthBiasSlopeFactor = 0.0f; // Optional
-
-        std::cout << "Rasterizer:\n";
-        std::cout << "\tDepth Clamp: Disabled\n";
-        std::cout << "\tRasterizer Discard: Disabled\n";
-        std::cout << "\tPolygon Mode: Fill\n";
-        std::cout << "\tLine Width: 1\n";
-        std::cout << "\tCull Mode: Back Faces\n";
-        std::cout << "\tFront Face: Clockwise\n";
-        std::cout << "\tDepth Bias: Disabled\n";
-        std::cout << "\tDepth Bias Constant Factor: 0\n";
-        std::cout << "\tDepth Bias Clamp: 0\n";
-        std::cout << "\tDepth Bias Slope Factor: 0\n";
+        desc.polygonMode = VK_POLYGON_MODE_FILL;
+        desc.lineWidth = 1.0f;
+        desc.cullMode = VK_CULL_MODE_BACK_BIT;
+        desc.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+        Log::trace("Rasterizer:");
+        Log::trace("\tDepth Clamp: Disabled");
+        Log::trace("\tRasterizer Discard: Disabled");
+        Log::trace("\tPolygon Mode: Fill");
+        Log::trace("\tLine Width: 1");
+        Log::trace("\tCull Mode: Back Faces");
+        Log::trace("\tFront Face: Clockwise");
+        Log::trace("\tDepth Bias: Disabled");
 
         //Multisampling
-        VkPipelineMultisampleStateCreateInfo multisampling{};
-        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampling.sampleShadingEnable = VK_FALSE;
-        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-        multisampling.minSampleShading = 1.0f; // Optional
-        multisampling.pSampleMask = nullptr; // Optional
-        multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
-        multisampling.alphaToOneEnable = VK_FALSE; // Optional
-
-        std::cout << "Multisampling:\n";
-        std::cout << "\tSample Shading: Disabled\n";
-        std::cout << "\tRasterization Samples: 1\n";
-        std::cout << "\tMin Sample Shading: 1\n";
-        std::cout << "\tAlpha To Coverage: Disabled\n";
-        std::cout << "\tAlpha To One: Disabled\n";
-
-        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        colorBlendAttachment.blendEnable = VK_TRUE;
-        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-        colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-        colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-        colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-        colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-        std::cout << "Color Blending Attachment:\n";
-        std::cout << "\tColor Write: RGBA\n";
-        std::cout << "\tBlending: Enabled\n";
-        std::cout << "\tSource Color Blend Factor: Source Alpha\n";
-        std::cout << "\tDestination Color Blend Factor: 1 - Source Alpha\n";
-        std::cout << "\tColor Blend Operation: Blend or Add\n";
-        std::cout << "\tSource Alpha Blend Factor: 1\n";
-        std::cout << "\tDestination Blend Factor: 0\n";
-        std::cout << "\tAlpha Blend Operation: Blend or Add\n";
-
-
-        VkPipelineColorBlendStateCreateInfo colorBlending{};
-        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        colorBlending.logicOpEnable = VK_FALSE;
-        colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-        colorBlending.attachmentCount = 1;
-        colorBlending.pAttachments = &colorBlendAttachment;
-        colorBlending.blendConstants[0] = 0.0f; // Optional
-        colorBlending.blendConstants[1] = 0.0f; // Optional
-        colorBlending.blendConstants[2] = 0.0f; // Optional
-        colorBlending.blendConstants[3] = 0.0f; // Optional
-
-        std::cout << "Color Blending Stage:\n";
-        std::cout << "\tLogic Operation Enabled: false\n";
-        std::cout << "\tLogic Operation: Copy\n";
-        std::cout << "\tAttachment Count\n";
-        std::cout << "\tBlend Constants: {0, 0, 0, 0}\n";
-
-        VkDynamicState dynamicStates[] = {
-            VK_DYNAMIC_STATE_VIEWPORT,
-            VK_DYNAMIC_STATE_LINE_WIDTH
+        desc.samples = VK_SAMPLE_COUNT_1_BIT;
+
+        Log::trace("Multisampling:");
+        Log::trace("\tSample Shading: Disabled");
+        Log::trace("\tRasterization Samples: 1");
+        Log::trace("\tAlpha To Coverage: Disabled");
+        Log::trace("\tAlpha To One: Disabled");
+
+        desc.colorBlend = GraphicsPipelineDesc::defaultColorBlend();
+
+        Log::trace("Color Blending Attachment:");
+        Log::trace("\tColor Write: RGBA");
+        Log::trace("\tBlending: Enabled");
+        Log::trace("\tSource Color Blend Factor: Source Alpha");
+        Log::trace("\tDestination Color Blend Factor: 1 - Source Alpha");
+        Log::trace("\tColor Blend Operation: Blend or Add");
+        Log::trace("\tSource Alpha Blend Factor: 1");
+        Log::trace("\tDestination Blend Factor: 0");
+        Log::trace("\tAlpha Blend Operation: Blend or Add");
+
+        desc.dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+        Log::trace("\tDynamic States:");
+        Log::trace("\tCount: 2");
+        Log::trace("\tStates:");
+        Log::trace("\t\tViewport");
+        Log::trace("\t\tScissor");
+
+        desc.layout = pipelineLayout;
+        desc.renderPass = renderPass;
+        desc.subpass = 0;
+
+        return desc;
+    }
+
+    // Builds options.pipelineBenchCount variants of the main pipeline (differing in rasterization and blend state)
+    // with 1..options.pipelineBenchThreads workers.
+    void runPipelineBenchmark() {
+        TRACE_SCOPE("runPipelineBenchmark", "pipeline");
+        GraphicsPipelineDesc base = describeGraphicsPipeline(vertShaderModule, fragShaderModule);
+
+        const VkCullModeFlags cullModes[] = { VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_NONE };
+        const VkFrontFace frontFaces[] = { VK_FRONT_FACE_CLOCKWISE, VK_FRONT_FACE_COUNTER_CLOCKWISE };
+        const VkPrimitiveTopology topologies[] = { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_LINE_LIST, VK_PRIMITIVE_TOPOLOGY_POINT_LIST };
+        const VkColorComponentFlags writeMasks[] = {
+            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT
         };
 
-        VkPipelineDynamicStateCreateInfo dynamicState{};
-        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        dynamicState.dynamicStateCount = 2;
-        dynamicState.pDynamicStates = dynamicStates;
-        std::cout << "\tDynamic States:\n";
-        std::cout << "\tCount: 2\n";
-        std::cout << "\tStates:\n";
-        std::cout << "\t\tViewport\n";
-        std::cout << "\t\tLine Width\n";
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 0; // Optional
-        pipelineLayoutInfo.pSetLayouts = nullptr; // Optional
-        pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-        pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-
-        std::cout << "Pipeline Layout:\n";
-        std::cout << "\tLayout Count: 0\n";
-        std::cout << "\tPush Constant Ranges: 0\n";
-
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create pipeline layout!");
-        }
-        std::cout << "\nCreated Pipeline Layout\n";
-
-
-        VkGraphicsPipelineCreateInfo pipelineInfo{};
-        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
-        pipelineInfo.pStages = shaderStages;
-        pipelineInfo.pVertexInputState = &vertexInputInfo;
-        pipelineInfo.pInputAssemblyState = &inputAssembly;
-        pipelineInfo.pViewportState = &viewportState;
-        pipelineInfo.pRasterizationState = &rasterizer;
-        pipelineInfo.pMultisampleState = &multisampling;
-        pipelineInfo.pDepthStencilState = nullptr; // Optional
-        pipelineInfo.pColorBlendState = &colorBlending;
-        pipelineInfo.pDynamicState = nullptr; // Optional
-        pipelineInfo.layout = pipelineLayout;
-        pipelineInfo.renderPass = renderPass;
-        pipelineInfo.subpass = 0;
-        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
-        pipelineInfo.basePipelineIndex = -1; // Optional
-
-        std::cout << "Graphics Pipeline\n";
-        std::cout << "\tStages: 2\n";
-
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create graphics pipeline!");
-        }
-        std::cout << "\nCreated Graphics Pipeline\n";
-
-        // kill dead shaders
-        vkDestroyShaderModule(device, fragShaderModule, nullptr);
-        vkDestroyShaderModule(device, vertShaderModule, nullptr);
-        std::cout << "\tDestroyed Unnecessary Shader Modules\n";
+        std::vector<GraphicsPipelineDesc> batch;
+        for (uint32_t i = 0; i < options.pipelineBenchCount; i++) {
+            GraphicsPipelineDesc desc = base;
+            desc.name = "bench " + std::to_string(i);
+            desc.cullMode = cullModes[i % 2];
+            desc.frontFace = frontFaces[(i / 2) % 2];
+            desc.topology = topologies[(i / 4) % 3];
+            desc.colorBlend.blendEnable = (i / 12) % 2 ? VK_FALSE : VK_TRUE;
+            desc.colorBlend.colorWriteMask = writeMasks[(i / 24) % 2];
+            batch.push_back(desc);
+        }
+
+        benchmarkPipelineBuilds(device, batch, options.pipelineBenchThreads);
     }
 
-    VkShaderModule createShaderModule(const std::vector<char>& code) {
-        std::cout << "Creating Shader Module\n";
+    VkShaderModule createShaderModule(ShaderBinary binary) {
+        Log::debug("Creating Shader Module ({} bytes)", binary.codeSize);
 
         VkShaderModuleCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+        createInfo.codeSize = binary.codeSize;
+        createInfo.pCode = binary.code;
         VkShaderModule shaderModule;
         if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
             throw std::runtime_error("failed to create shader module!");
         }
-        std::cout << "\tCreated Shader Module\n";
+        pipelineRegistry->registerShaderModule(shaderModule, createInfo.pCode, createInfo.codeSize);
+        Log::debug("\tCreated Shader Module");
 
         return shaderModule;
     }
 
     // Framebuffers
 
-    void createFramebuffers() {
-        std::cout << "Creating Framebuffers\n";
+    void createFramebuffers(RenderTarget& target) {
+        TRACE_SCOPE("createFramebuffers", "swapchain");
+        Log::debug("Creating Framebuffers");
 
-        swapChainFramebuffers.resize(swapChainImageViews.size());
+        target.swapChainFramebuffers.resize(target.swapChainImageViews.size());
 
-        for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-            std::cout << "Framebuffer #" << i << ":\n";
+        for (size_t i = 0; i < target.swapChainImageViews.size(); i++) {
+            Log::trace("Framebuffer #{}:", i);
             VkImageView attachments[] = {
-                swapChainImageViews[i]
+                dynamicResolution ? target.sceneImageViews[i] : target.swapChainImageViews[i]
             };
 
             VkFramebufferCreateInfo framebufferInfo{};
@@ -1140,15 +1381,15 @@ std::cout << "\n";
             framebufferInfo.renderPass = renderPass;
             framebufferInfo.attachmentCount = 1;
             framebufferInfo.pAttachments = attachments;
-            framebufferInfo.width = swapChainExtent.width;
-            framebufferInfo.height = swapChainExtent.height;
+            framebufferInfo.width = target.swapChainExtent.width;
+            framebufferInfo.height = target.swapChainExtent.height;
             framebufferInfo.layers = 1;
-            std::cout << "\tAttachments: 1\n";
-            std::cout << "\tWidth: " << swapChainExtent.width << "\n";
-            std::cout << "\tHeight: " << swapChainExtent.height << "\n";
-            std::cout << "\tLayers: 1\n";
+            Log::trace("\tAttachments: 1");
+            Log::trace("\tWidth: {}", target.swapChainExtent.width);
+            Log::trace("\tHeight: {}", target.swapChainExtent.height);
+            Log::trace("\tLayers: 1");
 
-            if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
+            if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &target.swapChainFramebuffers[i]) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create framebuffer!");
             }
         }
@@ -1156,101 +1397,420 @@ std::cout << "\n";
 
     // Command Buffers
 
+    // Vertex Buffer
+    void createVertexBuffer() {
+        TRACE_SCOPE("createVertexBuffer", "init");
+        vertices = parseMeshCsv(loadAsset(MESH_NAME), MESH_NAME);
+        Log::info("Loaded Mesh \"{}\" ({} vertices)", MESH_NAME, vertices.size());
+
+        VkDeviceSize size = sizeof(vertices[0]) * vertices.size();
+        createBuffer(size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertexBuffer, vertexBufferMemory);
+
+        void* data;
+        vkMapMemory(device, vertexBufferMemory, 0, size, 0, &data);
+        memcpy(data, vertices.data(), (size_t)size);
+        vkUnmapMemory(device, vertexBufferMemory);
+        Log::info("Created Vertex Buffer ({} bytes)", size);
+    }
+
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create buffer!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+
+        if (renderDevice.allocateMemory(sessionId, allocInfo, &memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate buffer memory!");
+        }
+        vkBindBufferMemory(device, buffer, memory, 0);
+    }
+
+    void destroyBatchSlot(BatchSlot& slot) {
+        if (slot.mapped != nullptr) {
+            vkUnmapMemory(device, slot.stagingMemory);
+        }
+        vkDestroyBuffer(device, slot.stagingBuffer, nullptr);
+        renderDevice.freeMemory(slot.stagingMemory);
+        vkDestroyBuffer(device, slot.vertexBuffer, nullptr);
+        renderDevice.freeMemory(slot.vertexMemory);
+        slot = BatchSlot{};
+    }
+
+    // Call once frame's fence has signalled: nothing in flight uses its slot any more
+    void stageBatchItem(size_t frame) {
+        TRACE_SCOPE("stageBatchItem", "frame");
+        BatchSlot& slot = batchSlots[frame];
+        VkDeviceSize size = sizeof(Vertex) * batchItem.vertices.size();
+
+        if (size > slot.capacity) {
+            destroyBatchSlot(slot);
+            // at least 64 KiB and doubling, so a batch of growing files doesn't reallocate every frame
+            VkDeviceSize capacity = 64 * 1024;
+            while (capacity < size) {
+                capacity *= 2;
+            }
+            createBuffer(capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, slot.stagingBuffer, slot.stagingMemory);
+            vkMapMemory(device, slot.stagingMemory, 0, VK_WHOLE_SIZE, 0, &slot.mapped);
+            createBuffer(capacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, slot.vertexBuffer, slot.vertexMemory);
+            slot.capacity = capacity;
+            Log::debug("Batch Buffers {}: {} bytes", frame, capacity);
+        }
+
+        if (size > 0) {
+            memcpy(slot.mapped, batchItem.vertices.data(), (size_t)size);
+        }
+        slot.vertexCount = static_cast<uint32_t>(batchItem.vertices.size());
+        slot.name = batchItem.name;
+    }
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+        return renderDevice.findMemoryType(typeFilter, properties);
+    }
+
     void createCommandPool() {
-        std::cout << "\tCreating Command Pool\n";
-        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+        TRACE_SCOPE("createCommandPool", "init");
+        Log::debug("\tCreating Command Pool");
+        QueueFamilyIndices queueFamilyIndices = renderDevice.getQueueFamilies();
 
         VkCommandPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-        poolInfo.flags = 0; // Optional
+        // individual command buffers are re-recorded when the pipeline changes
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
         if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create command pool!");
         }
-        std::cout << "Created Command Pool\n";
+        Log::info("Created Command Pool");
     }
 
-    void createCommandBuffers() {
-        std::cout << "Creating Command Buffers\n";
-        commandBuffers.resize(swapChainFramebuffers.size());
+    void createCommandBuffers(RenderTarget& target) {
+        TRACE_SCOPE("createCommandBuffers", "swapchain");
+        Log::debug("Creating Command Buffers");
+        target.commandBuffers.resize(target.swapChainFramebuffers.size());
 
         VkCommandBufferAllocateInfo allocInfo{};
 
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.commandPool = commandPool;
         allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
+        allocInfo.commandBufferCount = (uint32_t)target.commandBuffers.size();
 
-        std::cout << "Command Buffer Allocation\n";
-        std::cout << "\tLevel: Primary\n";
-        std::cout << "\tCount: " << commandBuffers.size() << "\n";
+        Log::trace("Command Buffer Allocation");
+        Log::trace("\tLevel: Primary");
+        Log::trace("\tCount: {}", target.commandBuffers.size());
 
-        if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
+        if (vkAllocateCommandBuffers(device, &allocInfo, target.commandBuffers.data()) != VK_SUCCESS) {
             throw std::runtime_error("failed to allocate command buffers!");
         }
-        std::cout << "Allocated Command Buffers\n";
+        Log::debug("Allocated Command Buffers");
 
-        for (size_t i = 0; i < commandBuffers.size(); i++) {
-            VkCommandBufferBeginInfo beginInfo{};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            beginInfo.flags = 0; // Optional
-            beginInfo.pInheritanceInfo = nullptr; // Optional
-            std::cout << "Command Buffer " << i << ":\n";
+        target.commandBufferCounters.assign(target.commandBuffers.size(), DrawCounters{});
+        if (recordsEveryFrame()) {
+            target.commandBufferStale.assign(target.commandBuffers.size(), true);
+            return;
+        }
 
-            if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-                throw std::runtime_error("failed to begin recording command buffer!");
+        for (size_t i = 0; i < target.commandBuffers.size(); i++) {
+            recordCommandBuffer(target, i, true, true);
+        }
+        target.commandBufferStale.assign(target.commandBuffers.size(), false);
+    }
+
+    void createGpuProfiler() {
+        if (!options.gpuProfile && !pipelineStatisticsEnabled) {
+            return;
+        }
+
+        try {
+            QueueFamilyIndices indices = renderDevice.getQueueFamilies();
+            gpuProfiler = std::make_unique<GpuProfiler>(physicalDevice, device, indices.graphicsFamily.value(), framesInFlight, pipelineStatisticsEnabled);
+        }
+        catch (const std::exception& e) {
+            Log::warn("GPU Profiling Disabled: {}", e.what());
+        }
+    }
+
+    void createFrameMetrics() {
+        frameMetrics = std::make_unique<FrameMetrics>(framesInFlight, options.metricsFile);
+        if (!options.headless) {
+            // display times are only known for frames present pacing waits on
+            inputLatency = std::make_unique<InputLatency>(options.latencyFile, presentPolicyName(options.presentPolicy), framesInFlight, pacesPresentation(*targets[0]));
+        }
+        if (options.runBenchmark) {
+            frameBenchmark = std::make_unique<FrameBenchmark>(options.benchmark);
+        }
+        if (options.frameCap > 0.0f) {
+            frameLimiter = std::make_unique<FrameLimiter>(options.frameCap, options.limiterPlainSleep);
+        }
+    }
+
+    void createFrameReadback() {
+        // only the first window is copied out
+        const RenderTarget& target = *targets[0];
+        if (!options.readback || !(target.swapChainImageUsage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+            return;
+        }
+        frameReadback = std::make_unique<FrameReadback>(renderDevice, sessionId, framesInFlight, target.swapChainExtent, options.readbackOutput, options.readbackDirectory, options.readbackEvery);
+        if (options.readbackOutput == ReadbackOutput::Stream) {
+            StreamPixelFormat format = options.streamI420 ? StreamPixelFormat::I420 : StreamPixelFormat::Rgba8;
+            VkExtent2D extent = largestStreamExtent(target);
+            auto sink = std::make_unique<FrameSink>(options.streamTarget, streamPayloadSize(format, extent.width, extent.height));
+            frameReadback->stream(std::move(sink), options.streamI420, options.streamBlock);
+        }
+        if (batchLoader) {
+            frameReadback->blockWhenBehind();
+        }
+    }
+
+    // The shared memory ring's slots are sized once, so a window that streams is kept from growing past the largest
+    // monitor, and the slots are sized for that. Headless targets never resize.
+    VkExtent2D largestStreamExtent(const RenderTarget& target) {
+        VkExtent2D extent = target.swapChainExtent;
+        if (options.headless) {
+            return extent;
+        }
+
+        int count = 0;
+        GLFWmonitor** monitors = glfwGetMonitors(&count);
+        for (int i = 0; i < count; i++) {
+            const GLFWvidmode* mode = glfwGetVideoMode(monitors[i]);
+            if (mode) {
+                extent.width = std::max(extent.width, static_cast<uint32_t>(mode->width));
+                extent.height = std::max(extent.height, static_cast<uint32_t>(mode->height));
             }
-            std::cout << "\tBegan Command Buffer\n";
+        }
+        glfwSetWindowSizeLimits(target.window, GLFW_DONT_CARE, GLFW_DONT_CARE, static_cast<int>(extent.width), static_cast<int>(extent.height));
+        Log::debug("Stream Frames Sized For Up To {}x{}", extent.width, extent.height);
+        return extent;
+    }
+
+    // Command buffers that write per-frame queries or staging buffers, or draw a different batch file each frame,
+    // can't be recorded once up front
+    bool recordsEveryFrame() {
+        return gpuProfiler || frameReadback || batchLoader;
+    }
+
+    void markCommandBuffersStale() {
+        for (auto& target : targets) {
+            target->commandBufferStale.assign(target->commandBuffers.size(), true);
+        }
+    }
+
+    // firstInFrame/lastInFrame: whether this is the first/last of the command buffers submitted together this frame,
+    // one per window
+    void recordCommandBuffer(RenderTarget& target, size_t i, bool firstInFrame, bool lastInFrame) {
+        TRACE_SCOPE("recordCommandBuffer", "frame");
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = 0; // Optional
+        beginInfo.pInheritanceInfo = nullptr; // Optional
+        Log::trace("Command Buffer {}:", i);
+
+        if (vkBeginCommandBuffer(target.commandBuffers[i], &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording command buffer!");
+        }
+        Log::trace("\tBegan Command Buffer");
+
+        DrawCounters& counters = target.commandBufferCounters[i];
+        counters = DrawCounters{};
+
+        uint32_t renderPassRegion = 0, drawRegion = 0, renderPassStatistics = 0;
+        if (gpuProfiler && firstInFrame) {
+            gpuProfiler->beginFrame(target.commandBuffers[i], static_cast<uint32_t>(currentFrame));
+            gpuFrameRegion = gpuProfiler->beginRegion(target.commandBuffers[i], "Frame");
+        }
+
+        // recorded right before its submission, so the batch slot is this frame's
+        const BatchSlot* batchSlot = batchLoader ? &batchSlots[currentFrame] : nullptr;
+        if (batchSlot && batchSlot->vertexCount > 0 && firstInFrame) {
+            VkBufferCopy region{};
+            region.size = sizeof(Vertex) * batchSlot->vertexCount;
+            vkCmdCopyBuffer(target.commandBuffers[i], batchSlot->stagingBuffer, batchSlot->vertexBuffer, 1, &region);
 
+            VkBufferMemoryBarrier toVertexInput{};
+            toVertexInput.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            toVertexInput.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            toVertexInput.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+            toVertexInput.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            toVertexInput.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            toVertexInput.buffer = batchSlot->vertexBuffer;
+            toVertexInput.size = region.size;
+            vkCmdPipelineBarrier(target.commandBuffers[i], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 1, &toVertexInput, 0, nullptr);
+            Log::trace("\t\tCopy Batch Vertices {Size: {}}", region.size);
+        }
 
-            VkRenderPassBeginInfo renderPassInfo{};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = renderPass;
-            renderPassInfo.framebuffer = swapChainFramebuffers[i];
+        if (gpuProfiler) {
+            renderPassRegion = gpuProfiler->beginRegion(target.commandBuffers[i], "Render Pass");
+            renderPassStatistics = gpuProfiler->beginStatistics(target.commandBuffers[i], "Render Pass");
+        }
 
-            renderPassInfo.renderArea.offset = { 0, 0 };
-            renderPassInfo.renderArea.extent = swapChainExtent;
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = renderPass;
+        renderPassInfo.framebuffer = target.swapChainFramebuffers[i];
 
-            std::cout << "\tRender Pass:\n";
-            std::cout << "\t\tOffset: (0, 0)\n";
+        // the whole target, or with dynamic resolution the scaled part of the scene target
+        VkExtent2D extent = renderExtent(target);
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = extent;
 
-            VkClearValue clearColor = { 0.901f, 0.623f, 0.180f, 1.0f };
-            renderPassInfo.clearValueCount = 1;
-            renderPassInfo.pClearValues = &clearColor;
+        Log::trace("\tRender Pass:");
+        Log::trace("\t\tOffset: (0, 0)");
 
-            std::cout << "\tClear Color: (0.901, 0.623, 0.180, 1.0) \n";
+        VkClearValue clearColor = { 0.901f, 0.623f, 0.180f, 1.0f };
+        renderPassInfo.clearValueCount = 1;
+        renderPassInfo.pClearValues = &clearColor;
 
-            std::cout << "\tCommands:\n";
+        Log::trace("\tClear Color: (0.901, 0.623, 0.180, 1.0)");
 
-            vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            std::cout << "\t\tBegin Render Pass {Subpass Contents Inline}\n";
+        Log::trace("\tCommands:");
 
-            vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-            std::cout << "\t\tBind Pipeline {Bind Point: Graphics}\n";
+        vkCmdBeginRenderPass(target.commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        Log::trace("\t\tBegin Render Pass {Subpass Contents Inline}");
 
-            vkCmdDraw(commandBuffers[i], 6, 1, 0, 0);
-            std::cout << "\t\tDraw {Vertex Count: 6, Instances: 1, Start Index: 0, First Instance: 0}\n";
+        vkCmdBindPipeline(target.commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        counters.pipelineBinds++;
+        Log::trace("\t\tBind Pipeline {Bind Point: Graphics}");
 
-            vkCmdEndRenderPass(commandBuffers[i]);
-            std::cout << "\t\tEnd Render Pass\n";
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = (float)extent.width;
+        viewport.height = (float)extent.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(target.commandBuffers[i], 0, 1, &viewport);
+        Log::trace("\t\tSet Viewport {Width: {}, Height: {}}", viewport.width, viewport.height);
 
-            if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to record command buffer!");
+        VkRect2D scissor{};
+        scissor.offset = { 0, 0 };
+        scissor.extent = extent;
+        vkCmdSetScissor(target.commandBuffers[i], 0, 1, &scissor);
+        Log::trace("\t\tSet Scissor {Offset: (0, 0)}");
+
+        uint32_t vertexCount = batchSlot ? batchSlot->vertexCount : static_cast<uint32_t>(vertices.size());
+        VkBuffer vertexBuffers[] = { batchSlot ? batchSlot->vertexBuffer : vertexBuffer };
+        VkDeviceSize offsets[] = { 0 };
+        if (vertexCount > 0) {
+            vkCmdBindVertexBuffers(target.commandBuffers[i], 0, 1, vertexBuffers, offsets);
+            Log::trace("\t\tBind Vertex Buffer {Binding: 0}");
+
+            if (gpuProfiler) {
+                drawRegion = gpuProfiler->beginRegion(target.commandBuffers[i], "Draw");
             }
-            std::cout << "\tRecorded Command Buffer\n";
+            vkCmdDraw(target.commandBuffers[i], vertexCount, 1, 0, 0);
+            counters.draws++;
+            counters.vertices += vertexCount;
+            if (gpuProfiler) {
+                gpuProfiler->endRegion(target.commandBuffers[i], drawRegion);
+            }
+            Log::trace("\t\tDraw {Vertex Count: {}, Instances: 1, Start Index: 0, First Instance: 0}", vertexCount);
+        }
+
+        vkCmdEndRenderPass(target.commandBuffers[i]);
+        Log::trace("\t\tEnd Render Pass");
+
+        if (gpuProfiler) {
+            gpuProfiler->endStatistics(target.commandBuffers[i], renderPassStatistics);
+            gpuProfiler->endRegion(target.commandBuffers[i], renderPassRegion);
+        }
+
+        if (dynamicResolution) {
+            uint32_t upscaleRegion = 0;
+            if (gpuProfiler) {
+                upscaleRegion = gpuProfiler->beginRegion(target.commandBuffers[i], "Upscale");
+            }
+            recordUpscale(target, i, extent);
+            if (gpuProfiler) {
+                gpuProfiler->endRegion(target.commandBuffers[i], upscaleRegion);
+            }
+        }
+
+        // recorded right before its submission, so the next serial is this frame's
+        if (frameReadback && target.index == 0 && frameReadback->wants(submittedFrames + 1)) {
+            uint32_t readbackRegion = 0;
+            if (gpuProfiler) {
+                readbackRegion = gpuProfiler->beginRegion(target.commandBuffers[i], "Readback");
+            }
+            VkImageLayout layout = options.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+            frameReadback->recordCopy(target.commandBuffers[i], static_cast<uint32_t>(currentFrame), submittedFrames + 1, target.swapChainImages[i], target.swapChainImageFormat, target.swapChainExtent, layout, batchSlot ? batchSlot->name : std::string());
+            Log::trace("\t\tCopy To Readback Buffer {}", currentFrame);
+            if (gpuProfiler) {
+                gpuProfiler->endRegion(target.commandBuffers[i], readbackRegion);
+            }
+        }
+
+        if (gpuProfiler && lastInFrame) {
+            gpuProfiler->endRegion(target.commandBuffers[i], gpuFrameRegion);
         }
+
+        if (vkEndCommandBuffer(target.commandBuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+        Log::trace("\tRecorded Command Buffer");
+    }
+
+    // Blits the drawn part of scene target i over all of swapchain image i, leaving that in the layout the render
+    // pass would have (present source, or transfer source when headless)
+    void recordUpscale(RenderTarget& target, size_t i, VkExtent2D extent) {
+        // The render pass' output dependency already makes its color writes (and the move to TRANSFER_SRC) visible
+        // to the blit. The acquired image's old contents are overwritten; the acquire semaphore is waited on at the
+        // transfer stage.
+        VkImageMemoryBarrier toDestination{};
+        toDestination.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        toDestination.srcAccessMask = 0;
+        toDestination.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        toDestination.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        toDestination.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        toDestination.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toDestination.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toDestination.image = target.swapChainImages[i];
+        toDestination.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        toDestination.subresourceRange.levelCount = 1;
+        toDestination.subresourceRange.layerCount = 1;
+        vkCmdPipelineBarrier(target.commandBuffers[i], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toDestination);
+
+        VkImageBlit region{};
+        region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.srcSubresource.layerCount = 1;
+        region.srcOffsets[1] = { static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1 };
+        region.dstSubresource = region.srcSubresource;
+        region.dstOffsets[1] = { static_cast<int32_t>(target.swapChainExtent.width), static_cast<int32_t>(target.swapChainExtent.height), 1 };
+        vkCmdBlitImage(target.commandBuffers[i], target.sceneImages[i], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target.swapChainImages[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_LINEAR);
+        Log::trace("\t\tBlit Scene {Source: {}x{}, Destination: {}x{}}", extent.width, extent.height, target.swapChainExtent.width, target.swapChainExtent.height);
+
+        // Readback may copy from the image next; its barrier waits on the transfer stage. Present waits on the frame's
+        // semaphore, which covers everything before it.
+        VkImageMemoryBarrier toOutput = toDestination;
+        toOutput.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        toOutput.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        toOutput.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        toOutput.newLayout = options.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        vkCmdPipelineBarrier(target.commandBuffers[i], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toOutput);
     }
 
     // Sync Objects
     void createSyncObjects() {
-        std::cout << "Creating Sync Objects\n";
-        std::cout << "MAX_FRAMES_IN_FLIGHT: " << MAX_FRAMES_IN_FLIGHT << "\n";
+        TRACE_SCOPE("createSyncObjects", "init");
+        Log::debug("Creating Sync Objects");
+        Log::debug("Frames In Flight: {}", framesInFlight);
 
-        imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-        imagesInFlight.resize(swapChainImages.size(), VK_NULL_HANDLE);
+        renderFinishedSemaphores.resize(framesInFlight);
+        inFlightFences.resize(framesInFlight);
 
         VkSemaphoreCreateInfo semaphoreInfo{};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -1259,62 +1819,178 @@ std::cout << "\n";
         fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
+        for (size_t i = 0; i < framesInFlight; i++) {
+            if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
                 vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
 
                 throw std::runtime_error("failed to create synchronization objects for a frame!");
             }
-            std::cout << "Created Sync Objects for Frame " << i << "\n";
+            // each window acquires into its own semaphore
+            for (auto& target : targets) {
+                if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &target->imageAvailableSemaphores[i]) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create synchronization objects for a frame!");
+                }
+            }
+            Log::trace("Created Sync Objects for Frame {}", i);
 
         }
+
+        for (auto& target : targets) {
+            target->imagesInFlight.resize(target->swapChainImages.size(), VK_NULL_HANDLE);
+        }
     }
 
     // xreninmanx
     void drawFrame() {
-        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
-
-        uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
-            framebufferResized = false;
-            recreateSwapChain();
-        }
-        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-            throw std::runtime_error("failed to acquire swap chain image!");
+        TRACE_SCOPE("drawFrame", "frame");
+        frameMetrics->beginFrame();
+        pollShaderReload();
+        if (shaderVariantChanged) {
+            requestShaderVariant();
+        }
+        if (pendingVariant.valid()) {
+            applyShaderVariant();
+        }
+
+        {
+            TRACE_SCOPE("Wait For Frame Fence", "frame");
+            frameMetrics->beginWait();
+            vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+            frameMetrics->endWait();
+        }
+        completedFrames = std::max(completedFrames, frameSerials[currentFrame]);
+        deletionQueue.collect(completedFrames);
+        GpuFrameResult gpuResult;
+        if (gpuProfiler) {
+            gpuResult = gpuProfiler->collect(static_cast<uint32_t>(currentFrame));
+        }
+        if (frameReadback) {
+            frameReadback->collect(static_cast<uint32_t>(currentFrame));
+        }
+        const FrameSample* completedSample = frameMetrics->complete(static_cast<uint32_t>(currentFrame), gpuResult);
+        if (completedSample && frameBenchmark) {
+            frameBenchmark->record(*completedSample);
+        }
+        // the new scale is recorded into the command buffers from here on; with the GPU profiler running they are
+        // recorded every frame
+        if (completedSample && completedSample->hasGpuTime && dynamicResolution) {
+            dynamicResolution->update(completedSample->gpuMilliseconds);
+        }
+        if (batchLoader) {
+            stageBatchItem(currentFrame);
+        }
+
+        // every window that can draw this frame gets an image; the rest sit it out
+        FrameBatch& batch = frameBatch;
+        batch.targets.clear();
+        size_t minimized = 0;
+        for (auto& target : targets) {
+            if (!options.headless && windowMinimized(*target)) {
+                minimized++;
+                target->presentTiming.restart();
+                continue;
+            }
+            if (acquireImage(*target)) {
+                batch.targets.push_back(target.get());
+            }
+            else {
+                target->presentTiming.restart();
+            }
         }
+        if (batch.targets.empty()) {
+            // nothing can be drawn until a window is restored, so don't spin
+            if (minimized == targets.size()) {
+                glfwWaitEvents();
+            }
+            return;
+        }
+
+        batch.waitSemaphores.clear();
+        batch.waitStages.clear();
+        batch.commandBuffers.clear();
+        DrawCounters counters;
+        uint64_t pixels = 0;
+        for (size_t t = 0; t < batch.targets.size(); t++) {
+            RenderTarget& target = *batch.targets[t];
+            uint32_t imageIndex = target.imageIndex;
+
+            // Check if a previous frame is using this image (i.e. there is its fence to wait on)
+            if (target.imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+                TRACE_SCOPE("Wait For Image Fence", "frame");
+                frameMetrics->beginWait();
+                vkWaitForFences(device, 1, &target.imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+                frameMetrics->endWait();
+            }
+            // Mark the image as now being in use by this frame
+            target.imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+
+            // its last submission is done (waited on above), so it can be reset
+            if (target.commandBufferStale[imageIndex] || recordsEveryFrame()) {
+                auto recordStart = std::chrono::steady_clock::now();
+                vkResetCommandBuffer(target.commandBuffers[imageIndex], 0);
+                recordCommandBuffer(target, imageIndex, t == 0, t + 1 == batch.targets.size());
+                target.commandBufferStale[imageIndex] = false;
+                target.recordMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+            }
 
-
-        // Check if a previous frame is using this image (i.e. there is its fence to wait on)
-        if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
-            vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+            batch.waitSemaphores.push_back(target.imageAvailableSemaphores[currentFrame]);
+            // with dynamic resolution the swapchain image is first written by the upscale blit
+            batch.waitStages.push_back(dynamicResolution ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+            batch.commandBuffers.push_back(target.commandBuffers[imageIndex]);
+            counters += target.commandBufferCounters[imageIndex];
+            VkExtent2D extent = renderExtent(target);
+            pixels += uint64_t{ extent.width } * extent.height;
+            target.frames++;
         }
-        // Mark the image as now being in use by this frame
-        imagesInFlight[imageIndex] = inFlightFences[currentFrame];
 
+        // One submission for every window
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
+        // nothing was acquired or will be presented when headless, so there is nothing to wait on or signal
+        submitInfo.waitSemaphoreCount = options.headless ? 0 : static_cast<uint32_t>(batch.waitSemaphores.size());
+        submitInfo.pWaitSemaphores = batch.waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = batch.waitStages.data();
 
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+        submitInfo.commandBufferCount = static_cast<uint32_t>(batch.commandBuffers.size());
+        submitInfo.pCommandBuffers = batch.commandBuffers.data();
 
         VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.signalSemaphoreCount = options.headless ? 0 : 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
         vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
-        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to submit draw command buffer!");
+        {
+            TRACE_SCOPE("Submit", "frame");
+            if (renderDevice.submit(sessionId, submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit draw command buffer!");
+            }
+        }
+        frameSerials[currentFrame] = ++submittedFrames;
+        if (inputLatency) {
+            inputLatency->submitted(submittedFrames);
         }
+        frameMetrics->submit(static_cast<uint32_t>(currentFrame), submittedFrames, counters, pixels);
+
+        if (options.headless) {
+            frameMetrics->present(static_cast<uint32_t>(currentFrame));
+            currentFrame = (currentFrame + 1) % framesInFlight;
+            return;
+        }
+
+        // One present for every window, so they flip together and the queue is only taken once
+        batch.swapChains.clear();
+        batch.imageIndices.clear();
+        batch.presentIds.clear();
+        for (RenderTarget* target : batch.targets) {
+            batch.swapChains.push_back(target->swapChain);
+            batch.imageIndices.push_back(target->imageIndex);
+            // frame serials only ever increase, as present ids on a swapchain have to
+            target->presentId = submittedFrames;
+            batch.presentIds.push_back(target->presentId);
+        }
+        batch.results.assign(batch.targets.size(), VK_SUCCESS);
 
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -1322,97 +1998,508 @@ std::cout << "\n";
         presentInfo.waitSemaphoreCount = 1;
         presentInfo.pWaitSemaphores = signalSemaphores;
 
-        VkSwapchainKHR swapChains[] = { swapChain };
-        presentInfo.swapchainCount = 1;
-        presentInfo.pSwapchains = swapChains;
-        presentInfo.pImageIndices = &imageIndex;
+        presentInfo.swapchainCount = static_cast<uint32_t>(batch.swapChains.size());
+        presentInfo.pSwapchains = batch.swapChains.data();
+        presentInfo.pImageIndices = batch.imageIndices.data();
+
+        // each window handles its own result, so one going out of date doesn't rebuild the others
+        presentInfo.pResults = batch.results.data();
+
+        VkPresentIdKHR presentIds{};
+        presentIds.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+        presentIds.swapchainCount = presentInfo.swapchainCount;
+        presentIds.pPresentIds = batch.presentIds.data();
+        if (presentWait) {
+            presentInfo.pNext = &presentIds;
+        }
+
+        VkResult result;
+        {
+            TRACE_SCOPE("Present", "frame");
+            auto presentStart = std::chrono::steady_clock::now();
+            result = renderDevice.present(sessionId, presentInfo);
+            presentMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - presentStart).count();
+            presentCalls++;
+            presentedImages += batch.swapChains.size();
+        }
+        frameMetrics->present(static_cast<uint32_t>(currentFrame));
+        if (inputLatency) {
+            inputLatency->presented(submittedFrames);
+        }
+        for (RenderTarget* target : batch.targets) {
+            if (!pacesPresentation(*target)) {
+                target->presentTiming.record();
+            }
+        }
 
-        presentInfo.pResults = nullptr; // Optional
+        if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR) {
+            throw std::runtime_error("failed to present swap chain image!");
+        }
+        for (size_t t = 0; t < batch.targets.size(); t++) {
+            RenderTarget& target = *batch.targets[t];
+            VkResult targetResult = batch.results[t];
+            if (targetResult == VK_ERROR_OUT_OF_DATE_KHR) {
+                recreateSwapChain(target);
+            }
+            else if (targetResult == VK_SUBOPTIMAL_KHR || target.framebufferResized) {
+                // A suboptimal swapchain still presents correctly, so keep using it until the resize burst is over
+                if (resizeSettled(target)) {
+                    recreateSwapChain(target);
+                }
+            }
+            else if (targetResult != VK_SUCCESS) {
+                throw std::runtime_error("failed to present swap chain image!");
+            }
+        }
 
-        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        // the next frame only waits on its own slot's fence, so up to framesInFlight frames are queued at once
+        currentFrame = (currentFrame + 1) % framesInFlight;
+    }
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-            recreateSwapChain();
+    // Picks the image target draws into this frame. Returns false if its swapchain was out of date and got rebuilt
+    // instead, in which case it skips the frame.
+    bool acquireImage(RenderTarget& target) {
+        if (options.headless) {
+            // offscreen targets are handed out in turn; the image fence covers reuse
+            target.imageIndex = static_cast<uint32_t>(submittedFrames % target.swapChainImages.size());
+            return true;
         }
-        else if (result != VK_SUCCESS) {
-            throw std::runtime_error("failed to present swap chain image!");
+
+        VkResult result;
+        {
+            TRACE_SCOPE("Acquire Image", "frame");
+            auto acquireStart = std::chrono::steady_clock::now();
+            frameMetrics->beginWait();
+            result = vkAcquireNextImageKHR(device, target.swapChain, UINT64_MAX, target.imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &target.imageIndex);
+            frameMetrics->endWait();
+            target.acquireMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - acquireStart).count();
         }
 
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            recreateSwapChain(target);
+            return false;
+        }
+        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            throw std::runtime_error("failed to acquire swap chain image!");
+        }
+        return true;
+    }
 
-        vkQueueWaitIdle(presentQueue);
+    bool pacesPresentation(const RenderTarget& target) {
+        return presentWait && target.presentSettings.presentLag > 0;
+    }
+
+    // Present pacing: holds the CPU until each window's frame presentLag presents back is on screen, so the next
+    // frame samples input as late as it usefully can. Displayed frames also time the present-to-present intervals.
+    void waitForPresentation() {
+        for (auto& target : targets) {
+            if (!pacesPresentation(*target) || target->presentId == 0) {
+                continue;
+            }
+            uint32_t lag = target->presentSettings.presentLag;
+            if (target->presentId < lag) {
+                continue;
+            }
+            uint64_t presentId = target->presentId - (lag - 1);
+            if (presentId <= target->displayedId) {
+                continue;
+            }
+
+            TRACE_SCOPE("Wait For Present", "frame");
+            VkResult result = renderDevice.waitForPresent(target->swapChain, presentId, PRESENT_WAIT_TIMEOUT);
+            if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+                target->displayedId = presentId;
+                target->presentTiming.record();
+                if (target->index == 0 && inputLatency) {
+                    inputLatency->displayed(presentId);
+                }
+            }
+            else if (result == VK_TIMEOUT) {
+                // not displayed in time (hidden, or the swapchain is on its way out); don't hold the frame any longer
+                target->presentTiming.restart();
+            }
+            else if (result != VK_ERROR_OUT_OF_DATE_KHR) {
+                throw std::runtime_error("failed to wait for present!");
+            }
+        }
+    }
+
+    // Per-window CPU cost of acquiring and recording, what batching the present saves and the present jitter
+    void printTargetStats() {
+        if (options.headless) {
+            return;
+        }
+        for (const auto& target : targets) {
+            double frames = static_cast<double>(std::max<uint64_t>(target->frames, 1));
+            Log::info("Window {}: {} frames, acquire {} ms, record {} ms per frame, {} swapchain rebuilds", target->index, target->frames, target->acquireMilliseconds / frames, target->recordMilliseconds / frames, target->rebuilds);
+            target->presentTiming.printStats(options.presentPolicy, pacesPresentation(*target));
+        }
+        if (presentCalls > 0) {
+            Log::info("Present: {} calls, {} swapchains per call, {} ms per call", presentCalls, static_cast<double>(presentedImages) / presentCalls, presentMilliseconds / presentCalls);
+        }
     }
 
 
     // Mainloop
 
     void mainLoop() {
-        std::cout << "Starting Mainloop\n";
-        while (!glfwWindowShouldClose(window)) {
+        Log::info("Starting Mainloop");
+        uint64_t frames = 0;
+        while (options.frameCount == 0 || frames < options.frameCount) {
+            if (!options.headless) {
+                if (windowClosed()) {
+                    break;
+                }
+                waitForPresentation();
+                if (!waitForFrame()) {
+                    // the frame after an idle or throttled wait isn't late, the cap's schedule starts over
+                    if (frameLimiter) {
+                        frameLimiter->restart();
+                    }
+                    continue;
+                }
+            }
+            if (frameLimiter) {
+                TRACE_SCOPE("Frame Limit", "frame");
+                frameLimiter->wait();
+                // pick up input that came in while waiting, so the frame shows it
+                if (!options.headless) {
+                    glfwPollEvents();
+                }
+            }
+            drawFrame();
+            frames++;
+            if (frameBenchmark && frameBenchmark->finished()) {
+                break;
+            }
+        }
+        Log::info("Rendered {} Frames ({} idle waits)", frames, idleWaits);
+        Log::debug("Mainloop Finished. Waiting for frames in flight");
+
+        waitIdle();
+        Log::debug("Frames in flight are done.");
+    }
+
+    // Idle throttling. Polls events and returns true if the next frame is due; otherwise sleeps in
+    // glfwWaitEventsTimeout until it may be and returns false. Nothing is drawn while every window is minimized or
+    // hidden, frames are capped to --background-fps while no window has focus, and with --on-demand a frame is only
+    // due once something marked it dirty or an animation tick came up.
+    bool waitForFrame() {
+        {
+            TRACE_SCOPE("Poll Events", "frame");
             glfwPollEvents();
+        }
+        // drawFrame polls too, but with --on-demand it may not run for a while
+        if (options.onDemand) {
+            pollShaderReload();
+        }
+
+        bool visible = false, focused = false;
+        for (const auto& target : targets) {
+            if (!glfwGetWindowAttrib(target->window, GLFW_ICONIFIED) && glfwGetWindowAttrib(target->window, GLFW_VISIBLE)) {
+                visible = true;
+            }
+            if (glfwGetWindowAttrib(target->window, GLFW_FOCUSED)) {
+                focused = true;
+            }
+        }
+
+        double now = glfwGetTime();
+        bool tick = options.tickRate > 0.0f && now >= nextTick;
+        // frames keep coming while a variant builds, so it's shown as soon as it's done
+        bool wanted = visible && (!options.onDemand || frameDirty || tick || shaderVariantChanged || pendingVariant.valid());
+        double due = now;
+        if (!focused && options.backgroundRate > 0.0f) {
+            due = lastFrameTime + 1.0 / options.backgroundRate;
+        }
+
+        if (wanted && now >= due) {
+            if (tick) {
+                // a late tick isn't made up for, the next one is a full period away
+                nextTick += 1.0 / options.tickRate;
+                if (nextTick <= now) {
+                    nextTick = now + 1.0 / options.tickRate;
+                }
+            }
+            frameDirty = false;
+            lastFrameTime = now;
+            return true;
+        }
+
+        // sleep until the frame is due, the next tick or the next shader check; any event wakes it sooner
+        double wake = -1.0;
+        if (wanted) {
+            wake = due;
+        }
+        else if (visible && options.tickRate > 0.0f) {
+            wake = nextTick;
+        }
+        if (visible && options.onDemand && shaderWatcher) {
+            wake = wake < 0.0 ? now + SHADER_POLL_SECONDS : std::min(wake, now + SHADER_POLL_SECONDS);
+        }
+
+        TRACE_SCOPE("Idle", "frame");
+        idleWaits++;
+        if (wake < 0.0) {
+            glfwWaitEvents();
+        }
+        else {
+            glfwWaitEventsTimeout(std::max(wake - now, 0.0));
+        }
+        return false;
+    }
+
+    // Waits for this session's own work only, on its frame fences, so other sessions on the device keep rendering.
+    // Presents signal no fence, so before swapchains are rebuilt or destroyed a windowed session also idles the
+    // present queue; windowed sessions are always alone on the device (--sessions is headless only).
+    void waitIdle() {
+        if (!inFlightFences.empty()) {
+            vkWaitForFences(device, static_cast<uint32_t>(inFlightFences.size()), inFlightFences.data(), VK_TRUE, UINT64_MAX);
+        }
+        if (!options.headless) {
+            renderDevice.waitForPresentQueue(sessionId);
+        }
+    }
+
+    // Every file is one headless frame. While frame N renders, the loader threads parse N+1 and N+2 (with the default
+    // lookahead), the CPU fills frame N+1's staging buffer once its slot is free and the readback worker writes N-1.
+    void runBatch() {
+        Log::info("Starting Batch");
+        auto start = std::chrono::steady_clock::now();
+        auto lastReport = start;
+        size_t rendered = 0, failed = 0;
+
+        while (true) {
+            {
+                TRACE_SCOPE("Wait For Batch Item", "frame");
+                if (!batchLoader->next(batchItem)) {
+                    break;
+                }
+            }
+            if (!batchItem.error.empty()) {
+                Log::warn("Skipping \"{}\": {}", batchItem.path, batchItem.error);
+                failed++;
+                continue;
+            }
+
             drawFrame();
+            rendered++;
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastReport >= std::chrono::seconds(1)) {
+                double seconds = std::chrono::duration<double>(now - start).count();
+                Log::info("Batch: {}/{} files, {} files/s", rendered + failed, batchLoader->size(), rendered / seconds);
+                lastReport = now;
+            }
         }
-        std::cout << "Mainloop Finished. Waiting for devices to be idle\n";
 
-        vkDeviceWaitIdle(device);
-        std::cout << "Devices are idle.\n";
+        waitIdle();
+        // the last images are only done once they're written
+        if (frameReadback) {
+            frameReadback->destroy();
+            frameReadback.reset();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Log::info("Batch Finished: {} files rendered in {} s ({} files/s), {} failed", rendered, seconds, seconds > 0.0 ? rendered / seconds : 0.0, failed);
+        batchItem = BatchItem{};
     }
 
     // Cleanup
     void cleanup() {
-        std::cout << "Beginning Cleanup (Tasks 0-14)\n";
+        TRACE_SCOPE("cleanup", "cleanup");
+        Log::info("Beginning Cleanup (Tasks 0-10)");
 
-        cleanupSwapChain();
+        // also runs after a failed start, with only part of the session created; everything not yet created is null
+        if (device == VK_NULL_HANDLE) {
+            destroyWindows();
+            renderDevice.unregisterSession(sessionId);
+            return;
+        }
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-            vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-            vkDestroyFence(device, inFlightFences[i], nullptr);
-            std::cout << "(7." << i << ") Destroyed Sync Objects " << i << "\n";
+        for (auto& target : targets) {
+            cleanupSwapChain(*target);
 
+            if (options.headless) {
+                destroyOffscreenTargets(*target);
+                Log::debug("(3/10) Destroyed Offscreen Targets");
+            }
+            else {
+                vkDestroySwapchainKHR(device, target->swapChain, nullptr);
+                Log::debug("(3/10) Destroyed Swapchain {}", target->index);
+            }
         }
 
-        vkDestroyCommandPool(device, commandPool, nullptr);
-        std::cout << "(8/14) Destroyed Command Pool\n";
+        shaderWatcher.reset();
+        deletionQueue.flush();
+        destroyShaderModules();
+
+        if (pipelineRegistry) {
+            pipelineRegistry->printStats();
+            pipelineRegistry->destroy();
+        }
+        Log::debug("(4/10) Destroyed Graphics Pipelines");
+        Log::debug("(5/10) Destroyed Pipeline Layouts");
 
-        vkDestroyDevice(device, nullptr);
-        std::cout << "(9/14) Destroyed Logical Device\n";
+        vkDestroyRenderPass(device, renderPass, nullptr);
+        Log::debug("(6/10) Destroyed Render Pass");
 
+        for (size_t i = 0; i < framesInFlight; i++) {
+            if (i < renderFinishedSemaphores.size()) {
+                vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
+            }
+            for (auto& target : targets) {
+                vkDestroySemaphore(device, target->imageAvailableSemaphores[i], nullptr);
+            }
+            if (i < inFlightFences.size()) {
+                vkDestroyFence(device, inFlightFences[i], nullptr);
+            }
+            Log::trace("(7.{}) Destroyed Sync Objects {}", i, i);
 
-        if (enableValidationLayers) {
-            DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
-            std::cout << "(10/14) Destroyed Debug Messenger\n";
         }
-        else {
-            std::cout << "(10/14) Skipping\n";
 
+        vkDestroyCommandPool(device, commandPool, nullptr);
+        Log::debug("(8/10) Destroyed Command Pool");
+
+        vkDestroyBuffer(device, vertexBuffer, nullptr);
+        renderDevice.freeMemory(vertexBufferMemory);
+        for (auto& slot : batchSlots) {
+            destroyBatchSlot(slot);
         }
+        Log::debug("(8.05/10) Destroyed Vertex Buffer");
 
-        vkDestroySurfaceKHR(instance, surface, nullptr);
-        std::cout << "(11/14) Destroyed Surface\n";
+        if (frameMetrics) {
+            frameMetrics->printSummary();
+        }
+        printTargetStats();
+        if (inputLatency) {
+            inputLatency->printSummary();
+        }
+        if (dynamicResolution) {
+            dynamicResolution->printStats();
+        }
+        if (frameLimiter) {
+            frameLimiter->printStats();
+            frameLimiter->destroy();
+        }
+        if (gpuProfiler) {
+            gpuProfiler->printStats();
+            gpuProfiler->destroy();
+            Log::debug("(8.07/10) Destroyed GPU Profiler");
+        }
+        if (frameReadback) {
+            frameReadback->destroy();
+            frameReadback.reset();
+            Log::debug("(8.08/10) Destroyed Frame Readback");
+        }
 
-        vkDestroyInstance(instance, nullptr);
-        std::cout << "(12/14) Destroyed Instance\n";
+        resourceCache.printStats();
 
-        glfwDestroyWindow(window);
-        std::cout << "(13/14) Destroyed Window\n";
+        // the device itself and the pipeline cache belong to the RenderDevice
+        renderDevice.unregisterSession(sessionId);
+        Log::debug("(9/10) Unregistered Session {}", sessionId);
 
-        glfwTerminate();
-        std::cout << "(14/14) Terminated GLFW\n";
+        destroyWindows();
+    }
+
+    void destroyWindows() {
+        if (!options.headless) {
+            for (auto& target : targets) {
+                vkDestroySurfaceKHR(instance, target->surface, nullptr);
+                glfwDestroyWindow(target->window);
+            }
+            Log::debug("(10/10) Destroyed {} Surfaces + Windows", targets.size());
+        }
     }
 };
 
 
-int main() {
-    HelloTriangleApplication app;
+// --sessions: independent headless sessions, each rendering on its own thread. They share the device and take turns
+// on its queue; each writes its readback frames and metrics to its own location.
+static bool runSessions(RenderDevice& renderDevice, const AppOptions& options) {
+    Log::info("Starting {} Render Sessions", options.sessionCount);
+    renderDevice.initialize(VK_NULL_HANDLE);
+
+    std::atomic<bool> failed{ false };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < options.sessionCount; i++) {
+        AppOptions sessionOptions = options;
+        std::string suffix = "session" + std::to_string(i);
+        sessionOptions.readbackDirectory = (std::filesystem::path(options.readbackDirectory) / suffix).string();
+        if (!options.metricsFile.empty()) {
+            std::filesystem::path metrics(options.metricsFile);
+            sessionOptions.metricsFile = (metrics.parent_path() / (metrics.stem().string() + "_" + suffix + metrics.extension().string())).string();
+        }
+
+        threads.emplace_back([&renderDevice, &failed, sessionOptions, i] {
+            std::string threadName = "Session " + std::to_string(i);
+            Trace::setThreadName(threadName.c_str());
+            try {
+                RenderSession session(renderDevice, sessionOptions);
+                session.run();
+            }
+            catch (const std::exception& e) {
+                Log::flush();
+                std::cerr << "Session " + std::to_string(i) + ": " + e.what() + "\n";
+                failed = true;
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return !failed;
+}
+
+int main(int argc, char** argv) {
+    AppOptions options;
 
     try {
-        app.run();
+        options = parseOptions(argc, argv);
     }
     catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
+        printUsage(argv[0], std::cerr);
         return EXIT_FAILURE;
     }
 
-    return EXIT_SUCCESS;
+    if (options.showHelp) {
+        printUsage(argv[0]);
+        return EXIT_SUCCESS;
+    }
+
+    Log::start(options.logLevel);
+    Trace::setThreadName("Main");
+    if (!options.traceFile.empty()) {
+        Trace::start(options.traceFile);
+    }
+    if (!options.headless) {
+        glfwInit();
+    }
+
+    bool failed = false;
+    try {
+        RenderDevice renderDevice(options.headless, options.pipelineStatistics);
+        if (options.sessionCount > 1) {
+            failed = !runSessions(renderDevice, options);
+        }
+        else {
+            RenderSession app(renderDevice, options);
+            app.run();
+        }
+        renderDevice.destroy();
+    }
+    catch (const std::exception& e) {
+        // after everything already logged
+        Log::flush();
+        std::cerr << e.what() << std::endl;
+        failed = true;
+    }
+
+    if (!options.headless) {
+        glfwTerminate();
+    }
+    Trace::stop();
+    Log::stop();
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,96 @@
+#include "Mesh.h"
+
+#include <charconv>
+#include <cstddef>
+#include <stdexcept>
+
+#include "Trace.h"
+
+std::vector<VkVertexInputBindingDescription> Vertex::getBindingDescriptions() {
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof(Vertex);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    return { bindingDescription };
+}
+
+std::vector<VkVertexInputAttributeDescription> Vertex::getAttributeDescriptions() {
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2);
+
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescriptions[0].offset = offsetof(Vertex, pos);
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[1].offset = offsetof(Vertex, color);
+
+    return attributeDescriptions;
+}
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+std::vector<Vertex> parseMeshCsv(const ResourceSpan& csv, const std::string& name) {
+    TRACE_SCOPE("parseMeshCsv", "loader");
+    const char* cursor = reinterpret_cast<const char*>(csv.data);
+    const char* end = cursor + csv.size;
+
+    std::vector<Vertex> vertices;
+    size_t lineNumber = 0;
+    while (cursor < end) {
+        const char* lineEnd = cursor;
+        while (lineEnd < end && *lineEnd != '\n') {
+            lineEnd++;
+        }
+        lineNumber++;
+
+        float values[5];
+        size_t count = 0;
+        const char* field = cursor;
+        while (field < lineEnd) {
+            while (field < lineEnd && isBlank(*field)) {
+                field++;
+            }
+            if (field == lineEnd) {
+                break;
+            }
+
+            if (count == 5) {
+                throw std::runtime_error("too many values on line " + std::to_string(lineNumber) + " of mesh \"" + name + "\"!");
+            }
+            auto parsed = std::from_chars(field, lineEnd, values[count]);
+            if (parsed.ec != std::errc()) {
+                throw std::runtime_error("invalid value on line " + std::to_string(lineNumber) + " of mesh \"" + name + "\"!");
+            }
+            count++;
+
+            field = parsed.ptr;
+            while (field < lineEnd && isBlank(*field)) {
+                field++;
+            }
+            if (field < lineEnd && *field == ',') {
+                field++;
+            }
+        }
+
+        // blank lines are allowed, partial vertices are not
+        if (count == 5) {
+            Vertex vertex{};
+            vertex.pos = { values[0], values[1] };
+            vertex.color = { values[2], values[3], values[4] };
+            vertices.push_back(vertex);
+        }
+        else if (count != 0) {
+            throw std::runtime_error("expected 5 values on line " + std::to_string(lineNumber) + " of mesh \"" + name + "\"!");
+        }
+
+        cursor = lineEnd + 1;
+    }
+
+    return vertices;
+}
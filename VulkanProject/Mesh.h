@@ -0,0 +1,25 @@
+#pragma once
+
+#ifndef GLFW_INCLUDE_VULKAN
+#define GLFW_INCLUDE_VULKAN
+#endif
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "ResourceCache.h"
+
+struct Vertex {
+    glm::vec2 pos;
+    glm::vec3 color;
+
+    static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+    static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+};
+
+// Parses a mesh in the res/object.csv format: one vertex per line, "x,y,r,g,b," (trailing comma and blanks allowed),
+// read straight out of the span without copying lines.
+std::vector<Vertex> parseMeshCsv(const ResourceSpan& csv, const std::string& name);
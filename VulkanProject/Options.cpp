@@ -0,0 +1,380 @@
+#include "Options.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+static std::string nextValue(int argc, char** argv, int& i) {
+    std::string flag = argv[i];
+    if (i + 1 >= argc) {
+        throw std::runtime_error("missing value for " + flag + "!");
+    }
+    return argv[++i];
+}
+
+static uint32_t toUInt(const std::string& flag, const std::string& value) {
+    try {
+        size_t used = 0;
+        unsigned long parsed = std::stoul(value, &used);
+        if (used != value.size()) {
+            throw std::invalid_argument(value);
+        }
+        return static_cast<uint32_t>(parsed);
+    }
+    catch (const std::exception&) {
+        throw std::runtime_error("invalid value \"" + value + "\" for " + flag + "!");
+    }
+}
+
+static float toFloat(const std::string& flag, const std::string& value) {
+    try {
+        size_t used = 0;
+        float parsed = std::stof(value, &used);
+        if (used != value.size()) {
+            throw std::invalid_argument(value);
+        }
+        return parsed;
+    }
+    catch (const std::exception&) {
+        throw std::runtime_error("invalid value \"" + value + "\" for " + flag + "!");
+    }
+}
+
+static ColorMode toColorMode(const std::string& flag, const std::string& value) {
+    if (value == "vertex") {
+        return ColorMode::Vertex;
+    }
+    if (value == "grayscale") {
+        return ColorMode::Grayscale;
+    }
+    if (value == "inverted") {
+        return ColorMode::Inverted;
+    }
+    throw std::runtime_error("invalid value \"" + value + "\" for " + flag + "!");
+}
+
+static ReadbackOutput toReadbackOutput(const std::string& flag, const std::string& value) {
+    if (value == "ppm") {
+        return ReadbackOutput::Ppm;
+    }
+    if (value == "png") {
+        return ReadbackOutput::Png;
+    }
+    if (value == "hash") {
+        return ReadbackOutput::Hash;
+    }
+    throw std::runtime_error("invalid value \"" + value + "\" for " + flag + "!");
+}
+
+static PresentPolicy toPresentPolicy(const std::string& flag, const std::string& value) {
+    if (value == "low-latency") {
+        return PresentPolicy::LowLatency;
+    }
+    if (value == "balanced") {
+        return PresentPolicy::Balanced;
+    }
+    if (value == "power-saving") {
+        return PresentPolicy::PowerSaving;
+    }
+    throw std::runtime_error("invalid value \"" + value + "\" for " + flag + "!");
+}
+
+// false for off, true for on, anything else is an error
+static bool toChoice(const std::string& flag, const std::string& value, const char* off, const char* on) {
+    if (value == off) {
+        return false;
+    }
+    if (value == on) {
+        return true;
+    }
+    throw std::runtime_error("invalid value \"" + value + "\" for " + flag + "!");
+}
+
+static LogLevel toLogLevel(const std::string& flag, const std::string& value) {
+    LogLevel level;
+    if (!Log::parseLevel(value, level)) {
+        throw std::runtime_error("invalid value \"" + value + "\" for " + flag + "!");
+    }
+    return level;
+}
+
+AppOptions parseOptions(int argc, char** argv) {
+    AppOptions options;
+
+    if (const char* traceFile = std::getenv("VULKANPROJECT_TRACE")) {
+        options.traceFile = traceFile;
+    }
+
+    bool frameCountGiven = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-h" || arg == "--help") {
+            options.showHelp = true;
+        }
+        else if (arg == "--pipeline-bench") {
+            options.pipelineBenchThreads = toUInt(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--pipeline-bench-count") {
+            options.pipelineBenchCount = toUInt(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--color-mode") {
+            options.colorMode = toColorMode(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--position-scale") {
+            options.positionScale = toFloat(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--shader-dir") {
+            options.shaderDirectory = nextValue(argc, argv, i);
+        }
+        else if (arg == "--hot-reload") {
+            options.hotReload = true;
+        }
+        else if (arg == "--glslc") {
+            options.glslc = nextValue(argc, argv, i);
+        }
+        else if (arg == "--archive") {
+            options.archive = nextValue(argc, argv, i);
+        }
+        else if (arg == "--log-level") {
+            options.logLevel = toLogLevel(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--trace") {
+            options.traceFile = nextValue(argc, argv, i);
+        }
+        else if (arg == "--gpu-profile") {
+            options.gpuProfile = true;
+        }
+        else if (arg == "--pipeline-stats") {
+            options.pipelineStatistics = true;
+        }
+        else if (arg == "--metrics") {
+            options.metricsFile = nextValue(argc, argv, i);
+        }
+        else if (arg == "--latency-file") {
+            options.latencyFile = nextValue(argc, argv, i);
+        }
+        else if (arg == "--headless") {
+            options.headless = true;
+        }
+        else if (arg == "--frames") {
+            options.frameCount = toUInt(arg, nextValue(argc, argv, i));
+            frameCountGiven = true;
+        }
+        else if (arg == "--benchmark") {
+            options.runBenchmark = true;
+            options.benchmark.outputPath = nextValue(argc, argv, i);
+        }
+        else if (arg == "--benchmark-warmup") {
+            options.benchmark.warmupFrames = toUInt(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--benchmark-frames") {
+            options.benchmark.frames = toUInt(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--benchmark-seconds") {
+            options.benchmark.seconds = toFloat(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--benchmark-baseline") {
+            options.benchmark.baselinePath = nextValue(argc, argv, i);
+        }
+        else if (arg == "--benchmark-threshold") {
+            options.benchmark.threshold = toFloat(arg, nextValue(argc, argv, i)) / 100.0;
+        }
+        else if (arg == "--readback") {
+            options.readback = true;
+            options.readbackOutput = toReadbackOutput(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--readback-dir") {
+            options.readbackDirectory = nextValue(argc, argv, i);
+        }
+        else if (arg == "--readback-every") {
+            options.readbackEvery = toUInt(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--stream") {
+            options.streamTarget = nextValue(argc, argv, i);
+        }
+        else if (arg == "--stream-format") {
+            options.streamI420 = toChoice(arg, nextValue(argc, argv, i), "rgba", "yuv");
+        }
+        else if (arg == "--stream-policy") {
+            options.streamBlock = toChoice(arg, nextValue(argc, argv, i), "drop", "block");
+        }
+        else if (arg == "--batch") {
+            options.batchInputs.push_back(nextValue(argc, argv, i));
+        }
+        else if (arg == "--batch-lookahead") {
+            options.batchLookahead = toUInt(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--present-policy") {
+            options.presentPolicy = toPresentPolicy(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--on-demand") {
+            options.onDemand = true;
+        }
+        else if (arg == "--tick-rate") {
+            options.tickRate = toFloat(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--background-fps") {
+            options.backgroundRate = toFloat(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--fps-cap") {
+            options.frameCap = toFloat(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--limiter") {
+            options.limiterPlainSleep = toChoice(arg, nextValue(argc, argv, i), "hybrid", "sleep");
+        }
+        else if (arg == "--dynamic-resolution") {
+            options.resolutionBudget = toFloat(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--min-resolution-scale") {
+            options.minResolutionScale = toFloat(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--windows") {
+            options.windowCount = toUInt(arg, nextValue(argc, argv, i));
+        }
+        else if (arg == "--sessions") {
+            options.sessionCount = toUInt(arg, nextValue(argc, argv, i));
+        }
+        else {
+            throw std::runtime_error("unknown option \"" + arg + "\"!");
+        }
+    }
+
+    if (!options.streamTarget.empty()) {
+        if (options.readback) {
+            throw std::runtime_error("--stream and --readback can't be used together!");
+        }
+        options.readback = true;
+        options.readbackOutput = ReadbackOutput::Stream;
+    }
+
+    if (!options.batchInputs.empty()) {
+        if (!options.streamTarget.empty() || options.runBenchmark) {
+            throw std::runtime_error("--batch can't be used with --stream or --benchmark!");
+        }
+        if (options.readbackEvery != 1) {
+            throw std::runtime_error("--batch reads back every frame, --readback-every can't be used with it!");
+        }
+        if (options.batchLookahead == 0) {
+            throw std::runtime_error("--batch-lookahead needs a value above 0!");
+        }
+        if (!options.readback) {
+            options.readback = true;
+            options.readbackOutput = ReadbackOutput::Png;
+        }
+        // one frame per file, the batch ends the run
+        options.headless = true;
+        options.frameCount = 0;
+        frameCountGiven = true;
+    }
+
+    if (options.pipelineBenchThreads > 0 && options.pipelineBenchCount == 0) {
+        throw std::runtime_error("--pipeline-bench-count needs a value above 0!");
+    }
+
+    if (options.windowCount == 0) {
+        throw std::runtime_error("--windows needs a value above 0!");
+    }
+    if (options.windowCount > 1 && options.headless) {
+        throw std::runtime_error("--windows can't be used with --headless!");
+    }
+
+    if (options.sessionCount == 0) {
+        throw std::runtime_error("--sessions needs a value above 0!");
+    }
+    if (options.sessionCount > 1) {
+        if (!options.headless) {
+            throw std::runtime_error("--sessions needs --headless!");
+        }
+        if (options.runBenchmark || !options.batchInputs.empty() || !options.streamTarget.empty() || options.pipelineBenchThreads > 0) {
+            throw std::runtime_error("--sessions can't be used with --benchmark, --batch, --stream or --pipeline-bench!");
+        }
+    }
+
+    if (options.onDemand && (options.headless || options.runBenchmark)) {
+        throw std::runtime_error("--on-demand can't be used with --headless or --benchmark!");
+    }
+    if (options.tickRate < 0.0f || (options.tickRate > 0.0f && !options.onDemand)) {
+        throw std::runtime_error("--tick-rate needs --on-demand and a value of 0 or above!");
+    }
+    if (options.frameCap < 0.0f) {
+        throw std::runtime_error("--fps-cap needs a value of 0 or above!");
+    }
+    if (options.resolutionBudget < 0.0f) {
+        throw std::runtime_error("--dynamic-resolution needs a value of 0 or above!");
+    }
+    if (options.minResolutionScale <= 0.0f || options.minResolutionScale > 1.0f) {
+        throw std::runtime_error("--min-resolution-scale needs a value above 0 and at most 1!");
+    }
+    if (options.resolutionBudget > 0.0f) {
+        // the scale follows the GPU frame time from the timestamp profiler
+        options.gpuProfile = true;
+    }
+    if (options.backgroundRate < 0.0f) {
+        throw std::runtime_error("--background-fps needs a value of 0 or above!");
+    }
+
+    if (options.runBenchmark) {
+        if (options.benchmark.frames == 0 && options.benchmark.seconds <= 0.0) {
+            throw std::runtime_error("--benchmark needs a frame count or duration above 0!");
+        }
+        // GPU times come from the timestamp profiler
+        options.gpuProfile = true;
+        options.backgroundRate = 0.0f;
+    }
+
+    // nothing can close a headless run, so it always needs a frame limit (a benchmark ends itself)
+    if (options.headless && !frameCountGiven && !options.runBenchmark) {
+        options.frameCount = 100;
+    }
+    if (options.headless && options.frameCount == 0 && !options.runBenchmark && options.batchInputs.empty()) {
+        throw std::runtime_error("--headless needs a frame count above 0!");
+    }
+
+    return options;
+}
+
+void printUsage(const char* program, std::ostream& out) {
+    out << "Usage: " << program << " [options]\n";
+    out << "\t-h, --help                   Show this message\n";
+    out << "\t--pipeline-bench <threads>   Time pipeline compilation with 1..threads workers and exit\n";
+    out << "\t--pipeline-bench-count <n>   Pipelines compiled per benchmark run (default 32)\n";
+    out << "\t--color-mode <mode>          vertex, grayscale or inverted (default vertex, C cycles)\n";
+    out << "\t--position-scale <s>         Scale applied to the quad by the vertex shader (default 1)\n";
+    out << "\t--shader-dir <dir>           Load SPIR-V from dir instead of the embedded shaders (e.g. res)\n";
+    out << "\t--hot-reload                 Reload shaders from the shader directory when they change\n";
+    out << "\t--glslc <path>               With --hot-reload, recompile edited GLSL with this glslc\n";
+    out << "\t--archive <path>             Load assets from a packed archive (see AssetPacker)\n";
+    out << "\t--log-level <level>          trace, debug, info, warn, error or off (default info)\n";
+    out << "\t--trace <path>               Write a Chrome trace of CPU scopes to path (or set VULKANPROJECT_TRACE)\n";
+    out << "\t--gpu-profile                Time GPU work with timestamp queries and print the results on exit\n";
+    out << "\t--pipeline-stats             Count vertex, primitive and fragment shader work per pass\n";
+    out << "\t--metrics <path>             Write per-frame times, draw counters and statistics to a CSV file\n";
+    out << "\t--latency-file <path>        Append input-to-present latency samples to a CSV file\n";
+    out << "\t--headless                   Render offscreen without a window or surface (no display needed)\n";
+    out << "\t--frames <n>                 Exit after n frames (default: until closed, 100 when headless)\n";
+    out << "\t--benchmark <path>           Measure frame times after a warm-up and write percentiles to path as JSON\n";
+    out << "\t--benchmark-warmup <n>       Frames rendered before measuring (default 30)\n";
+    out << "\t--benchmark-frames <n>       Frames measured (default 300)\n";
+    out << "\t--benchmark-seconds <s>      Measure for s seconds instead of a frame count\n";
+    out << "\t--benchmark-baseline <path>  Fail if results are worse than this earlier --benchmark output\n";
+    out << "\t--benchmark-threshold <pct>  Allowed regression against the baseline in percent (default 5)\n";
+    out << "\t--readback <ppm|png|hash>    Copy frames back to the CPU and save them (or their hashes)\n";
+    out << "\t--readback-dir <dir>         Where --readback writes (default frames)\n";
+    out << "\t--readback-every <n>         Only read back every nth frame (default 1)\n";
+    out << "\t--stream <target>            Stream frames to pipe:<path>, unix:<path> or shm:<name> (see FrameConsumer)\n";
+    out << "\t--stream-format <rgba|yuv>   Raw pixels or I420 (default rgba)\n";
+    out << "\t--stream-policy <drop|block> Drop frames or stall rendering when the consumer is behind (default drop)\n";
+    out << "\t--batch <path|glob|@list>    Render each vertex CSV into --readback-dir and exit (repeatable)\n";
+    out << "\t--batch-lookahead <n>        Files loaded ahead of the one being rendered (default 2)\n";
+    out << "\t--present-policy <policy>    low-latency, balanced (default) or power-saving\n";
+    out << "\t--on-demand                  Only draw when input, a resize or a shader change needs a new frame\n";
+    out << "\t--tick-rate <hz>             With --on-demand, also draw this many frames per second\n";
+    out << "\t--background-fps <hz>        Frame rate cap while no window has focus (default 10, 0 = none)\n";
+    out << "\t--fps-cap <hz>               Start frames at exactly this rate, independent of vsync\n";
+    out << "\t--limiter <hybrid|sleep>     Frame cap sleeps then spins (default) or only sleeps\n";
+    out << "\t--dynamic-resolution <ms>    Lower the render resolution while GPU frame time is over ms\n";
+    out << "\t--min-resolution-scale <s>   Lowest resolution scale for --dynamic-resolution (default 0.5)\n";
+    out << "\t--windows <n>                Open n windows of the same scene, presented together\n";
+    out << "\t--sessions <n>               Run n headless sessions sharing one device, one thread each\n";
+}
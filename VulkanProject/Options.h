@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "FrameBenchmark.h"
+#include "FrameReadback.h"
+#include "Log.h"
+#include "PresentPolicy.h"
+#include "ShaderVariants.h"
+
+// Command line switches. Everything defaults to the normal interactive window.
+struct AppOptions {
+    bool showHelp = false;
+
+    // --pipeline-bench <threads>: compile a batch of pipeline variants with 1..threads workers, print timings and exit
+    uint32_t pipelineBenchThreads = 0;
+    // --pipeline-bench-count <n>: number of pipelines in that batch
+    uint32_t pipelineBenchCount = 32;
+
+    // --color-mode <vertex|grayscale|inverted>: fragment shader variant used at startup (C cycles it at runtime)
+    ColorMode colorMode = ColorMode::Vertex;
+    // --position-scale <s>: vertex shader variant that scales the quad
+    float positionScale = 1.0f;
+
+    // --shader-dir <dir>: load *.spv from dir when present instead of the copies embedded at build time
+    std::string shaderDirectory;
+    // --hot-reload: watch the shader directory (res if not given) and swap in changed shaders while running
+    bool hotReload = false;
+    // --glslc <path>: with --hot-reload, also watch shader.vert/shader.frag and recompile them with this glslc
+    std::string glslc;
+
+    // --archive <path>: load meshes and shaders from an AssetPacker archive, falling back to res/ for anything missing
+    std::string archive;
+
+    // --log-level <trace|debug|info|warn|error|off>: least severe messages printed; trace adds the per-object dumps (L cycles it)
+    LogLevel logLevel = LogLevel::Info;
+
+    // --trace <path>: record CPU scopes and write them to path as Chrome trace JSON on exit.
+    // Defaults to $VULKANPROJECT_TRACE so traces can be captured without touching the command line.
+    std::string traceFile;
+    // --gpu-profile: time the render pass with timestamp queries; averages and percentiles are printed on exit and
+    // added to the trace as counters
+    bool gpuProfile = false;
+    // --pipeline-stats: also count vertices, primitives and fragment shader invocations per pass (needs the
+    // pipelineStatisticsQuery device feature)
+    bool pipelineStatistics = false;
+    // --metrics <path>: write one CSV row of frame time, draw counters and pipeline statistics per frame
+    std::string metricsFile;
+    // --latency-file <path>: append input-to-present (and, when paced, input-to-display) latency samples to path as
+    // CSV, one row per input-carrying frame labelled with the present policy and frames in flight
+    std::string latencyFile;
+
+    // --headless: no window, surface or swapchain; frames are rendered into offscreen images, so this runs on
+    // software implementations like lavapipe and SwiftShader
+    bool headless = false;
+    // --frames <n>: stop after n frames (0 runs until the window is closed; headless defaults to 100)
+    uint32_t frameCount = 0;
+
+    // --benchmark <path>: after --benchmark-warmup frames, measure --benchmark-frames frames (or --benchmark-seconds)
+    // and write frame time percentiles to path as JSON. --benchmark-baseline <path> compares the results against an
+    // earlier run and fails if anything got more than --benchmark-threshold percent worse. Turns on --gpu-profile.
+    bool runBenchmark = false;
+    BenchmarkSettings benchmark;
+
+    // --readback <ppm|png|hash>: copy rendered frames back to the CPU and write them to --readback-dir (default
+    // frames) as images, or their hashes to hashes.txt there. --readback-every <n> only reads back every nth frame.
+    bool readback = false;
+    ReadbackOutput readbackOutput = ReadbackOutput::Ppm;
+    std::string readbackDirectory = "frames";
+    uint32_t readbackEvery = 1;
+
+    // --stream <pipe:path|unix:path|shm:name>: send read back frames to another process (see FrameConsumer) instead
+    // of writing files. --stream-format <rgba|yuv> picks raw RGBA or I420, --stream-policy <drop|block> what happens
+    // when the consumer falls behind. --readback-every applies here too.
+    std::string streamTarget;
+    bool streamI420 = false;
+    bool streamBlock = false;
+
+    // --batch <path|glob|@list>: render every listed vertex CSV once, headless, into --readback-dir (as png unless
+    // --readback says otherwise) and exit. Can be repeated. Loading, upload, rendering and readback of consecutive
+    // files overlap; --batch-lookahead <n> is how many files are loaded ahead of the one being rendered.
+    std::vector<std::string> batchInputs;
+    uint32_t batchLookahead = 2;
+
+    // --sessions <n>: run n independent headless sessions on one shared device, each on its own thread, taking turns
+    // on the queue. Readback frames go to session<i> below --readback-dir, metrics to <name>_session<i>.csv.
+    uint32_t sessionCount = 1;
+
+    // --windows <n>: open n windows showing the same scene. They share the render pass, pipelines and vertex data,
+    // are submitted and presented together once per frame, and each rebuilds its swapchain on its own when resized.
+    // Closing any of them exits. Readback copies the first window only.
+    uint32_t windowCount = 1;
+
+    // --present-policy <low-latency|balanced|power-saving>: present mode, swapchain image count, frames in flight and
+    // present pacing (with VK_KHR_present_wait) chosen together; present jitter is reported on exit
+    PresentPolicy presentPolicy = PresentPolicy::Balanced;
+
+    // --on-demand: only draw when something changed (input, a resize, an uncovered window, a shader change) instead
+    // of continuously, sleeping in between
+    bool onDemand = false;
+    // --tick-rate <hz>: with --on-demand, also draw this many frames per second, for animation
+    float tickRate = 0.0f;
+    // --background-fps <hz>: cap the frame rate while no window has focus, 0 for no cap. Minimized or hidden windows
+    // never draw. Benchmarks are never capped.
+    float backgroundRate = 10.0f;
+
+    // --fps-cap <hz>: start frames at exactly this rate, independent of vsync and the present mode. --limiter
+    // <hybrid|sleep> picks sleeping on a timer and spinning the last stretch (default) or only sleeping, to compare
+    // pacing and CPU usage; both are reported on exit.
+    float frameCap = 0.0f;
+    bool limiterPlainSleep = false;
+
+    // --dynamic-resolution <ms>: render the scene at a fraction of the window's resolution and scale it up, lowering
+    // the fraction while the GPU frame time is over this budget and raising it back when there is room. Turns on
+    // --gpu-profile. --min-resolution-scale <s> is the lowest fraction of the width and height it goes to.
+    float resolutionBudget = 0.0f;
+    float minResolutionScale = 0.5f;
+};
+
+AppOptions parseOptions(int argc, char** argv);
+// to stderr when the arguments were wrong
+void printUsage(const char* program, std::ostream& out = std::cout);
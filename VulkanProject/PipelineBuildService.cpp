@@ -0,0 +1,158 @@
+#include "PipelineBuildService.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+
+#include "Log.h"
+#include "Trace.h"
+
+PipelineBuildService::PipelineBuildService(VkDevice device, VkPipelineCache cache, uint32_t threadCount) : m_Device{ device }, m_Cache{ cache } {
+    if (threadCount == 0) {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    for (uint32_t i = 0; i < threadCount; i++) {
+        m_Workers.emplace_back(&PipelineBuildService::workerLoop, this);
+    }
+}
+
+PipelineBuildService::~PipelineBuildService() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_JobAvailable.notify_all();
+
+    for (auto& worker : m_Workers) {
+        worker.join();
+    }
+}
+
+void PipelineBuildService::workerLoop() {
+    Trace::setThreadName("Pipeline Build Worker");
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_JobAvailable.wait(lock, [this] { return m_Stopping || !m_Jobs.empty(); });
+
+            // drain the queue before stopping so no future is left without a value
+            if (m_Jobs.empty()) {
+                return;
+            }
+
+            job = std::move(m_Jobs.front());
+            m_Jobs.pop_front();
+            m_Running++;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Running--;
+            if (m_Running == 0 && m_Jobs.empty()) {
+                m_Idle.notify_all();
+            }
+        }
+    }
+}
+
+std::future<void> PipelineBuildService::enqueue(std::function<void()> job) {
+    auto task = std::make_shared<std::packaged_task<void()>>(std::move(job));
+    std::future<void> result = task->get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Jobs.emplace_back([task] { (*task)(); });
+    }
+    m_JobAvailable.notify_one();
+    return result;
+}
+
+std::shared_future<VkPipeline> PipelineBuildService::submit(GraphicsPipelineDesc desc) {
+    auto task = std::make_shared<std::packaged_task<VkPipeline()>>([this, desc = std::move(desc)] {
+        return buildGraphicsPipeline(m_Device, m_Cache, desc);
+    });
+    std::shared_future<VkPipeline> result = task->get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Jobs.emplace_back([task] { (*task)(); });
+    }
+    m_JobAvailable.notify_one();
+    return result;
+}
+
+std::vector<std::shared_future<VkPipeline>> PipelineBuildService::submit(std::vector<GraphicsPipelineDesc> batch) {
+    std::vector<std::shared_future<VkPipeline>> results;
+    results.reserve(batch.size());
+
+    for (auto& desc : batch) {
+        results.push_back(submit(std::move(desc)));
+    }
+
+    return results;
+}
+
+void PipelineBuildService::waitIdle() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Idle.wait(lock, [this] { return m_Running == 0 && m_Jobs.empty(); });
+}
+
+uint32_t PipelineBuildService::getThreadCount() {
+    return static_cast<uint32_t>(m_Workers.size());
+}
+
+VkPipeline PipelineBuildService::readyOr(const std::shared_future<VkPipeline>& pipeline, VkPipeline fallback) {
+    if (pipeline.valid() && pipeline.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        return pipeline.get();
+    }
+    return fallback;
+}
+
+void benchmarkPipelineBuilds(VkDevice device, const std::vector<GraphicsPipelineDesc>& batch, uint32_t maxThreads) {
+    Log::info("Pipeline Build Benchmark ({} pipelines, 1..{} threads)", batch.size(), maxThreads);
+
+    for (uint32_t threads = 1; threads <= maxThreads; threads++) {
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+        VkPipelineCache cache;
+        if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create benchmark pipeline cache!");
+        }
+
+        std::vector<VkPipeline> pipelines;
+        std::exception_ptr failure;
+        auto start = std::chrono::steady_clock::now();
+        {
+            PipelineBuildService service(device, cache, threads);
+            // every build is waited for even after one fails, so all that succeeded can be destroyed below
+            for (auto& future : service.submit(batch)) {
+                try {
+                    pipelines.push_back(future.get());
+                }
+                catch (...) {
+                    if (!failure) {
+                        failure = std::current_exception();
+                    }
+                }
+            }
+        }
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        for (VkPipeline pipeline : pipelines) {
+            vkDestroyPipeline(device, pipeline, nullptr);
+        }
+        vkDestroyPipelineCache(device, cache, nullptr);
+
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+        Log::info("\t{} thread(s): {} ms ({} ms/pipeline)", threads, elapsed, elapsed / batch.size());
+    }
+
+    Log::info("Note: drivers with their own on-disk shader cache may still serve later runs from it");
+}
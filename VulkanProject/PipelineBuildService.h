@@ -0,0 +1,58 @@
+#pragma once
+
+#include "GraphicsPipeline.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Compiles batches of graphics pipelines on a pool of worker threads.
+// All workers create through the same VkPipelineCache, so whatever one thread compiles is a cache hit for the rest.
+// Results come back as futures; callers keep rendering with a fallback pipeline until readyOr() says otherwise.
+class PipelineBuildService
+{
+private:
+
+    VkDevice m_Device;
+    VkPipelineCache m_Cache;
+
+    std::vector<std::thread> m_Workers;
+    std::deque<std::function<void()>> m_Jobs;
+    std::mutex m_Mutex;
+    std::condition_variable m_JobAvailable;
+    std::condition_variable m_Idle;
+    size_t m_Running = 0;
+    bool m_Stopping = false;
+
+    void workerLoop();
+
+public:
+
+    // threadCount == 0 picks one worker per hardware thread, minus the render thread
+    PipelineBuildService(VkDevice device, VkPipelineCache cache, uint32_t threadCount = 0);
+    ~PipelineBuildService();
+
+    PipelineBuildService(const PipelineBuildService&) = delete;
+    PipelineBuildService& operator=(const PipelineBuildService&) = delete;
+
+    std::shared_future<VkPipeline> submit(GraphicsPipelineDesc desc);
+    std::vector<std::shared_future<VkPipeline>> submit(std::vector<GraphicsPipelineDesc> batch);
+
+    // Runs an arbitrary job on the build threads, e.g. shader loading that has to happen before a pipeline build
+    std::future<void> enqueue(std::function<void()> job);
+
+    // Blocks until every queued job has finished
+    void waitIdle();
+
+    uint32_t getThreadCount();
+
+    static VkPipeline readyOr(const std::shared_future<VkPipeline>& pipeline, VkPipeline fallback);
+};
+
+// Compiles batch once per thread count from 1 to maxThreads, each time into a fresh, empty pipeline cache so no run
+// benefits from an earlier one, and prints the wall time of each run. Pipelines are destroyed after each run.
+void benchmarkPipelineBuilds(VkDevice device, const std::vector<GraphicsPipelineDesc>& batch, uint32_t maxThreads);
@@ -0,0 +1,136 @@
+#include "PipelineCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "Log.h"
+#include "Trace.h"
+
+PipelineCache::PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, std::string path) : m_Device{ device }, m_Path{ path } {
+    TRACE_SCOPE("PipelineCache::PipelineCache", "init");
+    vkGetPhysicalDeviceProperties(physicalDevice, &m_DeviceProperties);
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<char> data = readCacheFile();
+    if (!data.empty() && !validateHeader(data)) {
+        data.clear();
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(m_Device, &createInfo, nullptr, &m_Cache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+    m_Warm = !data.empty();
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    Log::info("Created Pipeline Cache {path: \"{}\", state: {}, size: {} bytes, {} ms}", m_Path, (m_Warm ? "warm" : "cold"), data.size(), elapsed);
+}
+
+std::vector<char> PipelineCache::readCacheFile() {
+    std::ifstream file(m_Path, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open()) {
+        Log::info("No Pipeline Cache At \"{}\"", m_Path);
+        return {};
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+
+    if (!file) {
+        Log::warn("Failed To Read Pipeline Cache \"{}\"", m_Path);
+        return {};
+    }
+
+    return buffer;
+}
+
+bool PipelineCache::validateHeader(const std::vector<char>& data) {
+    PipelineCacheHeader header{};
+
+    if (data.size() < sizeof(header)) {
+        Log::info("Pipeline Cache Rejected: truncated header");
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (header.headerSize < sizeof(header) || header.headerSize > data.size()) {
+        Log::info("Pipeline Cache Rejected: bad header size {}", header.headerSize);
+        return false;
+    }
+    if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+        Log::info("Pipeline Cache Rejected: unknown header version {}", header.headerVersion);
+        return false;
+    }
+    if (header.vendorID != m_DeviceProperties.vendorID || header.deviceID != m_DeviceProperties.deviceID) {
+        Log::info("Pipeline Cache Rejected: written by device {}:{}", header.vendorID, header.deviceID);
+        return false;
+    }
+    if (std::memcmp(header.pipelineCacheUUID, m_DeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        Log::info("Pipeline Cache Rejected: pipelineCacheUUID mismatch (driver changed)");
+        return false;
+    }
+
+    return true;
+}
+
+bool PipelineCache::isWarm() {
+    return m_Warm;
+}
+
+VkPipelineCache PipelineCache::getInternalCache() {
+    return m_Cache;
+}
+
+void PipelineCache::save() {
+    TRACE_SCOPE("PipelineCache::save", "cleanup");
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(m_Device, m_Cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+        Log::debug("Pipeline Cache Empty, Not Saving");
+        return;
+    }
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(m_Device, m_Cache, &dataSize, data.data()) != VK_SUCCESS) {
+        Log::warn("Failed To Get Pipeline Cache Data");
+        return;
+    }
+
+    std::string tempPath = m_Path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), dataSize);
+        file.flush();
+
+        if (!file) {
+            Log::warn("Failed To Write Pipeline Cache \"{}\"", tempPath);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, m_Path, ec);
+    if (ec) {
+        Log::warn("Failed To Replace Pipeline Cache \"{}\": {}", m_Path, ec.message());
+        std::filesystem::remove(tempPath, ec);
+        return;
+    }
+
+    Log::info("Saved Pipeline Cache {path: \"{}\", size: {} bytes}", m_Path, dataSize);
+}
+
+void PipelineCache::destroy() {
+    vkDestroyPipelineCache(m_Device, m_Cache, nullptr);
+    m_Cache = VK_NULL_HANDLE;
+}
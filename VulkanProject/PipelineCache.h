@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef GLFW_INCLUDE_VULKAN
+#define GLFW_INCLUDE_VULKAN
+#endif
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+// Layout of the header every driver writes at the start of vkGetPipelineCacheData (VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+struct PipelineCacheHeader {
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+// A VkPipelineCache that is seeded from disk and written back on shutdown.
+// Data written by a different GPU or driver build is rejected up front instead of being handed to the driver.
+class PipelineCache
+{
+private:
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties m_DeviceProperties{};
+    std::string m_Path;
+
+    VkPipelineCache m_Cache = VK_NULL_HANDLE;
+    bool m_Warm = false;
+
+    std::vector<char> readCacheFile();
+    bool validateHeader(const std::vector<char>& data);
+
+public:
+
+    PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, std::string path);
+
+    // true if the cache was seeded with data from a previous run
+    bool isWarm();
+
+    VkPipelineCache getInternalCache();
+
+    // Writes the cache to a temporary file and renames it over the old one so a crash never leaves a torn file
+    void save();
+    void destroy();
+};
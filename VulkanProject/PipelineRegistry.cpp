@@ -0,0 +1,323 @@
+#include "PipelineRegistry.h"
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+#include "Log.h"
+
+// Appends fields one at a time (never whole structs, whose padding bytes are indeterminate) to build a key
+// that is both hashed and compared for equality by the maps.
+class KeyWriter {
+private:
+    std::string m_Bytes;
+
+public:
+    template <typename T>
+    KeyWriter& put(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "key fields must be plain values");
+        m_Bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        return *this;
+    }
+
+    KeyWriter& put(const std::string& value) {
+        put(static_cast<uint32_t>(value.size()));
+        m_Bytes.append(value);
+        return *this;
+    }
+
+    std::string take() {
+        return std::move(m_Bytes);
+    }
+};
+
+static bool buildFailed(const std::shared_future<VkPipeline>& pipeline) {
+    if (pipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return false;
+    }
+    try {
+        pipeline.get();
+        return false;
+    }
+    catch (const std::exception&) {
+        return true;
+    }
+}
+
+PipelineRegistry::PipelineRegistry(VkDevice device, VkPipelineCache cache) : m_Device{ device }, m_Cache{ cache } {
+}
+
+void PipelineRegistry::registerRenderPass(VkRenderPass renderPass, RenderPassCompatibility compatibility) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_RenderPasses[renderPass] = std::move(compatibility);
+}
+
+void PipelineRegistry::registerShaderModule(VkShaderModule module, const uint32_t* code, size_t codeSize) {
+    // the whole module goes into the key, so two modules only share pipelines if their SPIR-V is identical
+    std::string bytes(reinterpret_cast<const char*>(code), codeSize);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_ShaderCode[module] = std::move(bytes);
+}
+
+std::string PipelineRegistry::makeKey(const DescriptorSetLayoutDesc& desc) {
+    KeyWriter key;
+    key.put(static_cast<uint32_t>(desc.bindings.size()));
+    for (const auto& binding : desc.bindings) {
+        if (binding.pImmutableSamplers != nullptr) {
+            throw std::runtime_error("immutable samplers are not supported by the pipeline registry!");
+        }
+        key.put(binding.binding).put(binding.descriptorType).put(binding.descriptorCount).put(binding.stageFlags);
+    }
+    return key.take();
+}
+
+std::string PipelineRegistry::makeKey(const PipelineLayoutDesc& desc) {
+    KeyWriter key;
+    key.put(static_cast<uint32_t>(desc.setLayouts.size()));
+    for (VkDescriptorSetLayout setLayout : desc.setLayouts) {
+        // set layouts come from this registry, so equal handles already mean equal state
+        key.put(setLayout);
+    }
+    key.put(static_cast<uint32_t>(desc.pushConstantRanges.size()));
+    for (const auto& range : desc.pushConstantRanges) {
+        key.put(range.stageFlags).put(range.offset).put(range.size);
+    }
+    return key.take();
+}
+
+// Called with m_Mutex held
+std::string PipelineRegistry::makeKey(const GraphicsPipelineDesc& desc) {
+    KeyWriter key;
+
+    for (VkShaderModule module : { desc.vertexShader, desc.fragmentShader }) {
+        auto found = m_ShaderCode.find(module);
+        if (found == m_ShaderCode.end()) {
+            throw std::runtime_error("pipeline \"" + desc.name + "\" uses a shader module that was not registered!");
+        }
+        key.put(found->second);
+    }
+    key.put(desc.vertexEntryPoint).put(desc.fragmentEntryPoint);
+
+    for (const auto* constants : { &desc.vertexConstants, &desc.fragmentConstants }) {
+        key.put(static_cast<uint32_t>(constants->size()));
+        for (const auto& constant : *constants) {
+            key.put(constant.id).put(constant.value);
+        }
+    }
+
+    key.put(static_cast<uint32_t>(desc.vertexBindings.size()));
+    for (const auto& binding : desc.vertexBindings) {
+        key.put(binding.binding).put(binding.stride).put(binding.inputRate);
+    }
+    key.put(static_cast<uint32_t>(desc.vertexAttributes.size()));
+    for (const auto& attribute : desc.vertexAttributes) {
+        key.put(attribute.location).put(attribute.binding).put(attribute.format).put(attribute.offset);
+    }
+
+    key.put(desc.topology);
+    key.put(desc.polygonMode).put(desc.cullMode).put(desc.frontFace).put(desc.lineWidth);
+    key.put(desc.samples);
+
+    const auto& blend = desc.colorBlend;
+    key.put(blend.blendEnable).put(blend.srcColorBlendFactor).put(blend.dstColorBlendFactor).put(blend.colorBlendOp);
+    key.put(blend.srcAlphaBlendFactor).put(blend.dstAlphaBlendFactor).put(blend.alphaBlendOp).put(blend.colorWriteMask);
+
+    key.put(static_cast<uint32_t>(desc.dynamicStates.size()));
+    for (VkDynamicState state : desc.dynamicStates) {
+        key.put(state);
+    }
+
+    // layouts come from this registry, so the handle identifies the state
+    key.put(desc.layout);
+
+    auto renderPass = m_RenderPasses.find(desc.renderPass);
+    if (renderPass == m_RenderPasses.end()) {
+        throw std::runtime_error("pipeline \"" + desc.name + "\" uses a render pass that was not registered!");
+    }
+    const RenderPassCompatibility& compatibility = renderPass->second;
+    key.put(static_cast<uint32_t>(compatibility.colorFormats.size()));
+    for (VkFormat format : compatibility.colorFormats) {
+        key.put(format);
+    }
+    key.put(compatibility.samples).put(compatibility.subpassCount).put(desc.subpass);
+
+    return key.take();
+}
+
+VkDescriptorSetLayout PipelineRegistry::getDescriptorSetLayout(const DescriptorSetLayoutDesc& desc) {
+    std::string key = makeKey(desc);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto found = m_DescriptorSetLayouts.find(key);
+    if (found != m_DescriptorSetLayouts.end()) {
+        m_Stats.descriptorSetLayouts.hits++;
+        return found->second;
+    }
+    m_Stats.descriptorSetLayouts.misses++;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(desc.bindings.size());
+    layoutInfo.pBindings = desc.bindings.data();
+
+    VkDescriptorSetLayout setLayout;
+    if (vkCreateDescriptorSetLayout(m_Device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+
+    m_DescriptorSetLayouts.emplace(std::move(key), setLayout);
+    return setLayout;
+}
+
+VkPipelineLayout PipelineRegistry::getPipelineLayout(const PipelineLayoutDesc& desc) {
+    std::string key = makeKey(desc);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto found = m_PipelineLayouts.find(key);
+    if (found != m_PipelineLayouts.end()) {
+        m_Stats.pipelineLayouts.hits++;
+        return found->second;
+    }
+    m_Stats.pipelineLayouts.misses++;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(desc.setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = desc.setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(desc.pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = desc.pushConstantRanges.data();
+
+    VkPipelineLayout pipelineLayout;
+    if (vkCreatePipelineLayout(m_Device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    m_PipelineLayouts.emplace(std::move(key), pipelineLayout);
+    return pipelineLayout;
+}
+
+// On a miss, inserts a pending entry and hands the caller the promise it now has to fulfil
+std::shared_future<VkPipeline> PipelineRegistry::findOrInsert(const GraphicsPipelineDesc& desc, std::shared_ptr<std::promise<VkPipeline>>& pending) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::string key = makeKey(desc);
+
+    auto found = m_Pipelines.find(key);
+    if (found != m_Pipelines.end()) {
+        if (!buildFailed(found->second.pipeline)) {
+            m_Stats.pipelines.hits++;
+            return found->second.pipeline;
+        }
+        // the earlier build threw, try again rather than handing out its exception forever
+        m_Pipelines.erase(found);
+    }
+    m_Stats.pipelines.misses++;
+
+    pending = std::make_shared<std::promise<VkPipeline>>();
+    std::shared_future<VkPipeline> pipeline = pending->get_future().share();
+    m_Pipelines.emplace(std::move(key), RegistryPipeline{ pipeline, desc.vertexShader, desc.fragmentShader });
+    return pipeline;
+}
+
+void PipelineRegistry::build(const GraphicsPipelineDesc& desc, std::promise<VkPipeline>& pending) {
+    try {
+        pending.set_value(buildGraphicsPipeline(m_Device, m_Cache, desc));
+    }
+    catch (...) {
+        pending.set_exception(std::current_exception());
+    }
+}
+
+VkPipeline PipelineRegistry::getPipeline(const GraphicsPipelineDesc& desc) {
+    std::shared_ptr<std::promise<VkPipeline>> pending;
+    std::shared_future<VkPipeline> pipeline = findOrInsert(desc, pending);
+
+    if (pending) {
+        build(desc, *pending);
+    }
+
+    return pipeline.get();
+}
+
+std::shared_future<VkPipeline> PipelineRegistry::requestPipeline(const GraphicsPipelineDesc& desc, PipelineBuildService& service) {
+    std::shared_ptr<std::promise<VkPipeline>> pending;
+    std::shared_future<VkPipeline> pipeline = findOrInsert(desc, pending);
+
+    if (pending) {
+        service.enqueue([this, desc, pending] { build(desc, *pending); });
+    }
+
+    return pipeline;
+}
+
+std::vector<VkPipeline> PipelineRegistry::evictShaderModule(VkShaderModule module) {
+    std::vector<std::shared_future<VkPipeline>> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (auto entry = m_Pipelines.begin(); entry != m_Pipelines.end();) {
+            if (entry->second.vertexShader == module || entry->second.fragmentShader == module) {
+                evicted.push_back(entry->second.pipeline);
+                entry = m_Pipelines.erase(entry);
+            }
+            else {
+                ++entry;
+            }
+        }
+        m_ShaderCode.erase(module);
+    }
+
+    // wait outside the lock, builds in flight don't need it but other requests do
+    std::vector<VkPipeline> pipelines;
+    for (auto& pipeline : evicted) {
+        try {
+            pipelines.push_back(pipeline.get());
+        }
+        catch (const std::exception&) {
+            // the build failed, so there is nothing to hand back
+        }
+    }
+    return pipelines;
+}
+
+RegistryStats PipelineRegistry::getStats() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+void PipelineRegistry::printStats() {
+    RegistryStats stats = getStats();
+    Log::debug("Pipeline Registry:");
+    Log::debug("\tDescriptor Set Layouts: {} hits, {} misses", stats.descriptorSetLayouts.hits, stats.descriptorSetLayouts.misses);
+    Log::debug("\tPipeline Layouts: {} hits, {} misses", stats.pipelineLayouts.hits, stats.pipelineLayouts.misses);
+    Log::debug("\tPipelines: {} hits, {} misses", stats.pipelines.hits, stats.pipelines.misses);
+}
+
+void PipelineRegistry::destroy() {
+    std::unordered_map<std::string, RegistryPipeline> pipelines;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        pipelines.swap(m_Pipelines);
+    }
+
+    // wait outside the lock, as evictShaderModule does, so nothing else queues up behind a build in flight
+    for (auto& entry : pipelines) {
+        try {
+            vkDestroyPipeline(m_Device, entry.second.pipeline.get(), nullptr);
+        }
+        catch (const std::exception&) {
+            // the build failed, so there is nothing to destroy
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    for (auto& entry : m_PipelineLayouts) {
+        vkDestroyPipelineLayout(m_Device, entry.second, nullptr);
+    }
+    m_PipelineLayouts.clear();
+
+    for (auto& entry : m_DescriptorSetLayouts) {
+        vkDestroyDescriptorSetLayout(m_Device, entry.second, nullptr);
+    }
+    m_DescriptorSetLayouts.clear();
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "GraphicsPipeline.h"
+#include "PipelineBuildService.h"
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct DescriptorSetLayoutDesc {
+    // pImmutableSamplers is not supported and must be null
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+};
+
+struct PipelineLayoutDesc {
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    std::vector<VkPushConstantRange> pushConstantRanges;
+};
+
+// The parts of a render pass that decide whether a pipeline built against it can be used with another one
+struct RenderPassCompatibility {
+    std::vector<VkFormat> colorFormats;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    uint32_t subpassCount = 1;
+};
+
+struct RegistryCounter {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+// A pipeline that is built or being built, plus the modules it was built from so it can be evicted with them
+struct RegistryPipeline {
+    std::shared_future<VkPipeline> pipeline;
+    VkShaderModule vertexShader;
+    VkShaderModule fragmentShader;
+};
+
+struct RegistryStats {
+    RegistryCounter descriptorSetLayouts;
+    RegistryCounter pipelineLayouts;
+    RegistryCounter pipelines;
+};
+
+// Hands out descriptor set layouts, pipeline layouts and graphics pipelines, creating each distinct one only once.
+// Requests are keyed on their full creation state; render passes are keyed on compatibility and shader modules on
+// their SPIR-V, so equal state from different callers (or from recreated passes and modules) maps to one driver object.
+// A failed build is forgotten once it is requested again, so it can be retried (e.g. after a shader reload).
+// The registry owns everything it returns; callers must not destroy those handles.
+class PipelineRegistry
+{
+private:
+
+    VkDevice m_Device;
+    VkPipelineCache m_Cache;
+
+    std::mutex m_Mutex;
+    std::unordered_map<std::string, VkDescriptorSetLayout> m_DescriptorSetLayouts;
+    std::unordered_map<std::string, VkPipelineLayout> m_PipelineLayouts;
+    std::unordered_map<std::string, RegistryPipeline> m_Pipelines;
+
+    std::unordered_map<VkRenderPass, RenderPassCompatibility> m_RenderPasses;
+    std::unordered_map<VkShaderModule, std::string> m_ShaderCode;
+
+    RegistryStats m_Stats;
+
+    std::string makeKey(const DescriptorSetLayoutDesc& desc);
+    std::string makeKey(const PipelineLayoutDesc& desc);
+    std::string makeKey(const GraphicsPipelineDesc& desc);
+
+    std::shared_future<VkPipeline> findOrInsert(const GraphicsPipelineDesc& desc, std::shared_ptr<std::promise<VkPipeline>>& pending);
+    void build(const GraphicsPipelineDesc& desc, std::promise<VkPipeline>& pending);
+
+public:
+
+    PipelineRegistry(VkDevice device, VkPipelineCache cache);
+
+    // Render passes and shader modules must be registered before pipelines that use them are requested.
+    // Re-registering a handle (e.g. after the driver reused it) replaces the old entry.
+    void registerRenderPass(VkRenderPass renderPass, RenderPassCompatibility compatibility);
+    void registerShaderModule(VkShaderModule module, const uint32_t* code, size_t codeSize);
+
+    VkDescriptorSetLayout getDescriptorSetLayout(const DescriptorSetLayoutDesc& desc);
+    VkPipelineLayout getPipelineLayout(const PipelineLayoutDesc& desc);
+
+    // Builds on the calling thread on a miss
+    VkPipeline getPipeline(const GraphicsPipelineDesc& desc);
+    // Builds on the service's worker threads on a miss; concurrent requests for the same state share one build
+    std::shared_future<VkPipeline> requestPipeline(const GraphicsPipelineDesc& desc, PipelineBuildService& service);
+
+    // Forgets module and every pipeline built from it, waiting for builds of those still in flight. Ownership of the
+    // returned pipelines passes to the caller, who has to keep them alive until the GPU is done with them.
+    std::vector<VkPipeline> evictShaderModule(VkShaderModule module);
+
+    RegistryStats getStats();
+    void printStats();
+
+    // Waits for outstanding builds, then destroys every object the registry handed out
+    void destroy();
+};
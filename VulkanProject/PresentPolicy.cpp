@@ -0,0 +1,132 @@
+#include "PresentPolicy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <initializer_list>
+
+#include "Log.h"
+#include "Statistics.h"
+
+const char* presentPolicyName(PresentPolicy policy) {
+    switch (policy) {
+    case PresentPolicy::LowLatency:
+        return "low-latency";
+    case PresentPolicy::Balanced:
+        return "balanced";
+    case PresentPolicy::PowerSaving:
+        return "power-saving";
+    }
+    return "unknown";
+}
+
+static const char* presentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "fifo relaxed";
+    default:
+        return "other";
+    }
+}
+
+// the first of preferred the surface supports; FIFO is always supported
+static VkPresentModeKHR pickPresentMode(const std::vector<VkPresentModeKHR>& available, std::initializer_list<VkPresentModeKHR> preferred) {
+    for (VkPresentModeKHR mode : preferred) {
+        if (std::find(available.begin(), available.end(), mode) != available.end()) {
+            return mode;
+        }
+    }
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+PresentSettings choosePresentSettings(PresentPolicy policy, const VkSurfaceCapabilitiesKHR& capabilities, const std::vector<VkPresentModeKHR>& presentModes, uint32_t maxFramesInFlight) {
+    PresentSettings settings;
+    switch (policy) {
+    case PresentPolicy::LowLatency:
+        settings.presentMode = pickPresentMode(presentModes, { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR });
+        // mailbox needs a spare image to replace without blocking
+        settings.imageCount = capabilities.minImageCount + 1;
+        settings.framesInFlight = 1;
+        settings.presentLag = 1;
+        break;
+    case PresentPolicy::Balanced:
+        settings.presentMode = pickPresentMode(presentModes, { VK_PRESENT_MODE_MAILBOX_KHR });
+        settings.imageCount = capabilities.minImageCount + 1;
+        settings.framesInFlight = 2;
+        settings.presentLag = 0;
+        break;
+    case PresentPolicy::PowerSaving:
+        settings.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        settings.imageCount = std::max(capabilities.minImageCount, 2u);
+        settings.framesInFlight = 1;
+        settings.presentLag = 1;
+        break;
+    }
+
+    if (capabilities.maxImageCount > 0 && settings.imageCount > capabilities.maxImageCount) {
+        settings.imageCount = capabilities.maxImageCount;
+    }
+    settings.framesInFlight = std::min(settings.framesInFlight, maxFramesInFlight);
+
+    Log::debug("Present Policy {}: {} present mode, {} images, {} frames in flight, present lag {}", presentPolicyName(policy), presentModeName(settings.presentMode), settings.imageCount, settings.framesInFlight, settings.presentLag);
+    return settings;
+}
+
+PresentTiming::PresentTiming() {
+    m_Intervals.reserve(PRESENT_TIMING_HISTORY);
+}
+
+void PresentTiming::record() {
+    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    if (m_HasLast) {
+        double interval = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::duration(now - m_Last)).count();
+        if (m_Intervals.size() < PRESENT_TIMING_HISTORY) {
+            m_Intervals.push_back(interval);
+        }
+        else {
+            m_Intervals[m_Next] = interval;
+        }
+        m_Next = (m_Next + 1) % PRESENT_TIMING_HISTORY;
+        m_Total++;
+    }
+    m_Last = now;
+    m_HasLast = true;
+}
+
+void PresentTiming::restart() {
+    m_HasLast = false;
+}
+
+void PresentTiming::printStats(PresentPolicy policy, bool displayed) {
+    if (m_Intervals.empty()) {
+        return;
+    }
+
+    double sum = 0.0;
+    for (double interval : m_Intervals) {
+        sum += interval;
+    }
+    double average = sum / m_Intervals.size();
+
+    // jitter: how far intervals stray from the average, as standard deviation and 99th percentile
+    std::vector<double> deviations;
+    deviations.reserve(m_Intervals.size());
+    double squares = 0.0;
+    for (double interval : m_Intervals) {
+        deviations.push_back(std::abs(interval - average));
+        squares += (interval - average) * (interval - average);
+    }
+    std::sort(deviations.begin(), deviations.end());
+    double p99 = percentile(deviations, 0.99);
+    auto range = std::minmax_element(m_Intervals.begin(), m_Intervals.end());
+
+    Log::info("Present Timing ({} policy, {}, last {} of {} intervals):", presentPolicyName(policy), displayed ? "displayed" : "present calls", m_Intervals.size(), m_Total);
+    Log::info("\tInterval: {} ms avg, {} ms min, {} ms max", average, *range.first, *range.second);
+    Log::info("\tJitter: {} ms std dev, {} ms p99", std::sqrt(squares / m_Intervals.size()), p99);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#ifndef GLFW_INCLUDE_VULKAN
+#define GLFW_INCLUDE_VULKAN
+#endif
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+// What the swapchain and frame loop optimize for. Picks present mode, swapchain image count, frames in flight and
+// present pacing together, since each only helps in combination with the others.
+enum class PresentPolicy {
+    // Mailbox (else immediate, else FIFO), one frame in flight and, with VK_KHR_present_wait, the next frame only
+    // starts once the last one is on screen, so input is sampled as late as possible and nothing queues up
+    LowLatency,
+    // Mailbox if available else FIFO, one image above the minimum, two frames in flight, no pacing
+    Balanced,
+    // FIFO with the fewest images the surface allows and one frame in flight, paced to presentation, so nothing is
+    // rendered that won't be shown and the GPU idles between vblanks
+    PowerSaving
+};
+
+const char* presentPolicyName(PresentPolicy policy);
+
+struct PresentSettings {
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    uint32_t imageCount = 0;
+    uint32_t framesInFlight = 2;
+    // with VK_KHR_present_wait, a frame's CPU work only starts once the frame this many presents back is displayed;
+    // 0 never waits
+    uint32_t presentLag = 0;
+};
+
+// maxFramesInFlight caps framesInFlight (the size of the per-frame arrays)
+PresentSettings choosePresentSettings(PresentPolicy policy, const VkSurfaceCapabilitiesKHR& capabilities, const std::vector<VkPresentModeKHR>& presentModes, uint32_t maxFramesInFlight);
+
+const size_t PRESENT_TIMING_HISTORY = 600;
+
+// Present-to-present intervals of one swapchain over the last PRESENT_TIMING_HISTORY frames, for the jitter report.
+// Each interval ends when a frame was displayed (vkWaitForPresentKHR returned) when pacing, or when it was handed
+// to vkQueuePresentKHR otherwise.
+class PresentTiming
+{
+private:
+
+    std::vector<double> m_Intervals;
+    size_t m_Next = 0;
+    uint64_t m_Total = 0;
+    int64_t m_Last = 0;
+    bool m_HasLast = false;
+
+public:
+
+    PresentTiming();
+
+    void record();
+    // The next interval would span a swapchain rebuild or a skipped frame, so it isn't counted
+    void restart();
+
+    void printStats(PresentPolicy policy, bool displayed);
+};
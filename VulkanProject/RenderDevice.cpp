@@ -0,0 +1,784 @@
+#include "RenderDevice.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+#include "Log.h"
+#include "Trace.h"
+
+#ifdef NDEBUG
+const bool enableValidationLayers = false;
+#else
+const bool enableValidationLayers = true;
+#endif
+const char* PIPELINE_CACHE_PATH = "pipeline.cache";
+
+static const std::vector<const char*> VALIDATION_LAYERS = {
+    "VK_LAYER_KHRONOS_validation"
+};
+
+
+// Proxy Functions
+VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
+    auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
+    if (func != nullptr) {
+        return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
+    }
+    else {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+}
+
+void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator) {
+    auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
+    if (func != nullptr) {
+        func(instance, debugMessenger, pAllocator);
+    }
+}
+
+// Called from inside the driver, possibly on several threads; only hands the message to the log writer
+static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData) {
+    LogLevel level = LogLevel::Debug;
+    if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+        level = LogLevel::Error;
+    }
+    else if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+        level = LogLevel::Warn;
+    }
+    else if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) {
+        level = LogLevel::Info;
+    }
+
+    Log::write(level, "Validation Layer: {}", pCallbackData->pMessage);
+    return VK_FALSE;
+}
+
+SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface) {
+    SwapChainSupportDetails details;
+
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+
+    uint32_t formatCount;
+    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
+
+    if (formatCount != 0) {
+        details.formats.resize(formatCount);
+        vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
+    }
+
+    uint32_t presentModeCount;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
+
+    if (presentModeCount != 0) {
+        details.presentModes.resize(presentModeCount);
+        vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
+    }
+
+    return details;
+}
+
+RenderDevice::RenderDevice(bool headless, bool pipelineStatistics) : m_Headless{ headless }, m_RequestPipelineStatistics{ pipelineStatistics } {
+    if (!m_Headless) {
+        m_DeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
+    createInstance();
+    setupDebugMessenger();
+}
+
+void RenderDevice::initialize(VkSurfaceKHR surface) {
+    std::lock_guard<std::mutex> lock(m_InitMutex);
+    if (m_Device != VK_NULL_HANDLE) {
+        if (surface != VK_NULL_HANDLE) {
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(m_PhysicalDevice, m_QueueFamilies.presentFamily.value(), surface, &presentSupport);
+            if (!presentSupport) {
+                throw std::runtime_error("the shared device's present queue can't present to this surface!");
+            }
+        }
+        return;
+    }
+
+    pickPhysicalDevice(surface);
+    m_QueueFamilies = findQueueFamilies(m_PhysicalDevice, surface);
+    createLogicalDevice();
+
+    TRACE_SCOPE("createPipelineCache", "init");
+    m_PipelineCache = std::make_unique<PipelineCache>(m_Device, m_PhysicalDevice, PIPELINE_CACHE_PATH);
+    m_PipelineBuildService = std::make_unique<PipelineBuildService>(m_Device, m_PipelineCache->getInternalCache());
+    Log::info("Created Pipeline Build Service ({} threads)", m_PipelineBuildService->getThreadCount());
+}
+
+void RenderDevice::destroy() {
+    if (m_Instance == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (m_Device != VK_NULL_HANDLE) {
+        m_PipelineBuildService.reset();
+        Log::debug("Stopped Pipeline Build Service");
+
+        m_PipelineCache->save();
+        m_PipelineCache->destroy();
+        m_PipelineCache.reset();
+        Log::debug("Destroyed Pipeline Cache");
+
+        for (const auto& allocation : m_Allocations) {
+            Log::warn("Device Memory Leaked By Session {} ({} bytes)", allocation.second.first, allocation.second.second);
+        }
+
+        vkDestroyDevice(m_Device, nullptr);
+        m_Device = VK_NULL_HANDLE;
+        Log::debug("Destroyed Logical Device");
+    }
+
+    if (enableValidationLayers) {
+        DestroyDebugUtilsMessengerEXT(m_Instance, m_DebugMessenger, nullptr);
+        Log::debug("Destroyed Debug Messenger");
+    }
+
+    vkDestroyInstance(m_Instance, nullptr);
+    m_Instance = VK_NULL_HANDLE;
+    Log::debug("Destroyed Instance");
+}
+
+// Instance
+
+std::vector<const char*> RenderDevice::getRequiredExtensions() {
+    std::vector<const char*> extensions;
+
+    // without a surface there is nothing for GLFW to ask for (and GLFW isn't initialized)
+    if (!m_Headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
+
+    if (enableValidationLayers) {
+        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    }
+
+    return extensions;
+}
+
+void RenderDevice::createInstance() {
+    TRACE_SCOPE("createInstance", "init");
+    Log::debug("Creating Instance");
+
+    if (enableValidationLayers && !checkValidationLayerSupport()) {
+        throw std::runtime_error("validation layers requested, but not available!");
+    }
+
+    if (enableValidationLayers) {
+        Log::info("Validation Layers: Enabled");
+    }
+    else if (checkValidationLayerSupport()) {
+        Log::info("Validation Layers: Disabled (available)");
+    }
+    else {
+        Log::info("Validation Layers: Disabled");
+    }
+
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "1001 ways to fail at making a Triangle";
+    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.pEngineName = "KAT Engine";
+    appInfo.engineVersion = VK_MAKE_VERSION(1, 6, 9);
+    appInfo.apiVersion = VK_API_VERSION_1_2;
+
+    Log::trace("AppInfo:");
+    Log::trace("\tApplication Name: \"{}\"", appInfo.pApplicationName);
+    Log::trace("\tApplication Version: 1.0.0");
+    Log::trace("\tEngine Name: \"{}\"", appInfo.pEngineName);
+    Log::trace("\tEngine Version: 1.6.9");
+    Log::trace("\tVulkan API Version: 1.2");
+
+
+    VkInstanceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &appInfo;
+
+    auto extensions = getRequiredExtensions();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
+
+    if (enableValidationLayers) {
+        createInfo.enabledLayerCount = static_cast<uint32_t>(VALIDATION_LAYERS.size());
+        createInfo.ppEnabledLayerNames = VALIDATION_LAYERS.data();
+        Log::trace("Validation Layers ({}):", VALIDATION_LAYERS.size());
+        for (std::string name : VALIDATION_LAYERS) {
+            Log::trace("\t{}", name);
+        }
+    }
+    else {
+        createInfo.enabledLayerCount = 0;
+        Log::debug("Validation Layers Disabled. Not enabling any layers.");
+    }
+
+    uint32_t extensionCount = 0;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensionsav(extensionCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensionsav.data());
+    Log::trace("Available Instance Extensions ({}):", extensionsav.size());
+
+    for (const auto& extension : extensionsav) {
+        Log::trace("\t{}", extension.extensionName);
+    }
+
+
+    if (vkCreateInstance(&createInfo, nullptr, &m_Instance) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create instance!");
+    }
+    Log::info("Created Instance");
+}
+
+// Validation Layers
+
+void RenderDevice::setupDebugMessenger() {
+    TRACE_SCOPE("setupDebugMessenger", "init");
+    if (!enableValidationLayers) return;
+    Log::debug("Setting Up Debug Messenger");
+
+    VkDebugUtilsMessengerCreateInfoEXT createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+    createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+    createInfo.pfnUserCallback = debugCallback;
+    createInfo.pUserData = nullptr; // Optional
+
+    Log::trace("Debug Messenger:");
+    Log::trace("\tSeverity: Warning + Error");
+    Log::trace("\tTypes: General, Validation, Performance");
+
+    if (CreateDebugUtilsMessengerEXT(m_Instance, &createInfo, nullptr, &m_DebugMessenger) != VK_SUCCESS) {
+        throw std::runtime_error("failed to set up debug messenger!");
+    }
+    Log::debug("Created Debug Messenger");
+}
+
+bool RenderDevice::checkValidationLayerSupport() {
+    uint32_t layerCount;
+    vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+    Log::trace("Available Instance Layers ({}):", layerCount);
+
+    std::vector<VkLayerProperties> availableLayers(layerCount);
+    vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+
+    for (VkLayerProperties prop : availableLayers) {
+        Log::trace("\t{}:", prop.layerName);
+        Log::trace("\t\tSpecification Version: {}", prop.specVersion);
+        Log::trace("\t\tImplementation Verison: {}", prop.implementationVersion);
+        Log::trace("\t\tDescription: {}", prop.description);
+    }
+
+
+    for (const char* layerName : VALIDATION_LAYERS) {
+        Log::trace("Checking For Layer: {}", layerName);
+        bool layerFound = false;
+
+        for (const auto& layerProperties : availableLayers) {
+            if (strcmp(layerName, layerProperties.layerName) == 0) {
+                Log::trace("Found Matching Layer ({})", layerName);
+                layerFound = true;
+                break;
+            }
+        }
+
+        if (!layerFound) {
+            Log::warn("Matching Layer Not Found ({})", layerName);
+            return false;
+        }
+    }
+    Log::debug("Validation isn't noita'd.");
+    return true;
+    // hmmmmmmmmmmmmmmmmmmm
+
+    Log::debug("how?");
+    return false;
+}
+
+
+
+// Physical Device
+
+void RenderDevice::pickPhysicalDevice(VkSurfaceKHR surface) {
+    TRACE_SCOPE("pickPhysicalDevice", "init");
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(m_Instance, &deviceCount, nullptr);
+
+    Log::info("Physical Devices With Vulkan Support: {}", deviceCount);
+
+    if (deviceCount == 0) {
+        throw std::runtime_error("failed to find GPUs with Vulkan support!");
+    }
+
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(m_Instance, &deviceCount, devices.data());
+
+    for (const auto& device : devices) {
+        if (isDeviceSuitable(device, surface)) {
+            Log::debug("Device {}: Suitable", device);
+            m_PhysicalDevice = device;
+            Log::info("Picking device {}", m_PhysicalDevice);
+            break;
+        }
+        else {
+            Log::debug("Device {}: Unsuitable", device);
+        }
+    }
+
+    if (m_PhysicalDevice == VK_NULL_HANDLE) {
+        throw std::runtime_error("failed to find a suitable GPU!");
+    }
+}
+
+bool RenderDevice::isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface) {
+    QueueFamilyIndices indices = findQueueFamilies(device, surface);
+
+    bool extensionsSupported = checkDeviceExtensionSupport(device);
+    if (extensionsSupported) {
+        Log::debug("Device Extensions Supported: true");
+    }
+    else {
+        Log::debug("Device Extensions Supported: false");
+    }
+
+    bool swapChainAdequate = m_Headless;
+    if (extensionsSupported && !m_Headless) {
+        SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device, surface);
+        swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+    }
+
+    if (swapChainAdequate) {
+        Log::debug("Swap Chain: Adequate");
+    }
+    else {
+        Log::debug("Swap Chain: Inadequate");
+    }
+
+    if (indices.isComplete()) {
+        Log::debug("Queue Family Indices: Complete");
+    }
+    else {
+        Log::debug("Queue Family Indices: Incomplete");
+    }
+
+    return indices.isComplete() && extensionsSupported && swapChainAdequate;
+}
+
+
+bool RenderDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    std::set<std::string> requiredExtensions(m_DeviceExtensions.begin(), m_DeviceExtensions.end());
+
+    for (const auto& extension : availableExtensions) {
+        requiredExtensions.erase(extension.extensionName);
+    }
+
+    if (!requiredExtensions.empty()) {
+        Log::trace("Unsupported Extensions ({}):", requiredExtensions.size());
+        for (std::string n : requiredExtensions) {
+            Log::trace("\t{}", n);
+        }
+    }
+
+    return requiredExtensions.empty();
+}
+
+bool RenderDevice::hasDeviceExtension(VkPhysicalDevice device, const char* name) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Logical Device
+void RenderDevice::printAvailableDeviceExtensions() {
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensionsav(extensionCount);
+    vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &extensionCount, extensionsav.data());
+    Log::trace("Available Device Extensions ({}):", extensionCount);
+
+    for (const auto& extension : extensionsav) {
+        Log::trace("\t{}", extension.extensionName);
+    }
+}
+
+
+void RenderDevice::createLogicalDevice() {
+    TRACE_SCOPE("createLogicalDevice", "init");
+    Log::debug("Creating Logical Device");
+
+    const QueueFamilyIndices& indices = m_QueueFamilies;
+    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(),indices.presentFamily.value() };
+    float queuePriority = 1.0f;
+    Log::debug("Unique Queue Families: {}", uniqueQueueFamilies.size());
+
+    for (uint32_t queueFamily : uniqueQueueFamilies) {
+        Log::trace("Creating Queue Family for Index {}", queueFamily);
+        Log::trace("\tQueue Priority: {}", queuePriority);
+
+        VkDeviceQueueCreateInfo queueCreateInfo{};
+        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo.queueFamilyIndex = queueFamily;
+        queueCreateInfo.queueCount = 1;
+        queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfos.push_back(queueCreateInfo);
+    }
+
+
+    VkPhysicalDeviceFeatures deviceFeatures{};
+    if (m_RequestPipelineStatistics) {
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+        deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+        if (!supportedFeatures.pipelineStatisticsQuery) {
+            Log::warn("Pipeline Statistics Queries Not Supported By This Device");
+        }
+    }
+    m_PipelineStatistics = deviceFeatures.pipelineStatisticsQuery == VK_TRUE;
+
+    // present pacing is optional: present_id tags each present, present_wait blocks until a tagged one is displayed
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.pNext = &presentWaitFeatures;
+    if (!m_Headless && hasDeviceExtension(m_PhysicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME) && hasDeviceExtension(m_PhysicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 supportedFeatures{};
+        supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedFeatures.pNext = &presentIdFeatures;
+        vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &supportedFeatures);
+        m_PresentWait = presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE;
+    }
+    if (m_PresentWait) {
+        m_DeviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        m_DeviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    }
+
+    VkDeviceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+
+
+    createInfo.pQueueCreateInfos = queueCreateInfos.data();
+    createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+
+    createInfo.pEnabledFeatures = &deviceFeatures;
+    // both features were read back as supported, so the same structs enable them
+    createInfo.pNext = m_PresentWait ? &presentIdFeatures : nullptr;
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(m_DeviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = m_DeviceExtensions.data();
+
+    Log::trace("Enabled Device Extensions ({}):", m_DeviceExtensions.size());
+    for (std::string n : m_DeviceExtensions) {
+        Log::trace("\t{}", n);
+
+    }
+
+    printAvailableDeviceExtensions();
+
+    if (enableValidationLayers) {
+        createInfo.enabledLayerCount = static_cast<uint32_t>(VALIDATION_LAYERS.size());
+        createInfo.ppEnabledLayerNames = VALIDATION_LAYERS.data();
+    }
+    else {
+        createInfo.enabledLayerCount = 0;
+    }
+
+    if (vkCreateDevice(m_PhysicalDevice, &createInfo, nullptr, &m_Device) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create logical device!");
+    }
+
+    vkGetDeviceQueue(m_Device, indices.graphicsFamily.value(), 0, &m_GraphicsQueue);
+    vkGetDeviceQueue(m_Device, indices.presentFamily.value(), 0, &m_PresentQueue);
+
+    if (m_PresentWait) {
+        m_WaitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(m_Device, "vkWaitForPresentKHR"));
+        m_PresentWait = m_WaitForPresent != nullptr;
+    }
+    Log::info("Present Wait: {}", m_PresentWait ? "Enabled" : "Not Supported");
+
+    Log::info("Logical Device Created");
+
+}
+
+// Queue Families
+
+QueueFamilyIndices RenderDevice::findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface) {
+    QueueFamilyIndices indices;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+    int i = 0;
+    for (const auto& queueFamily : queueFamilies) {
+        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            indices.graphicsFamily = i;
+        }
+
+        // Nothing is presented when headless; the graphics queue stands in for the present queue
+        if (m_Headless) {
+            indices.presentFamily = indices.graphicsFamily;
+        }
+        else {
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+
+            if (presentSupport) {
+                indices.presentFamily = i;
+            }
+        }
+
+        if (indices.isComplete()) {
+            break;
+        }
+
+        i++;
+    }
+
+    return indices;
+}
+
+
+
+// Accessors
+
+VkInstance RenderDevice::getInstance() {
+    return m_Instance;
+}
+
+VkPhysicalDevice RenderDevice::getPhysicalDevice() {
+    return m_PhysicalDevice;
+}
+
+VkDevice RenderDevice::getDevice() {
+    return m_Device;
+}
+
+VkQueue RenderDevice::getGraphicsQueue() {
+    return m_GraphicsQueue;
+}
+
+VkQueue RenderDevice::getPresentQueue() {
+    return m_PresentQueue;
+}
+
+const QueueFamilyIndices& RenderDevice::getQueueFamilies() {
+    return m_QueueFamilies;
+}
+
+bool RenderDevice::pipelineStatisticsEnabled() {
+    return m_PipelineStatistics;
+}
+
+bool RenderDevice::presentWaitEnabled() {
+    return m_PresentWait;
+}
+
+PipelineCache& RenderDevice::getPipelineCache() {
+    return *m_PipelineCache;
+}
+
+PipelineBuildService& RenderDevice::getPipelineBuildService() {
+    return *m_PipelineBuildService;
+}
+
+uint32_t RenderDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+// Sessions
+
+uint32_t RenderDevice::registerSession() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Session session;
+    // a late session starts level with the others instead of getting the queue to itself until it has caught up
+    if (!m_Sessions.empty()) {
+        uint64_t fewest = std::numeric_limits<uint64_t>::max();
+        for (const auto& other : m_Sessions) {
+            fewest = std::min(fewest, other.second.queue.submissions);
+        }
+        session.queue.submissions = fewest;
+    }
+
+    uint32_t id = m_NextSession++;
+    m_Sessions.emplace(id, session);
+    Log::debug("Registered Render Session {}", id);
+    return id;
+}
+
+void RenderDevice::unregisterSession(uint32_t session) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto found = m_Sessions.find(session);
+    if (found == m_Sessions.end()) {
+        return;
+    }
+
+    const Session& state = found->second;
+    Log::info("Render Session {}: {} submissions, {} ms waiting for the queue, peak device memory {} KiB in {} allocations",
+              session, state.queue.submissions, state.queue.waitMilliseconds, state.memory.peakBytes / 1024, state.memory.allocations);
+    if (state.memory.bytes > 0) {
+        Log::warn("Render Session {} Still Holds {} Bytes Of Device Memory", session, state.memory.bytes);
+    }
+    m_Sessions.erase(found);
+    // a session waiting behind this one may be next now
+    m_QueueAvailable.notify_all();
+}
+
+// Memory
+
+VkResult RenderDevice::allocateMemory(uint32_t session, const VkMemoryAllocateInfo& allocInfo, VkDeviceMemory* memory) {
+    VkResult result = vkAllocateMemory(m_Device, &allocInfo, nullptr, memory);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Allocations[*memory] = { session, allocInfo.allocationSize };
+    SessionMemoryUsage& usage = m_Sessions[session].memory;
+    usage.bytes += allocInfo.allocationSize;
+    usage.peakBytes = std::max(usage.peakBytes, usage.bytes);
+    usage.allocations++;
+    return result;
+}
+
+void RenderDevice::freeMemory(VkDeviceMemory memory) {
+    if (memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto allocation = m_Allocations.find(memory);
+        if (allocation != m_Allocations.end()) {
+            auto session = m_Sessions.find(allocation->second.first);
+            if (session != m_Sessions.end()) {
+                session->second.memory.bytes -= allocation->second.second;
+            }
+            m_Allocations.erase(allocation);
+        }
+    }
+    vkFreeMemory(m_Device, memory, nullptr);
+}
+
+SessionMemoryUsage RenderDevice::getMemoryUsage(uint32_t session) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto found = m_Sessions.find(session);
+    return found != m_Sessions.end() ? found->second.memory : SessionMemoryUsage{};
+}
+
+SessionQueueStats RenderDevice::getQueueStats(uint32_t session) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto found = m_Sessions.find(session);
+    return found != m_Sessions.end() ? found->second.queue : SessionQueueStats{};
+}
+
+// Queue
+
+void RenderDevice::acquireQueue(uint32_t session) {
+    auto waitStart = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    Session& state = m_Sessions[session];
+    state.waiting = true;
+
+    m_QueueAvailable.wait(lock, [&] {
+        if (m_QueueBusy) {
+            return false;
+        }
+        for (const auto& other : m_Sessions) {
+            if (other.second.waiting && other.second.queue.submissions < state.queue.submissions) {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    state.waiting = false;
+    m_QueueBusy = true;
+    state.queue.waitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+}
+
+void RenderDevice::releaseQueue(uint32_t session, bool submitted) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_QueueBusy = false;
+        if (submitted) {
+            m_Sessions[session].queue.submissions++;
+        }
+    }
+    m_QueueAvailable.notify_all();
+}
+
+VkResult RenderDevice::submit(uint32_t session, const VkSubmitInfo& submitInfo, VkFence fence) {
+    acquireQueue(session);
+    VkResult result = vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, fence);
+    releaseQueue(session, true);
+    return result;
+}
+
+VkResult RenderDevice::present(uint32_t session, const VkPresentInfoKHR& presentInfo) {
+    // presents follow their session's submission, so they don't count against its share
+    acquireQueue(session);
+    VkResult result = vkQueuePresentKHR(m_PresentQueue, &presentInfo);
+    releaseQueue(session, false);
+    return result;
+}
+
+void RenderDevice::waitForPresentQueue(uint32_t session) {
+    acquireQueue(session);
+    vkQueueWaitIdle(m_PresentQueue);
+    releaseQueue(session, false);
+}
+
+VkResult RenderDevice::waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId, uint64_t timeout) {
+    return m_WaitForPresent(m_Device, swapChain, presentId, timeout);
+}
+
+void RenderDevice::waitIdle() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_QueueAvailable.wait(lock, [this] { return !m_QueueBusy; });
+    m_QueueBusy = true;
+    lock.unlock();
+
+    vkDeviceWaitIdle(m_Device);
+
+    lock.lock();
+    m_QueueBusy = false;
+    lock.unlock();
+    m_QueueAvailable.notify_all();
+}
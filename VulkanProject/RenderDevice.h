@@ -0,0 +1,155 @@
+#pragma once
+
+#ifndef GLFW_INCLUDE_VULKAN
+#define GLFW_INCLUDE_VULKAN
+#endif
+#include <GLFW/glfw3.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "PipelineBuildService.h"
+#include "PipelineCache.h"
+#include "PresentWait.h"
+
+struct QueueFamilyIndices {
+    std::optional<uint32_t> graphicsFamily;
+    std::optional<uint32_t> presentFamily;
+
+    bool isComplete() {
+        return graphicsFamily.has_value() && presentFamily.has_value();
+    }
+};
+
+struct SwapChainSupportDetails {
+    VkSurfaceCapabilitiesKHR capabilities;
+    std::vector<VkSurfaceFormatKHR> formats;
+    std::vector<VkPresentModeKHR> presentModes;
+};
+
+SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
+
+struct SessionMemoryUsage {
+    uint64_t bytes = 0;
+    uint64_t peakBytes = 0;
+    uint32_t allocations = 0;
+};
+
+struct SessionQueueStats {
+    uint64_t submissions = 0;
+    // time spent waiting for other sessions' submissions
+    double waitMilliseconds = 0.0;
+};
+
+// Everything that exists once per GPU: the instance, the physical and logical device, its queues, the pipeline cache
+// and the threads that compile pipelines into it. Any number of render sessions share one RenderDevice; each
+// registers for an id, allocates device memory through it so usage is accounted per session, and submits through
+// it, since a VkQueue may only be used by one thread at a time.
+// Submissions are scheduled fairly: while several sessions wait for the queue, the one that has submitted the least
+// goes first, so a session rendering as fast as it can doesn't starve the others.
+class RenderDevice
+{
+private:
+
+    struct Session {
+        SessionMemoryUsage memory;
+        SessionQueueStats queue;
+        bool waiting = false;
+    };
+
+    bool m_Headless;
+    bool m_RequestPipelineStatistics;
+    // headless runs need no device extensions at all
+    std::vector<const char*> m_DeviceExtensions;
+
+    VkInstance m_Instance = VK_NULL_HANDLE;
+    VkDebugUtilsMessengerEXT m_DebugMessenger = VK_NULL_HANDLE;
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkQueue m_GraphicsQueue = VK_NULL_HANDLE;
+    VkQueue m_PresentQueue = VK_NULL_HANDLE;
+    QueueFamilyIndices m_QueueFamilies;
+    bool m_PipelineStatistics = false;
+    // VK_KHR_present_id + VK_KHR_present_wait, enabled whenever the device has both
+    bool m_PresentWait = false;
+    PFN_vkWaitForPresentKHR m_WaitForPresent = nullptr;
+    std::unique_ptr<PipelineCache> m_PipelineCache;
+    std::unique_ptr<PipelineBuildService> m_PipelineBuildService;
+    std::mutex m_InitMutex;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_QueueAvailable;
+    bool m_QueueBusy = false;
+    std::unordered_map<uint32_t, Session> m_Sessions;
+    std::unordered_map<VkDeviceMemory, std::pair<uint32_t, VkDeviceSize>> m_Allocations;
+    uint32_t m_NextSession = 0;
+
+    std::vector<const char*> getRequiredExtensions();
+    void createInstance();
+    void setupDebugMessenger();
+    bool checkValidationLayerSupport();
+    void pickPhysicalDevice(VkSurfaceKHR surface);
+    bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface);
+    bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool hasDeviceExtension(VkPhysicalDevice device, const char* name);
+    void printAvailableDeviceExtensions();
+    void createLogicalDevice();
+    QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
+
+    // Takes the queue for session, waiting while a session with fewer submissions also wants it
+    void acquireQueue(uint32_t session);
+    void releaseQueue(uint32_t session, bool submitted);
+
+public:
+
+    // Creates the instance. GLFW has to be initialized first unless headless.
+    RenderDevice(bool headless, bool pipelineStatistics);
+
+    RenderDevice(const RenderDevice&) = delete;
+    RenderDevice& operator=(const RenderDevice&) = delete;
+
+    // Picks the physical device and creates the logical device on the first call; later calls only check that surface
+    // can be presented to from the present queue. surface is VK_NULL_HANDLE when headless.
+    void initialize(VkSurfaceKHR surface);
+    // Saves the pipeline cache and destroys the device and instance. Every session must have destroyed its objects.
+    void destroy();
+
+    VkInstance getInstance();
+    VkPhysicalDevice getPhysicalDevice();
+    VkDevice getDevice();
+    VkQueue getGraphicsQueue();
+    VkQueue getPresentQueue();
+    const QueueFamilyIndices& getQueueFamilies();
+    bool pipelineStatisticsEnabled();
+    // Whether presents can carry a VkPresentIdKHR and be waited on with waitForPresent
+    bool presentWaitEnabled();
+    PipelineCache& getPipelineCache();
+    PipelineBuildService& getPipelineBuildService();
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    uint32_t registerSession();
+    // Logs the session's queue and memory statistics; anything it still has allocated is reported as leaked
+    void unregisterSession(uint32_t session);
+
+    VkResult allocateMemory(uint32_t session, const VkMemoryAllocateInfo& allocInfo, VkDeviceMemory* memory);
+    void freeMemory(VkDeviceMemory memory);
+    SessionMemoryUsage getMemoryUsage(uint32_t session);
+    SessionQueueStats getQueueStats(uint32_t session);
+
+    VkResult submit(uint32_t session, const VkSubmitInfo& submitInfo, VkFence fence);
+    VkResult present(uint32_t session, const VkPresentInfoKHR& presentInfo);
+    // Idles the present queue, stalling every session's submissions with it. Only for a session that is alone on the
+    // device (a windowed one) and about to destroy what its presents use; sessions otherwise wait on their fences.
+    void waitForPresentQueue(uint32_t session);
+    // Blocks until the present tagged presentId (or a later one) on swapChain is displayed, or timeout nanoseconds
+    // pass. Only the session owning swapChain may call it; the queue isn't taken.
+    VkResult waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId, uint64_t timeout);
+    // Waits for every session's work
+    void waitIdle();
+};
@@ -0,0 +1,188 @@
+#include "ResourceCache.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "Log.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool ResourceCache::identify(const std::string& path, FileIdentity& identity) {
+    HANDLE file = CreateFileA(path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    BY_HANDLE_FILE_INFORMATION info;
+    bool found = GetFileInformationByHandle(file, &info) != 0;
+    CloseHandle(file);
+    if (!found) {
+        return false;
+    }
+
+    identity.device = info.dwVolumeSerialNumber;
+    identity.index = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    identity.size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    identity.lastWrite = static_cast<int64_t>((static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime);
+    return true;
+}
+
+ResourceSpan ResourceCache::mapFile(const std::string& path, size_t size) {
+    if (size == 0) {
+        return {};
+    }
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to open resource \"" + path + "\"!");
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        throw std::runtime_error("failed to map resource \"" + path + "\"!");
+    }
+
+    // the view keeps the section alive, so the mapping handle can be closed right away
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+    CloseHandle(mapping);
+    if (view == nullptr) {
+        throw std::runtime_error("failed to map resource \"" + path + "\"!");
+    }
+
+    std::shared_ptr<const void> owner(view, [](const void* view) { UnmapViewOfFile(view); });
+    return { owner, static_cast<const uint8_t*>(view), size };
+}
+
+#else
+
+bool ResourceCache::identify(const std::string& path, FileIdentity& identity) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+
+    identity.device = static_cast<uint64_t>(info.st_dev);
+    identity.index = static_cast<uint64_t>(info.st_ino);
+    identity.size = static_cast<uint64_t>(info.st_size);
+    identity.lastWrite = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+}
+
+ResourceSpan ResourceCache::mapFile(const std::string& path, size_t size) {
+    if (size == 0) {
+        return {};
+    }
+
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw std::runtime_error("failed to open resource \"" + path + "\"!");
+    }
+
+    // the mapping keeps its own reference to the file
+    void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (view == MAP_FAILED) {
+        throw std::runtime_error("failed to map resource \"" + path + "\"!");
+    }
+
+    std::shared_ptr<const void> owner(view, [size](const void* view) { munmap(const_cast<void*>(view), size); });
+    return { owner, static_cast<const uint8_t*>(view), size };
+}
+
+#endif
+
+ResourceSpan ResourceCache::copyFile(const std::string& path, size_t size) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open resource \"" + path + "\"!");
+    }
+
+    // uint32_t storage keeps copies as aligned as mappings, so SPIR-V can be used in place either way
+    auto words = std::make_shared<std::vector<uint32_t>>((size + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    file.read(reinterpret_cast<char*>(words->data()), size);
+    if (static_cast<size_t>(file.gcount()) != size) {
+        throw std::runtime_error("failed to read resource \"" + path + "\"!");
+    }
+
+    return { words, reinterpret_cast<const uint8_t*>(words->data()), size };
+}
+
+std::string ResourceCache::identityKey(const FileIdentity& identity) {
+    return std::to_string(identity.device) + ":" + std::to_string(identity.index);
+}
+
+bool ResourceCache::tryLoad(const std::string& path, ResourceSpan& span, ResourceAccess access) {
+    TRACE_SCOPE("ResourceCache::tryLoad", "loader");
+    FileIdentity identity;
+    if (!identify(path, identity)) {
+        return false;
+    }
+    std::string key = identityKey(identity);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto found = m_Entries.find(key);
+    if (found != m_Entries.end()) {
+        const FileIdentity& cached = found->second.identity;
+        if (cached.size == identity.size && cached.lastWrite == identity.lastWrite && found->second.access == access) {
+            m_Stats.hits++;
+            span = found->second.span;
+            return true;
+        }
+        m_Stats.invalidations++;
+        m_Entries.erase(found);
+    }
+    m_Stats.misses++;
+
+    try {
+        size_t size = static_cast<size_t>(identity.size);
+        span = access == ResourceAccess::Map ? mapFile(path, size) : copyFile(path, size);
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    m_Stats.bytesLoaded += span.size;
+
+    m_Entries[key] = Entry{ identity, access, span };
+    return true;
+}
+
+ResourceSpan ResourceCache::load(const std::string& path, ResourceAccess access) {
+    ResourceSpan span;
+    if (!tryLoad(path, span, access)) {
+        throw std::runtime_error("failed to load resource \"" + path + "\"!");
+    }
+    return span;
+}
+
+void ResourceCache::clear() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.clear();
+}
+
+ResourceCacheStats ResourceCache::getStats() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+void ResourceCache::printStats() {
+    ResourceCacheStats stats = getStats();
+    Log::debug("Resource Cache:");
+    Log::debug("\tLoads: {} hits, {} misses, {} invalidated", stats.hits, stats.misses, stats.invalidations);
+    Log::debug("\tBytes Loaded: {}", stats.bytesLoaded);
+}
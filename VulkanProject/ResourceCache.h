@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// A read-only view of a resource's bytes. Copies share ownership of the backing memory (a file mapping or a heap
+// copy), so a span stays valid after the cache has dropped or replaced its entry.
+struct ResourceSpan {
+    std::shared_ptr<const void> owner;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    bool empty() const {
+        return size == 0;
+    }
+};
+
+enum class ResourceAccess {
+    // Map the file. Free to load again and shared with every other user of the file, but on Windows the mapping
+    // keeps writers from replacing the file, and elsewhere an in-place rewrite shows through.
+    Map,
+    // Copy the file into memory. For files that are expected to be rewritten while in use, e.g. watched shaders.
+    Copy
+};
+
+struct ResourceCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t invalidations = 0;
+    uint64_t bytesLoaded = 0;
+};
+
+// Loads resource files once and hands out shared spans of them. Every load looks the path up on disk and finds the
+// entry by the file's identity (device + inode, or volume + file index on Windows), so hard links and different
+// spellings of the same path share one copy; the size and write time from that lookup reload the file if changed.
+// Thread safe; meant to be shared by every loader (shaders, meshes, ...).
+class ResourceCache
+{
+private:
+
+    struct FileIdentity {
+        uint64_t device = 0;
+        uint64_t index = 0;
+        uint64_t size = 0;
+        int64_t lastWrite = 0;
+    };
+
+    struct Entry {
+        FileIdentity identity;
+        ResourceAccess access;
+        ResourceSpan span;
+    };
+
+    std::mutex m_Mutex;
+    // keyed by device + index, so every path that reaches the same file shares its entry
+    std::unordered_map<std::string, Entry> m_Entries;
+    ResourceCacheStats m_Stats;
+
+    static bool identify(const std::string& path, FileIdentity& identity);
+    static std::string identityKey(const FileIdentity& identity);
+    static ResourceSpan mapFile(const std::string& path, size_t size);
+    static ResourceSpan copyFile(const std::string& path, size_t size);
+
+public:
+
+    // Throws if the file cannot be opened
+    ResourceSpan load(const std::string& path, ResourceAccess access = ResourceAccess::Map);
+    // Returns false if the file does not exist or cannot be opened
+    bool tryLoad(const std::string& path, ResourceSpan& span, ResourceAccess access = ResourceAccess::Map);
+
+    // Drops every entry; spans already handed out stay valid
+    void clear();
+
+    ResourceCacheStats getStats();
+    void printStats();
+};
@@ -0,0 +1,112 @@
+#include "ShaderVariants.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+void ShaderVariantKey::set(std::vector<SpecializationConstant>& constants, uint32_t id, uint32_t bits) {
+    auto position = std::lower_bound(constants.begin(), constants.end(), id, [](const SpecializationConstant& constant, uint32_t id) {
+        return constant.id < id;
+    });
+
+    if (position != constants.end() && position->id == id) {
+        position->value = bits;
+    }
+    else {
+        constants.insert(position, SpecializationConstant{ id, bits });
+    }
+}
+
+ShaderVariantKey& ShaderVariantKey::setUInt(VkShaderStageFlagBits stage, uint32_t id, uint32_t value) {
+    switch (stage) {
+    case VK_SHADER_STAGE_VERTEX_BIT:
+        set(m_VertexConstants, id, value);
+        break;
+    case VK_SHADER_STAGE_FRAGMENT_BIT:
+        set(m_FragmentConstants, id, value);
+        break;
+    default:
+        throw std::runtime_error("unsupported shader stage for specialization constant!");
+    }
+    return *this;
+}
+
+ShaderVariantKey& ShaderVariantKey::setInt(VkShaderStageFlagBits stage, uint32_t id, int32_t value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return setUInt(stage, id, bits);
+}
+
+ShaderVariantKey& ShaderVariantKey::setFloat(VkShaderStageFlagBits stage, uint32_t id, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return setUInt(stage, id, bits);
+}
+
+ShaderVariantKey& ShaderVariantKey::setBool(VkShaderStageFlagBits stage, uint32_t id, bool value) {
+    return setUInt(stage, id, value ? VK_TRUE : VK_FALSE);
+}
+
+const std::vector<SpecializationConstant>& ShaderVariantKey::getVertexConstants() const {
+    return m_VertexConstants;
+}
+
+const std::vector<SpecializationConstant>& ShaderVariantKey::getFragmentConstants() const {
+    return m_FragmentConstants;
+}
+
+std::string ShaderVariantKey::str() const {
+    std::string key = "v";
+    for (const auto& constant : m_VertexConstants) {
+        key += ":" + std::to_string(constant.id) + "=" + std::to_string(constant.value);
+    }
+    key += "|f";
+    for (const auto& constant : m_FragmentConstants) {
+        key += ":" + std::to_string(constant.id) + "=" + std::to_string(constant.value);
+    }
+    return key;
+}
+
+ShaderVariantCache::ShaderVariantCache(GraphicsPipelineDesc base, PipelineRegistry* registry) : m_Base{ std::move(base) }, m_Registry{ registry } {
+}
+
+GraphicsPipelineDesc ShaderVariantCache::describe(const ShaderVariantKey& key) {
+    GraphicsPipelineDesc desc = m_Base;
+    desc.name = m_Base.name + " [" + key.str() + "]";
+    desc.vertexConstants = key.getVertexConstants();
+    desc.fragmentConstants = key.getFragmentConstants();
+    return desc;
+}
+
+VkPipeline ShaderVariantCache::get(const ShaderVariantKey& key) {
+    std::string name = key.str();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto found = m_Variants.find(name);
+        if (found != m_Variants.end()) {
+            return found->second;
+        }
+    }
+
+    VkPipeline pipeline = m_Registry->getPipeline(describe(key));
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Variants.emplace(name, pipeline);
+    return pipeline;
+}
+
+std::shared_future<VkPipeline> ShaderVariantCache::request(const ShaderVariantKey& key, PipelineBuildService& service) {
+    // the registry remembers the pending build, so get() on the same key later just waits for or reuses it
+    return m_Registry->requestPipeline(describe(key), service);
+}
+
+void ShaderVariantCache::prewarm(const std::vector<ShaderVariantKey>& keys, PipelineBuildService& service) {
+    for (const auto& key : keys) {
+        request(key, service);
+    }
+}
+
+size_t ShaderVariantCache::size() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Variants.size();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "GraphicsPipeline.h"
+#include "PipelineRegistry.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Specialization constant IDs declared with layout(constant_id = N) in res/shader.vert and res/shader.frag
+namespace ShaderConstants {
+    const uint32_t PositionScale = 0; // vertex, float
+    const uint32_t ColorMode = 1;     // fragment, int (ColorMode)
+}
+
+enum class ColorMode : int32_t {
+    Vertex = 0,
+    Grayscale = 1,
+    Inverted = 2
+};
+
+// The specialization constant values that pick one variant out of a shader pair.
+// Constants that are never set keep the default written in the GLSL source.
+class ShaderVariantKey
+{
+private:
+
+    std::vector<SpecializationConstant> m_VertexConstants;
+    std::vector<SpecializationConstant> m_FragmentConstants;
+
+    static void set(std::vector<SpecializationConstant>& constants, uint32_t id, uint32_t bits);
+
+public:
+
+    ShaderVariantKey& setUInt(VkShaderStageFlagBits stage, uint32_t id, uint32_t value);
+    ShaderVariantKey& setInt(VkShaderStageFlagBits stage, uint32_t id, int32_t value);
+    ShaderVariantKey& setFloat(VkShaderStageFlagBits stage, uint32_t id, float value);
+    ShaderVariantKey& setBool(VkShaderStageFlagBits stage, uint32_t id, bool value);
+
+    const std::vector<SpecializationConstant>& getVertexConstants() const;
+    const std::vector<SpecializationConstant>& getFragmentConstants() const;
+
+    // Canonical form (constants sorted by id), used as the cache key
+    std::string str() const;
+};
+
+// Lazily creates one pipeline per variant of a base description. Variants differ only in specialization
+// constants, so the driver folds the branches they select at pipeline creation instead of per vertex/fragment.
+// Pipelines are owned by the registry; this class only remembers which variant maps to which pipeline so the
+// hot path skips building a full registry key.
+class ShaderVariantCache
+{
+private:
+
+    GraphicsPipelineDesc m_Base;
+    PipelineRegistry* m_Registry;
+
+    std::mutex m_Mutex;
+    std::unordered_map<std::string, VkPipeline> m_Variants;
+
+    GraphicsPipelineDesc describe(const ShaderVariantKey& key);
+
+public:
+
+    ShaderVariantCache(GraphicsPipelineDesc base, PipelineRegistry* registry);
+
+    // Builds the variant on first use
+    VkPipeline get(const ShaderVariantKey& key);
+
+    // Starts building one variant on the service's threads; get() on the same key afterwards reuses that build
+    std::shared_future<VkPipeline> request(const ShaderVariantKey& key, PipelineBuildService& service);
+
+    // Starts building variants on the service's threads so a later get() is a lookup
+    void prewarm(const std::vector<ShaderVariantKey>& keys, PipelineBuildService& service);
+
+    size_t size();
+};
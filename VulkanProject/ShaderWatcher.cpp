@@ -0,0 +1,155 @@
+#include "ShaderWatcher.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "Log.h"
+#include "Trace.h"
+
+const uint32_t SPIRV_MAGIC = 0x07230203;
+const std::chrono::milliseconds POLL_INTERVAL{ 250 };
+
+ShaderWatcher::ShaderWatcher(ResourceCache* cache, std::string directory, std::vector<WatchedShader> shaders, std::string glslc)
+    : m_Cache{ cache }, m_Directory{ std::move(directory) }, m_Glslc{ std::move(glslc) }, m_Shaders{ std::move(shaders) } {
+
+    // whatever is on disk now is the baseline, only later edits count as changes
+    for (const auto& shader : m_Shaders) {
+        changedSince(shader.name, true);
+        if (!m_Glslc.empty()) {
+            changedSince(shader.source, true);
+        }
+        readSpirv(shader.name, m_LastCode[shader.name]);
+    }
+
+    m_Thread = std::thread(&ShaderWatcher::watchLoop, this);
+    Log::info("Watching \"{}\" for shader changes{}", m_Directory, (m_Glslc.empty() ? "" : " (compiling GLSL)"));
+}
+
+ShaderWatcher::~ShaderWatcher() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Wake.notify_all();
+    m_Thread.join();
+}
+
+std::filesystem::path ShaderWatcher::pathOf(const std::string& name) {
+    return std::filesystem::path(m_Directory) / name;
+}
+
+// Compares the file's write time to the last one seen. A missing file never counts as changed.
+bool ShaderWatcher::changedSince(const std::string& name, bool remember) {
+    std::error_code error;
+    auto lastWrite = std::filesystem::last_write_time(pathOf(name), error);
+    if (error) {
+        return false;
+    }
+
+    auto found = m_LastWrite.find(name);
+    bool changed = found == m_LastWrite.end() || found->second != lastWrite;
+    if (remember) {
+        m_LastWrite[name] = lastWrite;
+    }
+    return changed;
+}
+
+bool ShaderWatcher::readSpirv(const std::string& name, ResourceSpan& code) {
+    ResourceSpan span;
+    if (!m_Cache->tryLoad(pathOf(name).string(), span, ResourceAccess::Copy)) {
+        return false;
+    }
+
+    if (span.size < sizeof(uint32_t) || span.size % sizeof(uint32_t) != 0) {
+        return false;
+    }
+    uint32_t magic;
+    std::memcpy(&magic, span.data, sizeof(magic));
+    if (magic != SPIRV_MAGIC) {
+        return false;
+    }
+
+    code = std::move(span);
+    return true;
+}
+
+static bool sameBytes(const ResourceSpan& a, const ResourceSpan& b) {
+    return a.size == b.size && (a.size == 0 || std::memcmp(a.data, b.data, a.size) == 0);
+}
+
+void ShaderWatcher::compile(const WatchedShader& shader) {
+    TRACE_SCOPE("ShaderWatcher::compile", "shader");
+    std::filesystem::path errors = std::filesystem::temp_directory_path() / (shader.name + ".errors");
+    std::string command = "\"" + m_Glslc + "\" \"" + pathOf(shader.source).string() + "\" -o \"" + pathOf(shader.name).string() + "\"" +
+        " 2> \"" + errors.string() + "\"";
+#ifdef _WIN32
+    // cmd /c strips the first and last quote of the line, which would otherwise be glslc's own
+    command = "\"" + command + "\"";
+#endif
+
+    Log::debug("Compiling Shader \"{}\"", shader.source);
+    int status = std::system(command.c_str());
+    if (status != 0) {
+        // the old SPIR-V stays in place
+        std::ifstream file(errors);
+        std::string output((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        Log::warn("Failed to compile \"{}\" (exit code {}):\n{}", shader.source, status, output);
+    }
+
+    std::error_code error;
+    std::filesystem::remove(errors, error);
+}
+
+void ShaderWatcher::poll() {
+    TRACE_SCOPE("ShaderWatcher::poll", "shader");
+    for (const auto& shader : m_Shaders) {
+        if (!m_Glslc.empty() && changedSince(shader.source, true)) {
+            compile(shader);
+        }
+
+        if (!changedSince(shader.name, false)) {
+            continue;
+        }
+
+        // the file may still be half written, in which case try again next poll
+        ResourceSpan code;
+        if (!readSpirv(shader.name, code)) {
+            continue;
+        }
+        changedSince(shader.name, true);
+
+        if (sameBytes(code, m_LastCode[shader.name])) {
+            continue;
+        }
+        m_LastCode[shader.name] = code;
+
+        Log::info("Shader \"{}\" changed", shader.name);
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Changes[shader.name] = code;
+    }
+}
+
+void ShaderWatcher::watchLoop() {
+    Trace::setThreadName("Shader Watcher");
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (!m_Stopping) {
+        m_Wake.wait_for(lock, POLL_INTERVAL, [this] { return m_Stopping; });
+        if (m_Stopping) {
+            break;
+        }
+
+        lock.unlock();
+        poll();
+        lock.lock();
+    }
+}
+
+std::unordered_map<std::string, ResourceSpan> ShaderWatcher::takeChanges() {
+    std::unordered_map<std::string, ResourceSpan> changes;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    changes.swap(m_Changes);
+    return changes;
+}
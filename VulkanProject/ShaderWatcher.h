@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ResourceCache.h"
+
+struct WatchedShader {
+    // SPIR-V file name inside the watched directory, also the name ShaderLibrary serves it under (e.g. "vert.spv")
+    std::string name;
+    // GLSL file it is compiled from; only watched when the watcher has a glslc to run
+    std::string source;
+};
+
+// Polls a directory for changed shaders on its own thread. Edited GLSL is recompiled with glslc (if one was given),
+// then every SPIR-V file that changed and actually differs from the last version seen is read (through the resource
+// cache, as a copy so the file can keep being rewritten) and queued for the render thread to pick up at a frame
+// boundary. Compilation and file IO never happen on the render thread.
+class ShaderWatcher
+{
+private:
+
+    ResourceCache* m_Cache;
+    std::string m_Directory;
+    std::string m_Glslc;
+    std::vector<WatchedShader> m_Shaders;
+
+    // only touched by the watcher thread (and the constructor, before it starts)
+    std::unordered_map<std::string, std::filesystem::file_time_type> m_LastWrite;
+    std::unordered_map<std::string, ResourceSpan> m_LastCode;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    bool m_Stopping = false;
+    std::unordered_map<std::string, ResourceSpan> m_Changes;
+
+    std::thread m_Thread;
+
+    std::filesystem::path pathOf(const std::string& name);
+    bool changedSince(const std::string& name, bool remember);
+    bool readSpirv(const std::string& name, ResourceSpan& code);
+    void compile(const WatchedShader& shader);
+    void poll();
+    void watchLoop();
+
+public:
+
+    // glslc may be empty, in which case only the SPIR-V files are watched
+    ShaderWatcher(ResourceCache* cache, std::string directory, std::vector<WatchedShader> shaders, std::string glslc);
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    // Shaders that changed since the last call, by name
+    std::unordered_map<std::string, ResourceSpan> takeChanges();
+};
@@ -0,0 +1,5 @@
+#include "Statistics.h"
+
+double percentile(const std::vector<double>& sorted, double p) {
+    return sorted[static_cast<size_t>(p * (sorted.size() - 1) + 0.5)];
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Percentile p (0 to 1) of samples already sorted in ascending order, taken as the sample nearest that rank. Every
+// summary that reports percentiles uses this, so a p99 means the same in each of them. sorted must not be empty.
+double percentile(const std::vector<double>& sorted, double p);
@@ -0,0 +1,182 @@
+#include "Trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Log.h"
+
+// Per thread; later scopes are counted and dropped so a forgotten trace can't eat all memory
+const size_t TRACE_MAX_EVENTS_PER_THREAD = 1 << 20;
+
+std::atomic<bool> Trace::g_Enabled{ false };
+
+struct TraceThreadBuffer {
+    // only contended while stop() writes this buffer out
+    std::mutex mutex;
+    uint32_t id;
+    std::string name;
+    std::vector<TraceEvent> events;
+    std::vector<TraceCounter> counters;
+    uint64_t dropped = 0;
+};
+
+struct TraceState {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<TraceThreadBuffer>> threads;
+    uint32_t nextThreadId = 1;
+    std::string path;
+    int64_t startTime = 0;
+};
+
+static TraceState& state() {
+    static TraceState instance;
+    return instance;
+}
+
+// Buffers are shared with the state so events survive their thread exiting before the trace is written
+static TraceThreadBuffer& threadBuffer() {
+    thread_local std::shared_ptr<TraceThreadBuffer> buffer = []() {
+        TraceState& trace = state();
+        auto created = std::make_shared<TraceThreadBuffer>();
+        created->events.reserve(4096);
+
+        std::lock_guard<std::mutex> lock(trace.mutex);
+        created->id = trace.nextThreadId++;
+        trace.threads.push_back(created);
+        return created;
+    }();
+    return *buffer;
+}
+
+static void writeEscaped(std::ofstream& file, const char* text) {
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            file << '\\';
+        }
+        file << *c;
+    }
+}
+
+static double toMicroseconds(int64_t ticks) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::duration(ticks)).count();
+}
+
+void Trace::start(std::string path) {
+    TraceState& trace = state();
+    {
+        std::lock_guard<std::mutex> lock(trace.mutex);
+        trace.path = std::move(path);
+        trace.startTime = now();
+    }
+    g_Enabled = true;
+    Log::info("Tracing To \"{}\"", trace.path);
+}
+
+void Trace::stop() {
+    if (!g_Enabled.exchange(false)) {
+        return;
+    }
+
+    TraceState& trace = state();
+    std::lock_guard<std::mutex> lock(trace.mutex);
+
+    std::ofstream file(trace.path, std::ios::trunc);
+    if (!file) {
+        Log::warn("Failed To Write Trace \"{}\"", trace.path);
+        return;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file.precision(3);
+    file << std::fixed;
+
+    size_t eventCount = 0;
+    uint64_t dropped = 0;
+    bool first = true;
+    for (const auto& thread : trace.threads) {
+        std::lock_guard<std::mutex> threadLock(thread->mutex);
+        if (!thread->name.empty()) {
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id << ",\"args\":{\"name\":\"";
+            writeEscaped(file, thread->name.c_str());
+            file << "\"}}";
+            first = false;
+        }
+
+        for (const auto& event : thread->events) {
+            file << (first ? "" : ",\n") << "{\"name\":\"";
+            writeEscaped(file, event.name);
+            file << "\",\"cat\":\"";
+            writeEscaped(file, event.category);
+            file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id
+                 << ",\"ts\":" << toMicroseconds(event.begin - trace.startTime)
+                 << ",\"dur\":" << toMicroseconds(event.end - event.begin) << "}";
+            first = false;
+        }
+
+        for (const auto& counter : thread->counters) {
+            file << (first ? "" : ",\n") << "{\"name\":\"";
+            writeEscaped(file, counter.name);
+            file << "\",\"ph\":\"C\",\"pid\":1,\"tid\":" << thread->id
+                 << ",\"ts\":" << toMicroseconds(counter.time - trace.startTime) << ",\"args\":{\"";
+            writeEscaped(file, counter.series);
+            file << "\":" << counter.value << "}}";
+            first = false;
+        }
+
+        eventCount += thread->events.size() + thread->counters.size();
+        dropped += thread->dropped;
+        thread->events.clear();
+        thread->counters.clear();
+        thread->dropped = 0;
+    }
+    file << "\n]}\n";
+
+    Log::info("Wrote Trace \"{}\" ({} events from {} threads)", trace.path, eventCount, trace.threads.size());
+    if (dropped != 0) {
+        Log::warn("Trace Dropped {} events (per-thread limit {})", dropped, TRACE_MAX_EVENTS_PER_THREAD);
+    }
+}
+
+void Trace::setThreadName(const char* name) {
+    TraceThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(state().mutex);
+    buffer.name = name;
+}
+
+int64_t Trace::now() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+void Trace::record(const char* name, const char* category, int64_t begin, int64_t end) {
+    TraceThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    // a scope that ends after stop() has taken this buffer belongs to no trace
+    if (!enabled()) {
+        return;
+    }
+    if (buffer.events.size() >= TRACE_MAX_EVENTS_PER_THREAD) {
+        buffer.dropped++;
+        return;
+    }
+    buffer.events.push_back(TraceEvent{ name, category, begin, end });
+}
+
+void Trace::counter(const char* name, const char* series, double value) {
+    if (!enabled()) {
+        return;
+    }
+
+    TraceThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (!enabled()) {
+        return;
+    }
+    if (buffer.counters.size() >= TRACE_MAX_EVENTS_PER_THREAD) {
+        buffer.dropped++;
+        return;
+    }
+    buffer.counters.push_back(TraceCounter{ name, series, now(), value });
+}
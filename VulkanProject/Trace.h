@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// One finished scope. Names and categories must be string literals; only the pointers are kept.
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    int64_t begin;
+    int64_t end;
+};
+
+// One sample of a value plotted over time, e.g. GPU time per region
+struct TraceCounter {
+    const char* name;
+    const char* series;
+    int64_t time;
+    double value;
+};
+
+// CPU trace recorder. Scopes append to a buffer owned by the calling thread, under a lock only stop() ever
+// contends for; the buffers are only merged when the trace is written out as Chrome trace JSON (open it in chrome://tracing or
+// ui.perfetto.dev). While no trace is running a scope costs one relaxed load.
+namespace Trace {
+    extern std::atomic<bool> g_Enabled;
+
+    inline bool enabled() {
+        return g_Enabled.load(std::memory_order_relaxed);
+    }
+
+    // Starts recording; stop() writes everything recorded so far to path
+    void start(std::string path);
+    // Other threads may still be recording; scopes they finish after this are dropped
+    void stop();
+
+    // Shown as the thread's name in the trace viewer
+    void setThreadName(const char* name);
+
+    int64_t now();
+    void record(const char* name, const char* category, int64_t begin, int64_t end);
+    // Adds a sample to series of the counter track name
+    void counter(const char* name, const char* series, double value);
+}
+
+class TraceScope
+{
+private:
+
+    const char* m_Name;
+    const char* m_Category;
+    int64_t m_Begin = 0;
+    bool m_Active;
+
+public:
+
+    TraceScope(const char* name, const char* category) : m_Name{ name }, m_Category{ category }, m_Active{ Trace::enabled() } {
+        if (m_Active) {
+            m_Begin = Trace::now();
+        }
+    }
+
+    ~TraceScope() {
+        if (m_Active) {
+            Trace::record(m_Name, m_Category, m_Begin, Trace::now());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// Records the rest of the enclosing block as one event
+#define TRACE_SCOPE(name, category) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, category)
@@ -1,3 +1,10 @@
 @echo off
-D:\VulkanSDK\1.2.154.1\Bin\glslc.exe shader.vert -o vert.spv
-D:\VulkanSDK\1.2.154.1\Bin\glslc.exe shader.frag -o frag.spv
\ No newline at end of file
+REM The project compiles shader.vert/shader.frag the same way on build; this runs glslc without building.
+cd /d "%~dp0"
+set GLSLC=D:\VulkanSDK\1.2.154.1\Bin\glslc.exe
+if defined VULKAN_SDK set GLSLC=%VULKAN_SDK%\Bin\glslc.exe
+"%GLSLC%" shader.vert -o vert.spv || exit /b 1
+"%GLSLC%" shader.frag -o frag.spv || exit /b 1
+REM embedded copies, included by EmbeddedShaders.cpp
+"%GLSLC%" shader.vert -mfmt=num -o vert.spv.inc || exit /b 1
+"%GLSLC%" shader.frag -mfmt=num -o frag.spv.inc || exit /b 1
@@ -1,27 +1,14 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(location = 0) out vec3 fragColor;
+layout(constant_id = 0) const float POSITION_SCALE = 1.0;
 
-vec2 positions[6] = vec2[](
-    vec2(-0.5, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5),
-    vec2(-0.5, -0.5),
-    vec2(0.5, -0.5),
-    vec2(0.5, 0.5)
-);
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
 
-vec3 colors[6] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(1.0, 0.0, 0.0),
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 1.0, 0.0)
-);
+layout(location = 0) out vec3 fragColor;
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    gl_Position = vec4(inPosition * POSITION_SCALE, 0.0, 1.0);
+    fragColor = inColor;
 }
\ No newline at end of file